@@ -0,0 +1,484 @@
+// bench.cpp
+// Defines the functions used to benchmark the hot paths of the simulator.
+
+#include "bench.h"
+#include "core.h"
+#include "dram.h"
+#include "hostprof.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The number of addresses in the random cache access pattern. */
+#define BENCH_RANDOM_ADDRS (64 * 1024)
+
+/**
+ * The distance in cache lines between the accesses of the DRAM row conflict
+ * stream. As a power of two at least as large as the lines per row times
+ * the number of banks, it keeps every access in one bank but in a new row.
+ */
+#define BENCH_DRAM_CONFLICT_STRIDE (1 << 20)
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The state of a cache benchmark: a cache and the addresses to access. */
+typedef struct BenchCacheState
+{
+    Cache *c;
+    uint64_t *addrs;
+    uint64_t nof_addrs;
+    uint64_t next;
+} BenchCacheState;
+
+/** The state of a DRAM benchmark: a DRAM and its stream of addresses. */
+typedef struct BenchDRAMState
+{
+    DRAM *dram;
+    uint64_t stride;
+    uint64_t next_addr;
+} BenchDRAMState;
+
+///////////////////////////////////////////////////////////////////////////////
+//                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The current clock cycle number, advanced once per operation. */
+extern uint64_t current_cycle;
+
+/** The number of bytes in a cache line. */
+extern uint64_t CACHE_LINESIZE;
+
+/** The simulation mode, which selects the DRAM timing model. */
+extern Mode SIM_MODE;
+
+/** Which page policy the DRAM should use. */
+extern DRAMPolicy DRAM_PAGE_POLICY;
+
+/** The capacity of DRAM when it acts as a cache in front of far memory. */
+extern uint64_t DRAMCACHE_SIZE;
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Access the cache at each address of the pattern in turn, installing the
+ * line on a miss, as the memory system does.
+ *
+ * @param state The BenchCacheState.
+ * @param ops The number of accesses.
+ * @return The number of hits.
+ */
+uint64_t bench_cache_kernel(void *state, uint64_t ops)
+{
+    BenchCacheState *s = (BenchCacheState *)state;
+    uint64_t hits = 0;
+
+    for (uint64_t i = 0; i < ops; i++)
+    {
+        uint64_t line_addr = s->addrs[s->next];
+        if (++s->next == s->nof_addrs)
+        {
+            s->next = 0;
+        }
+
+        current_cycle++;
+        if (cache_access(s->c, line_addr, false, 0) == HIT)
+        {
+            hits++;
+        }
+        else
+        {
+            cache_install(s->c, line_addr, false, 0);
+        }
+    }
+
+    return hits;
+}
+
+/**
+ * Read the DRAM at each address of the stream in turn.
+ *
+ * @param state The BenchDRAMState.
+ * @param ops The number of accesses.
+ * @return The total delay of the accesses.
+ */
+uint64_t bench_dram_kernel(void *state, uint64_t ops)
+{
+    BenchDRAMState *s = (BenchDRAMState *)state;
+    uint64_t delay = 0;
+
+    for (uint64_t i = 0; i < ops; i++)
+    {
+        current_cycle++;
+        delay += dram_access(s->dram, s->next_addr, false);
+        s->next_addr += s->stride;
+    }
+
+    return delay;
+}
+
+/**
+ * Decode trace records the way core_read_trace() does, rewinding the trace
+ * at its end. Exit with an error if the trace has no records.
+ *
+ * @param state The Core whose trace to read.
+ * @param ops The number of records.
+ * @return The sum of the instruction addresses.
+ */
+uint64_t bench_trace_kernel(void *state, uint64_t ops)
+{
+    Core *core = (Core *)state;
+    uint64_t sum = 0;
+    bool rewound = false;
+
+    for (uint64_t i = 0; i < ops; i++)
+    {
+        uint32_t inst_addr;
+        uint8_t inst_type;
+        uint32_t ldst_addr;
+
+        if (trace_read(core, &inst_addr, sizeof(inst_addr)) !=
+                sizeof(inst_addr) ||
+            trace_read(core, &inst_type, sizeof(inst_type)) !=
+                sizeof(inst_type) ||
+            trace_read(core, &ldst_addr, sizeof(ldst_addr)) !=
+                sizeof(ldst_addr))
+        {
+            if (rewound)
+            {
+                fprintf(stderr, "Error: the benchmark trace has no "
+                                "records\n");
+                exit(1);
+            }
+            lseek(core->trace_fd, 0, SEEK_SET);
+            core->read_buf_left = 0;
+            rewound = true;
+            i--;
+            continue;
+        }
+        rewound = false;
+        sum += inst_addr + inst_type + ldst_addr;
+    }
+
+    return sum;
+}
+
+/**
+ * Order round timings by increasing value. Used with qsort().
+ */
+int bench_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    if (x != y)
+    {
+        return (x < y) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Time benchmarks over one warm-up round and BENCH_ROUNDS timed rounds of
+ * BENCH_OPS operations each. Each round runs every benchmark once, so
+ * host noise that lasts longer than a round spreads over all of them
+ * instead of shifting the timing of one.
+ *
+ * @param cases The benchmarks to time.
+ * @param nof_cases The number of benchmarks.
+ * @param results The array to write the timing of each benchmark to.
+ */
+void bench_measure(const BenchCase *cases, unsigned int nof_cases,
+                   BenchResult *results)
+{
+    double (*ns)[BENCH_ROUNDS] =
+        (double (*)[BENCH_ROUNDS])calloc(nof_cases, sizeof(*ns));
+    uint64_t check = 0;
+
+    for (unsigned int c = 0; c < nof_cases; c++)
+    {
+        check += cases[c].kernel(cases[c].state, BENCH_OPS);
+    }
+
+    for (unsigned int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (unsigned int c = 0; c < nof_cases; c++)
+        {
+            uint64_t start = hostprof_now();
+            check += cases[c].kernel(cases[c].state, BENCH_OPS);
+            ns[c][r] = (double)(hostprof_now() - start) / BENCH_OPS;
+        }
+    }
+
+    #ifdef DEBUG
+        printf("Benchmarks: check %lu\n", check);
+    #endif
+
+    for (unsigned int c = 0; c < nof_cases; c++)
+    {
+        // The median and its absolute deviation ignore the odd round slowed
+        // down by an interrupt or a page fault, which would skew a mean.
+        qsort(ns[c], BENCH_ROUNDS, sizeof(double), bench_compare);
+        double median = ns[c][BENCH_ROUNDS / 2];
+        for (unsigned int r = 0; r < BENCH_ROUNDS; r++)
+        {
+            ns[c][r] = fabs(ns[c][r] - median);
+        }
+        qsort(ns[c], BENCH_ROUNDS, sizeof(double), bench_compare);
+
+        memset(&results[c], 0, sizeof(BenchResult));
+        snprintf(results[c].name, sizeof(results[c].name), "%s",
+                 cases[c].name);
+        results[c].median_ns = median;
+        results[c].mad_ns = ns[c][BENCH_ROUNDS / 2];
+    }
+
+    free(ns);
+}
+
+/**
+ * Print the timing of a benchmark and its change against the baseline.
+ *
+ * @param result The timing of the benchmark.
+ * @param base The baseline results.
+ * @param nof_base The number of baseline results (0 for none).
+ */
+void bench_print_result(const BenchResult *result, const BenchResult *base,
+                        unsigned int nof_base)
+{
+    printf("%-24s %10.2f %8.2f", result->name, result->median_ns,
+           result->mad_ns);
+
+    for (unsigned int b = 0; b < nof_base; b++)
+    {
+        if (strcmp(base[b].name, result->name) != 0)
+        {
+            continue;
+        }
+
+        // A change counts only if it is at least BENCH_MIN_CHANGE of the
+        // baseline and exceeds the spread of both runs.
+        double diff = result->median_ns - base[b].median_ns;
+        double margin = fmax(BENCH_MIN_CHANGE * base[b].median_ns,
+                             result->mad_ns + base[b].mad_ns);
+        printf(" %10.2f %+7.1f%% %s", base[b].median_ns,
+               base[b].median_ns > 0 ? 100.0 * diff / base[b].median_ns
+                                     : 0.0,
+               fabs(diff) <= margin ? "same" : diff < 0 ? "faster"
+                                                        : "slower");
+        break;
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Run all benchmarks and print their timings. If the baseline file exists,
+ * also print the change against it and whether it is significant, i.e., at
+ * least BENCH_MIN_CHANGE of the baseline and larger than the combined
+ * deviations. Otherwise, record the timings in it.
+ *
+ * @param baseline The path of the baseline CSV file.
+ * @return The exit status: 0 on success, 1 if the benchmarks could not be
+ *         set up or the baseline could not be written.
+ */
+int bench_run(const char *baseline)
+{
+    BenchResult base[MAX_BENCH_RESULTS];
+    BenchResult results[MAX_BENCH_RESULTS];
+    BenchCase cases[MAX_BENCH_RESULTS];
+    unsigned int nof_cases = 0;
+    int nof_base = bench_read_baseline(baseline, base);
+    unsigned int nof_compared = (nof_base > 0) ? nof_base : 0;
+
+    // The trace is synthetic and written up front, so the benchmark times
+    // decoding rather than gunzip.
+    FILE *trace = tmpfile();
+    if (!trace)
+    {
+        fprintf(stderr, "Error: could not create a temporary trace\n");
+        return 1;
+    }
+    for (unsigned int i = 0; i < BENCH_OPS; i++)
+    {
+        uint32_t inst_addr = 0x400000 + 4 * i;
+        uint8_t inst_type = rand() % 4;
+        uint32_t ldst_addr = rand();
+        fwrite(&inst_addr, sizeof(inst_addr), 1, trace);
+        fwrite(&inst_type, sizeof(inst_type), 1, trace);
+        fwrite(&ldst_addr, sizeof(ldst_addr), 1, trace);
+    }
+    if (fflush(trace) != 0 || ferror(trace))
+    {
+        fprintf(stderr, "Error: could not write the temporary trace\n");
+        fclose(trace);
+        return 1;
+    }
+
+    printf("%-24s %10s %8s", "BENCHMARK", "NS/OP", "MAD");
+    if (nof_compared)
+    {
+        printf(" %10s %8s", "BASELINE", "CHANGE");
+    }
+    printf("\n");
+
+    // Hits cycle through half the cache, misses through four times its
+    // capacity (which LRU always misses), and random accesses over twice
+    // its capacity hit about half the time.
+    uint64_t nof_lines = BENCH_CACHE_SIZE / CACHE_LINESIZE;
+    const char *pattern_names[3] = {"hit", "miss", "random"};
+    uint64_t nof_addrs[3] = {nof_lines / 2, 4 * nof_lines,
+                             BENCH_RANDOM_ADDRS};
+    uint64_t *addrs[3];
+    for (unsigned int p = 0; p < 3; p++)
+    {
+        addrs[p] = (uint64_t *)calloc(nof_addrs[p], sizeof(uint64_t));
+        for (uint64_t i = 0; i < nof_addrs[p]; i++)
+        {
+            addrs[p][i] = (p == 2) ? rand() % (2 * nof_lines) : i;
+        }
+    }
+
+    const unsigned int assocs[4] = {1, 4, 8, 16};
+    BenchCacheState cache_states[4 * 3];
+    for (unsigned int a = 0; a < 4; a++)
+    {
+        for (unsigned int p = 0; p < 3; p++)
+        {
+            BenchCacheState *s = &cache_states[3 * a + p];
+
+            s->c = cache_new(BENCH_CACHE_SIZE, assocs[a], CACHE_LINESIZE,
+                             LRU);
+            s->addrs = addrs[p];
+            s->nof_addrs = nof_addrs[p];
+            s->next = 0;
+
+            snprintf(cases[nof_cases].name, sizeof(cases[nof_cases].name),
+                     "cache_%uway_%s", assocs[a], pattern_names[p]);
+            cases[nof_cases].kernel = bench_cache_kernel;
+            cases[nof_cases++].state = s;
+        }
+    }
+
+    // The DRAM streams use the row buffer model of modes 3 and 4 with an
+    // open page policy, whatever the other options say.
+    SIM_MODE = SIM_MODE_C;
+    DRAM_PAGE_POLICY = OPEN_PAGE;
+    DRAMCACHE_SIZE = 0;
+
+    const char *stream_names[2] = {"dram_row_hit", "dram_row_conflict"};
+    uint64_t strides[2] = {1, BENCH_DRAM_CONFLICT_STRIDE};
+    BenchDRAMState dram_states[2];
+    for (unsigned int d = 0; d < 2; d++)
+    {
+        BenchDRAMState *s = &dram_states[d];
+
+        s->dram = dram_new();
+        s->stride = strides[d];
+        s->next_addr = 0;
+
+        snprintf(cases[nof_cases].name, sizeof(cases[nof_cases].name), "%s",
+                 stream_names[d]);
+        cases[nof_cases].kernel = bench_dram_kernel;
+        cases[nof_cases++].state = s;
+    }
+
+    Core *core = (Core *)calloc(1, sizeof(Core));
+    core->trace_fd = fileno(trace);
+    lseek(core->trace_fd, 0, SEEK_SET);
+    snprintf(cases[nof_cases].name, sizeof(cases[nof_cases].name),
+             "trace_decode");
+    cases[nof_cases].kernel = bench_trace_kernel;
+    cases[nof_cases++].state = core;
+
+    bench_measure(cases, nof_cases, results);
+    for (unsigned int c = 0; c < nof_cases; c++)
+    {
+        bench_print_result(&results[c], base, nof_compared);
+    }
+    fclose(trace);
+
+    if (nof_base < 0)
+    {
+        if (!bench_write_baseline(baseline, results, nof_cases))
+        {
+            fprintf(stderr, "Warning: could not write %s\n", baseline);
+            return 1;
+        }
+        printf("\nRecorded the baseline in %s\n", baseline);
+    }
+
+    return 0;
+}
+
+/**
+ * Read the results in a baseline file.
+ *
+ * @param path The path of the baseline CSV file.
+ * @param results The array to read the results into, with room for
+ *                MAX_BENCH_RESULTS entries.
+ * @return The number of results read, or -1 if the file does not exist.
+ */
+int bench_read_baseline(const char *path, BenchResult *results)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int nof_results = 0;
+
+    if (!f)
+    {
+        return -1;
+    }
+
+    while (nof_results < MAX_BENCH_RESULTS && fgets(line, sizeof(line), f))
+    {
+        BenchResult *r = &results[nof_results];
+        // The header line does not parse and is skipped.
+        if (sscanf(line, "%47[^,],%lf,%lf", r->name, &r->median_ns,
+                   &r->mad_ns) == 3)
+        {
+            nof_results++;
+        }
+    }
+
+    fclose(f);
+    return nof_results;
+}
+
+/**
+ * Write results to a baseline file.
+ *
+ * @param path The path of the baseline CSV file.
+ * @param results The results to write.
+ * @param nof_results The number of results.
+ * @return Whether the file was written.
+ */
+bool bench_write_baseline(const char *path, const BenchResult *results,
+                          unsigned int nof_results)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f)
+    {
+        return false;
+    }
+
+    fprintf(f, "name,median_ns,mad_ns\n");
+    for (unsigned int i = 0; i < nof_results; i++)
+    {
+        fprintf(f, "%s,%.4f,%.4f\n", results[i].name, results[i].median_ns,
+                results[i].mad_ns);
+    }
+
+    return fclose(f) == 0;
+}
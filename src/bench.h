@@ -0,0 +1,120 @@
+// bench.h
+// Contains declarations of data structures and functions used to benchmark
+// the hot paths of the simulator itself: cache lookups and installs, DRAM
+// accesses, and trace decoding. Results are compared against a saved
+// baseline so changes to these kernels can be judged objectively.
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The number of timed rounds of each benchmark, after one warm-up round.
+ * Odd, so the median is one of the rounds.
+ */
+#define BENCH_ROUNDS 11
+
+/**
+ * The smallest relative change of the median against the baseline that is
+ * reported as faster or slower. Rounds run back to back in one process
+ * share its caches, frequency and layout, so their spread understates the
+ * noise between runs, which is often a few percent.
+ */
+#define BENCH_MIN_CHANGE 0.05
+
+/** The number of operations in each round of a benchmark. */
+#define BENCH_OPS 200000
+
+/** The size in bytes of the caches the cache benchmarks run on. */
+#define BENCH_CACHE_SIZE (32 * 1024)
+
+/** The maximum number of results in a baseline file. */
+#define MAX_BENCH_RESULTS 64
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A benchmark kernel: run the given number of operations on the state and
+ * return a value that depends on their results, so they cannot be optimized
+ * away.
+ */
+typedef uint64_t (*BenchKernel)(void *state, uint64_t ops);
+
+/** A benchmark: a kernel and the state to run it on. */
+typedef struct BenchCase
+{
+    char name[48];
+    BenchKernel kernel;
+    void *state;
+} BenchCase;
+
+/** The timing of one benchmark. */
+typedef struct BenchResult
+{
+    char name[48];
+
+    /** The median time per operation over all rounds, in nanoseconds. */
+    double median_ns;
+
+    /** The median absolute deviation of the rounds from the median. */
+    double mad_ns;
+} BenchResult;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Time benchmarks over one warm-up round and BENCH_ROUNDS timed rounds of
+ * BENCH_OPS operations each. Each round runs every benchmark once, so
+ * host noise that lasts longer than a round spreads over all of them
+ * instead of shifting the timing of one.
+ *
+ * @param cases The benchmarks to time.
+ * @param nof_cases The number of benchmarks.
+ * @param results The array to write the timing of each benchmark to.
+ */
+void bench_measure(const BenchCase *cases, unsigned int nof_cases,
+                   BenchResult *results);
+
+/**
+ * Run all benchmarks and print their timings. If the baseline file exists,
+ * also print the change against it and whether it is significant, i.e., at
+ * least BENCH_MIN_CHANGE of the baseline and larger than the combined
+ * deviations. Otherwise, record the timings in it.
+ *
+ * @param baseline The path of the baseline CSV file.
+ * @return The exit status: 0 on success, 1 if the benchmarks could not be
+ *         set up or the baseline could not be written.
+ */
+int bench_run(const char *baseline);
+
+/**
+ * Read the results in a baseline file.
+ *
+ * @param path The path of the baseline CSV file.
+ * @param results The array to read the results into, with room for
+ *                MAX_BENCH_RESULTS entries.
+ * @return The number of results read, or -1 if the file does not exist.
+ */
+int bench_read_baseline(const char *path, BenchResult *results);
+
+/**
+ * Write results to a baseline file.
+ *
+ * @param path The path of the baseline CSV file.
+ * @param results The results to write.
+ * @param nof_results The number of results.
+ * @return Whether the file was written.
+ */
+bool bench_write_baseline(const char *path, const BenchResult *results,
+                          unsigned int nof_results);
+
+#endif // __BENCH_H__
@@ -7,6 +7,7 @@
 // Defines the functions used to implement the cache.
 
 #include "cache.h"
+#include "hostprof.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -38,6 +39,9 @@ extern uint64_t CACHE_LINESIZE;
 
 extern unsigned int NUM_CORES;
 
+/** The host time profile of the simulator, or NULL if disabled. */
+extern HostProfile *hostprof;
+
 ///////////////////////////////////////////////////////////////////////////////
 //                           FUNCTION DEFINITIONS                            //
 ///////////////////////////////////////////////////////////////////////////////
@@ -73,20 +77,25 @@ Cache *cache_new(uint64_t size, uint64_t associativity, uint64_t line_size,
 
     newCache->nof_ways = associativity;
     newCache->rpl_pol = replacement_policy;
-    newCache->nof_sets = (size / CACHE_LINESIZE) / associativity;
+    newCache->nof_sets = (size / line_size) / associativity;
     newCache->stat_read_access = 0;
     newCache->stat_read_miss = 0;
     newCache->stat_write_access = 0;
     newCache->stat_write_miss = 0;
     newCache->stat_dirty_evicts = 0;
+    newCache->index_fn = INDEX_MODULO;
+    newCache->index_bits = (uint8_t)log2(newCache->nof_sets);
     #ifdef DEBUG
         printf("Creating cache (# sets: %d, # ways: %d)\n", newCache->nof_sets, newCache->nof_ways);
     #endif
     newCache->sets = (CacheSet *)calloc(newCache->nof_sets, sizeof(CacheSet));
 
-    for (int16_t i = 0; i <= newCache->nof_sets - 1; i++) {
+    for (uint32_t i = 0; i < newCache->nof_sets; i++) {
         newCache->sets[i].lines = (CacheLine *)calloc(newCache->nof_ways, sizeof(CacheLine));
     }
+    newCache->stat_set_access = (unsigned long long *)calloc(newCache->nof_sets, sizeof(unsigned long long));
+    newCache->stat_set_miss = (unsigned long long *)calloc(newCache->nof_sets, sizeof(unsigned long long));
+    newCache->stat_set_evict = (unsigned long long *)calloc(newCache->nof_sets, sizeof(unsigned long long));
 
     return (newCache);
 }
@@ -112,13 +121,23 @@ CacheResult cache_access(Cache *c, uint64_t line_addr, bool is_write,
     // TODO: If is_write is true, mark the resident line as dirty.
     // TODO: Update the appropriate cache statistics.
 
+    uint64_t host_start =
+        hostprof ? hostprof_begin(hostprof, HOST_STAGE_CACHE) : 0;
     CacheLocStats lineStats = findTagAngIndex(c, line_addr);
     CacheLine tempLine;
+
+    if (c->reuse) {
+        reuse_access(c->reuse, line_addr);
+    }
     uint8_t wayOffset = 255;
 
+    uint64_t index = lineStats.index;
+
     for (uint8_t i = 0; i < c->nof_ways; i++) {
-        if (c->sets[lineStats.index].lines[i].tag == lineStats.tag) {
-            tempLine = c->sets[lineStats.index].lines[i];
+        index = cache_set_index(c, line_addr, i);
+        if (c->sets[index].lines[i].valid &&
+            c->sets[index].lines[i].tag == lineStats.tag) {
+            tempLine = c->sets[index].lines[i];
             wayOffset = i;
             break;
         }
@@ -135,21 +154,28 @@ CacheResult cache_access(Cache *c, uint64_t line_addr, bool is_write,
         printf("\t\tindex: %ld, tag: %ld, is_write: %d, core_id: %d\n", lineStats.index, lineStats.tag, is_write, core_id);
     #endif
 
+    c->stat_set_access[lineStats.index]++;
+
     if (tempLine.valid) {
         if (is_write) {
-            c->sets[lineStats.index].lines[wayOffset].dirty = true;
+            c->sets[index].lines[wayOffset].dirty = true;
             c->stat_write_access++;
         } else {
             c->stat_read_access++;
         }
-        c->sets[lineStats.index].lines[wayOffset].LAT = current_cycle;
+        c->sets[index].lines[wayOffset].LAT = current_cycle;
+        c->sets[index].lines[wayOffset].hits++;
 
         #ifdef DEBUG
             printf("\t\tHit in the cache --> is_write: %d\n", is_write);
         #endif
 
+        if (host_start) {
+            hostprof_end(hostprof, HOST_STAGE_CACHE, host_start);
+        }
         return HIT;
     } else {
+        c->stat_set_miss[lineStats.index]++;
         if (is_write) {
             c->stat_write_access++;
             c->stat_write_miss++;
@@ -162,6 +188,9 @@ CacheResult cache_access(Cache *c, uint64_t line_addr, bool is_write,
             printf("\t\tMISS!\n");
         #endif
 
+        if (host_start) {
+            hostprof_end(hostprof, HOST_STAGE_CACHE, host_start);
+        }
         return MISS;
     }
     
@@ -196,15 +225,34 @@ void cache_install(Cache *c, uint64_t line_addr, bool is_write,
     #endif
 
 
-    uint64_t coreReplacement = cache_find_victim(c, lineStats.index, core_id);
-
+    uint64_t index = lineStats.index;
+    uint64_t coreReplacement;
+    uint64_t host_start =
+        hostprof ? hostprof_begin(hostprof, HOST_STAGE_VICTIM) : 0;
+    if (c->index_fn == INDEX_SKEW) {
+        coreReplacement = cache_find_skewed_victim(c, line_addr, &index);
+    } else {
+        coreReplacement = cache_find_victim(c, index, core_id);
+    }
+    if (host_start) {
+        hostprof_end(hostprof, HOST_STAGE_VICTIM, host_start);
+    }
 
-    if (c->sets[lineStats.index].lines[coreReplacement].valid) {
-        if (c->sets[lineStats.index].lines[coreReplacement].dirty & c->sets[lineStats.index].lines[coreReplacement].valid) {
-            c->LEL = c->sets[lineStats.index].lines[coreReplacement];
+    c->LEL.valid = false;
+    if (c->sets[index].lines[coreReplacement].valid) {
+        c->LEL = c->sets[index].lines[coreReplacement];
+        c->LEL_line_addr = cache_line_addr(c, &c->LEL, index);
+        c->stat_set_evict[index]++;
+        if (c->stat_evict_hits) {
+            latency_hist_record(c->stat_evict_hits, c->LEL.hits);
+            latency_hist_record(c->stat_dead_cycles,
+                                current_cycle - c->LEL.LAT);
+        }
+        if (c->sets[index].lines[coreReplacement].dirty & c->sets[index].lines[coreReplacement].valid) {
             #ifdef DEBUG
                 printf("\t\tVictim was dirty!\n");
             #endif
+            c->stat_dirty_evicts++;
         }
         #ifdef DEBUG
             if (NUM_CORES > 1) {
@@ -215,18 +263,23 @@ void cache_install(Cache *c, uint64_t line_addr, bool is_write,
         #endif
     }
 
-    c->sets[lineStats.index].lines[coreReplacement].valid = true;
-    c->sets[lineStats.index].lines[coreReplacement].core_id = core_id;
-    c->sets[lineStats.index].lines[coreReplacement].dirty = false;
-    c->sets[lineStats.index].lines[coreReplacement].LAT = current_cycle;
-    c->sets[lineStats.index].lines[coreReplacement].tag = lineStats.tag;
+    c->sets[index].lines[coreReplacement].valid = true;
+    c->sets[index].lines[coreReplacement].core_id = core_id;
+    c->sets[index].lines[coreReplacement].dirty = is_write;
+    c->sets[index].lines[coreReplacement].LAT = current_cycle;
+    c->sets[index].lines[coreReplacement].tag = lineStats.tag;
+    c->sets[index].lines[coreReplacement].shared = false;
+    c->sets[index].lines[coreReplacement].coh_invalidated = false;
+    c->sets[index].lines[coreReplacement].sector_valid = ~0u;
+    c->sets[index].lines[coreReplacement].sector_dirty = is_write ? ~0u : 0;
+    c->sets[index].lines[coreReplacement].hits = 0;
     
     #ifdef DEBUG
         printf("\t\tNew cache line installed (dirty: %d, tag: %lld, core_id: %d, last_access_time: %ld)\n", 
-                    c->sets[lineStats.index].lines[coreReplacement].dirty,
-                    c->sets[lineStats.index].lines[coreReplacement].tag,
-                    c->sets[lineStats.index].lines[coreReplacement].core_id,
-                    c->sets[lineStats.index].lines[coreReplacement].LAT);
+                    c->sets[index].lines[coreReplacement].dirty,
+                    c->sets[index].lines[coreReplacement].tag,
+                    c->sets[index].lines[coreReplacement].core_id,
+                    c->sets[index].lines[coreReplacement].LAT);
         
     #endif
 
@@ -280,12 +333,6 @@ unsigned int cache_find_victim(Cache *c, unsigned int set_index,
                 cycle_accessed = c->sets[set_index].lines[i].LAT;
             }
         }
-        if (least_recent == 999) {
-            return least_recent;
-        }
-        if (c->sets[set_index].lines[least_recent].dirty) {
-            c->stat_dirty_evicts++;
-        }
         return least_recent;
 
     } else if (c->rpl_pol == RANDOM) {
@@ -332,12 +379,323 @@ void cache_print_stats(Cache *c, const char *header)
 }
 
 
+bool cache_invalidate(Cache *c, uint64_t line_addr)
+{
+    CacheLocStats lineStats = findTagAngIndex(c, line_addr);
+
+    for (uint8_t i = 0; i < c->nof_ways; i++) {
+        CacheLine *line = &c->sets[cache_set_index(c, line_addr, i)].lines[i];
+        if (line->valid && line->tag == lineStats.tag) {
+            bool was_dirty = line->dirty;
+            line->valid = false;
+            line->dirty = false;
+            return was_dirty;
+        }
+    }
+
+    return false;
+}
+
+bool cache_set_dirty(Cache *c, uint64_t line_addr)
+{
+    CacheLocStats lineStats = findTagAngIndex(c, line_addr);
+
+    for (uint8_t i = 0; i < c->nof_ways; i++) {
+        CacheLine *line = &c->sets[cache_set_index(c, line_addr, i)].lines[i];
+        if (line->valid && line->tag == lineStats.tag) {
+            line->dirty = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool cache_probe(Cache *c, uint64_t line_addr)
+{
+    return cache_find_line(c, line_addr) != NULL;
+}
+
+CacheLine *cache_find_line(Cache *c, uint64_t line_addr)
+{
+    CacheLocStats lineStats = findTagAngIndex(c, line_addr);
+
+    for (uint8_t i = 0; i < c->nof_ways; i++) {
+        CacheLine *line = &c->sets[cache_set_index(c, line_addr, i)].lines[i];
+        if (line->valid && line->tag == lineStats.tag) {
+            return line;
+        }
+    }
+
+    return NULL;
+}
+
 CacheLocStats findTagAngIndex(Cache *c, uint64_t line_addr) {
     CacheLocStats lineStats;
-    uint64_t index_mask = (1 << (u_int64_t)log2(c->nof_sets)) - 1;
 
-    lineStats.index = line_addr & index_mask;
-    lineStats.tag = line_addr >> (u_int64_t)log2(c->nof_sets);
+    lineStats.index = cache_set_index(c, line_addr, 0);
+    if (c->index_fn == INDEX_MODULO) {
+        lineStats.tag = line_addr >> c->index_bits;
+    } else {
+        // A hashed index cannot be undone, so the tag keeps the whole address.
+        lineStats.tag = line_addr;
+    }
 
     return lineStats;
-}
\ No newline at end of file
+}
+
+void cache_set_index_fn(Cache *c, IndexFunction index_fn)
+{
+    c->index_fn = index_fn;
+    if (index_fn != INDEX_PRIME) {
+        return;
+    }
+
+    uint32_t nof_sets = c->nof_sets;
+    bool is_prime = false;
+    while (!is_prime && nof_sets > 2) {
+        is_prime = true;
+        for (uint32_t d = 2; d * d <= nof_sets; d++) {
+            if (nof_sets % d == 0) {
+                is_prime = false;
+                nof_sets--;
+                break;
+            }
+        }
+    }
+
+    #ifdef DEBUG
+        printf("Using %d of %d sets for prime-modulo indexing\n", nof_sets, c->nof_sets);
+    #endif
+
+    for (uint32_t i = nof_sets; i < c->nof_sets; i++) {
+        free(c->sets[i].lines);
+    }
+    c->nof_sets = nof_sets;
+}
+
+uint64_t cache_set_index(Cache *c, uint64_t line_addr, unsigned int way)
+{
+    uint64_t index_mask = ((uint64_t)1 << c->index_bits) - 1;
+    uint64_t folded = 0;
+
+    switch (c->index_fn) {
+        case INDEX_PRIME:
+            return line_addr % c->nof_sets;
+
+        case INDEX_XOR:
+        case INDEX_SKEW:
+            if (!c->index_bits) {
+                return 0;
+            }
+            for (uint64_t high = line_addr >> c->index_bits; high;
+                 high >>= c->index_bits) {
+                folded ^= high & index_mask;
+            }
+            if (c->index_fn == INDEX_SKEW) {
+                // Each way rotates the folded upper bits by a different amount.
+                unsigned int rot = way % c->index_bits;
+                folded = ((folded << rot) | (folded >> (c->index_bits - rot))) &
+                         index_mask;
+            }
+            return (line_addr ^ folded) & index_mask;
+
+        default:
+            return line_addr & index_mask;
+    }
+}
+
+uint64_t cache_line_addr(Cache *c, CacheLine *line, uint64_t set_index)
+{
+    if (c->index_fn != INDEX_MODULO) {
+        return line->tag;
+    }
+    return (line->tag << c->index_bits) | set_index;
+}
+
+unsigned int cache_find_skewed_victim(Cache *c, uint64_t line_addr,
+                                      uint64_t *set_index)
+{
+    unsigned int victim = 0;
+    uint64_t cycle_accessed = 0xFFFFFFFFFFFFFFFF;
+
+    for (unsigned int i = 0; i < c->nof_ways; i++) {
+        uint64_t index = cache_set_index(c, line_addr, i);
+        CacheLine *line = &c->sets[index].lines[i];
+        if (!line->valid) {
+            *set_index = index;
+            return i;
+        }
+        if (line->LAT < cycle_accessed) {
+            victim = i;
+            cycle_accessed = line->LAT;
+            *set_index = index;
+        }
+    }
+
+    return victim;
+}
+
+void cache_print_set_stats(Cache *c, const char *header)
+{
+    double access_avg = 0.0;
+    double miss_avg = 0.0;
+    double access_var = 0.0;
+    double miss_var = 0.0;
+    unsigned long long access_max = 0;
+    unsigned long long miss_max = 0;
+    unsigned long long hot_sets = 0;
+
+    for (uint32_t i = 0; i < c->nof_sets; i++) {
+        access_avg += (double)c->stat_set_access[i] / c->nof_sets;
+        miss_avg += (double)c->stat_set_miss[i] / c->nof_sets;
+        if (c->stat_set_access[i] > access_max) {
+            access_max = c->stat_set_access[i];
+        }
+        if (c->stat_set_miss[i] > miss_max) {
+            miss_max = c->stat_set_miss[i];
+        }
+    }
+
+    for (uint32_t i = 0; i < c->nof_sets; i++) {
+        double access_diff = c->stat_set_access[i] - access_avg;
+        double miss_diff = c->stat_set_miss[i] - miss_avg;
+        access_var += access_diff * access_diff / c->nof_sets;
+        miss_var += miss_diff * miss_diff / c->nof_sets;
+        if (c->stat_set_miss[i] > 2 * miss_avg) {
+            hot_sets++;
+        }
+    }
+
+    printf("\n");
+    printf("%s_SETS            \t\t : %10u\n", header, c->nof_sets);
+    printf("%s_SET_ACCESS_MAX  \t\t : %10llu\n", header, access_max);
+    printf("%s_SET_ACCESS_AVG  \t\t : %10.3f\n", header, access_avg);
+    printf("%s_SET_ACCESS_CV   \t\t : %10.3f\n", header,
+           access_avg ? sqrt(access_var) / access_avg : 0.0);
+    printf("%s_SET_MISS_MAX    \t\t : %10llu\n", header, miss_max);
+    printf("%s_SET_MISS_AVG    \t\t : %10.3f\n", header, miss_avg);
+    printf("%s_SET_MISS_CV     \t\t : %10.3f\n", header,
+           miss_avg ? sqrt(miss_var) / miss_avg : 0.0);
+    printf("%s_HOT_SETS        \t\t : %10llu\n", header, hot_sets);
+}
+
+/**
+ * Write the per-set counters of the given cache to a CSV file, one row per
+ * set, for plotting as a heatmap: the accesses, misses and evictions of the
+ * set, and how many of its lines each core holds at the end of the
+ * simulation.
+ *
+ * @param c The cache to write the counters of.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool cache_write_set_heatmap(Cache *c, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    fprintf(f, "set,access,miss,evict");
+    for (unsigned int core = 0; core < NUM_CORES; core++) {
+        fprintf(f, ",lines_core%d", core);
+    }
+    fprintf(f, "\n");
+
+    for (uint32_t i = 0; i < c->nof_sets; i++) {
+        fprintf(f, "%u,%llu,%llu,%llu", i, c->stat_set_access[i],
+                c->stat_set_miss[i], c->stat_set_evict[i]);
+        for (unsigned int core = 0; core < NUM_CORES; core++) {
+            unsigned int lines = 0;
+            for (uint8_t way = 0; way < c->nof_ways; way++) {
+                CacheLine *line = &c->sets[i].lines[way];
+                if (line->valid && line->core_id == core) {
+                    lines++;
+                }
+            }
+            fprintf(f, ",%u", lines);
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * Start recording the lifetime statistics of the given cache: the hits each
+ * evicted line received, how many cycles it stayed dead between its last
+ * access and its eviction, and the sampled reuse distances of the accesses.
+ *
+ * @param c The cache.
+ * @param sample_rate One in this many lines is tracked for reuse distances.
+ */
+void cache_enable_lifetime_stats(Cache *c, uint64_t sample_rate)
+{
+    c->stat_evict_hits = latency_hist_new();
+    c->stat_dead_cycles = latency_hist_new();
+    c->reuse = reuse_new(sample_rate);
+}
+
+/**
+ * Print the lifetime statistics of the given cache: the percentiles of the
+ * hits per evicted line, of the dead time of evicted lines and of the reuse
+ * distances; the share of evicted lines that were never hit; and the share
+ * of reuses whose distance fits in the cache's capacity.
+ *
+ * @param c The cache to print the statistics of.
+ * @param label A label for the cache, which is used as a prefix for each
+ *              statistic.
+ */
+void cache_print_lifetime_stats(Cache *c, const char *header)
+{
+    unsigned long long evicts = c->stat_evict_hits->count;
+    unsigned long long reuses = c->reuse->distances->count;
+    unsigned long long fits = latency_hist_count_at_most(
+        c->reuse->distances, (uint64_t)c->nof_sets * c->nof_ways - 1);
+
+    latency_hist_print_stats(c->stat_evict_hits, header, "EVICT_HITS");
+    printf("%s_DEAD_ON_ARRIVAL   \t\t : %10.3f\n", header,
+           evicts ? 100.0 * latency_hist_count_at_most(c->stat_evict_hits, 0)
+                    / evicts : 0.0);
+    latency_hist_print_stats(c->stat_dead_cycles, header, "DEAD_CYCLES");
+    latency_hist_print_stats(c->reuse->distances, header, "REUSE");
+    printf("%s_REUSE_COLD        \t\t : %10llu\n", header,
+           c->reuse->stat_cold);
+    printf("%s_REUSE_FIT_PERC    \t\t : %10.3f\n", header,
+           reuses ? 100.0 * fits / reuses : 0.0);
+}
+
+/**
+ * Register the statistics of the given cache: its accesses, misses, miss
+ * percentages and dirty evictions, and its lifetime statistics if enabled.
+ *
+ * @param c The cache.
+ * @param reg The registry to add the statistics to.
+ * @param group The dot-separated groups the statistics belong to.
+ */
+void cache_register_stats(Cache *c, StatsRegistry *reg, const char *group)
+{
+    unsigned int read_access = stats_add_ull(reg, group, "read_access",
+                                             &c->stat_read_access);
+    unsigned int read_miss = stats_add_ull(reg, group, "read_miss",
+                                           &c->stat_read_miss);
+    unsigned int write_access = stats_add_ull(reg, group, "write_access",
+                                              &c->stat_write_access);
+    unsigned int write_miss = stats_add_ull(reg, group, "write_miss",
+                                            &c->stat_write_miss);
+
+    stats_add_ratio(reg, group, "read_miss_perc", read_miss, read_access,
+                    100.0);
+    stats_add_ratio(reg, group, "write_miss_perc", write_miss, write_access,
+                    100.0);
+    stats_add_ull(reg, group, "dirty_evicts", &c->stat_dirty_evicts);
+
+    if (c->stat_evict_hits) {
+        stats_add_hist(reg, group, "evict_hits", c->stat_evict_hits);
+        stats_add_hist(reg, group, "dead_cycles", c->stat_dead_cycles);
+        stats_add_hist(reg, group, "reuse_distance", c->reuse->distances);
+        stats_add_ull(reg, group, "reuse_cold", &c->reuse->stat_cold);
+    }
+}
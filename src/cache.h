@@ -10,6 +10,8 @@
 #define __CACHE_H__
 
 #include "types.h"
+#include "reuse.h"
+#include "stats.h"
 // You may add any other #include directives you need here, but make sure they
 // compile on the reference machine!
 
@@ -48,6 +50,20 @@ typedef enum ReplacementPolicyEnum
     DWP = 3,
 } ReplacementPolicy;
 
+/** Possible functions mapping a line address to a cache set. */
+typedef enum IndexFunctionEnum
+{
+    INDEX_MODULO = 0, // Use the low bits of the line address.
+    INDEX_XOR = 1,    // XOR-fold the upper bits of the address into the low.
+    INDEX_PRIME = 2,  // Use the address modulo a prime number of sets.
+
+    /**
+     * Give each way its own XOR-folding hash (skewed associativity), so lines
+     * that conflict in one way are likely to be spread out in the others.
+     */
+    INDEX_SKEW = 3,
+} IndexFunction;
+
 // TODO: Define any other data structures you need here.
 // Refer to Appendix A for details on data structures you will need here.
 typedef struct CacheLine {
@@ -77,6 +93,31 @@ typedef struct CacheLine {
     * cache lines, which helps identify the LRU way
     */
     uint64_t LAT;
+
+    /*
+    * With coherence, denotes that other L1 caches may also hold this line
+    * (MESI S). A valid clean line that is not shared is in E, a dirty one in M
+    */
+    bool shared;
+
+    /*
+    * Denotes that this (now invalid) line was invalidated by another core's
+    * write, so a later miss on its tag is a coherence miss
+    */
+    bool coh_invalidated;
+
+    /*
+    * In a sectored cache level, one bit per sector of the line: whether the
+    * sector holds data, and whether it was written since it was filled. The
+    * line counts as dirty if any sector is
+    */
+    uint32_t sector_valid;
+    uint32_t sector_dirty;
+
+    /*
+    * The number of hits since the line was installed
+    */
+    uint32_t hits;
 } CacheLine;
 
 typedef struct CacheSet {
@@ -101,12 +142,21 @@ typedef struct Cache
 
     ReplacementPolicyEnum  rpl_pol;
 
-    uint16_t nof_sets;
+    uint32_t nof_sets;
+
+    // The function mapping line addresses to sets, and the number of index
+    // bits (log2 of the number of sets, rounded down). With any function but
+    // INDEX_MODULO, the tag of a line is its full line address.
+    IndexFunction index_fn;
+    uint8_t index_bits;
 
     // Last evicted line
     // To be passed on the next higher cache hierarchy
-    // for an install if necessary
+    // for an install if necessary.
+    // LEL.valid tells whether the last install evicted a valid line at all,
+    // and LEL_line_addr is the full line address of that line.
     CacheLine LEL;
+    uint64_t LEL_line_addr;
 
     /**
      * The total number of times this cache was accessed for a read.
@@ -137,6 +187,28 @@ typedef struct Cache
      * You should initialize this to 0 and update it for every dirty eviction!
      */
     unsigned long long stat_dirty_evicts;
+
+    /**
+     * The total number of accesses and misses in each set. A skewed cache
+     * counts them in the set the line maps to in way 0.
+     */
+    unsigned long long *stat_set_access;
+    unsigned long long *stat_set_miss;
+
+    /** The total number of valid lines evicted from each set. */
+    unsigned long long *stat_set_evict;
+
+    /**
+     * The number of hits each evicted line received, and the number of
+     * cycles between its last access and its eviction. NULL unless lifetime
+     * statistics are enabled.
+     */
+    LatencyHist *stat_evict_hits;
+    LatencyHist *stat_dead_cycles;
+
+    /** The sampled reuse distances, or NULL unless lifetime statistics are
+     * enabled. */
+    ReuseSampler *reuse;
 } Cache;
 
 /** Holds the tag and index for a Cache Line candidate */
@@ -267,4 +339,152 @@ void cache_print_stats(Cache *c, const char *label);
  */
 CacheLocStats findTagAngIndex(Cache *c, uint64_t line_addr);
 
+/**
+ * Invalidate the cache line with the given address, if it is present.
+ *
+ * Statistics are not updated; the caller is responsible for writing back the
+ * line if it was dirty.
+ *
+ * @param c The cache to invalidate the line in.
+ * @param line_addr The address of the cache line to invalidate (in units of
+ *                  the cache line size).
+ * @return Whether the invalidated line was dirty.
+ */
+bool cache_invalidate(Cache *c, uint64_t line_addr);
+
+/**
+ * Mark the resident cache line with the given address as dirty, without
+ * counting an access. Used when a line moves between caches with its dirty
+ * data.
+ *
+ * @param c The cache holding the line.
+ * @param line_addr The address of the cache line (in units of the cache line
+ *                  size).
+ * @return Whether the line was present in the cache.
+ */
+bool cache_set_dirty(Cache *c, uint64_t line_addr);
+
+/**
+ * Check whether the cache line with the given address is present, without
+ * counting an access or updating the replacement state.
+ *
+ * @param c The cache to look in.
+ * @param line_addr The address of the cache line (in units of the cache line
+ *                  size).
+ * @return Whether the line is present in the cache.
+ */
+bool cache_probe(Cache *c, uint64_t line_addr);
+
+/**
+ * Find the resident cache line with the given address, without counting an
+ * access or updating the replacement state.
+ *
+ * @param c The cache to look in.
+ * @param line_addr The address of the cache line (in units of the cache line
+ *                  size).
+ * @return The cache line, or NULL if it is not present.
+ */
+CacheLine *cache_find_line(Cache *c, uint64_t line_addr);
+
+/**
+ * Set the function the cache uses to map line addresses to sets. Must be
+ * called before the cache is first accessed. With INDEX_PRIME, the number of
+ * sets drops to the largest prime that is not larger.
+ *
+ * @param c The cache to set the index function of.
+ * @param index_fn The index function.
+ */
+void cache_set_index_fn(Cache *c, IndexFunction index_fn);
+
+/**
+ * Get the set that holds the given line in the given way. This is the same
+ * for every way unless the cache is skewed.
+ *
+ * @param c The cache.
+ * @param line_addr The address of the cache line (in units of the cache line
+ *                  size).
+ * @param way The way.
+ * @return The index of the set.
+ */
+uint64_t cache_set_index(Cache *c, uint64_t line_addr, unsigned int way);
+
+/**
+ * Get the address of the line held in the given set.
+ *
+ * @param c The cache.
+ * @param line A valid line of the cache.
+ * @param set_index The index of the set holding the line.
+ * @return The address of the cache line (in units of the cache line size).
+ */
+uint64_t cache_line_addr(Cache *c, CacheLine *line, uint64_t set_index);
+
+/**
+ * Find which way to replace in a skewed cache when installing the given line:
+ * an invalid way if the line's set in any way has one, or else the least
+ * recently used of the line's candidate ways.
+ *
+ * @param c The skewed cache to search.
+ * @param line_addr The address of the cache line to install (in units of the
+ *                  cache line size).
+ * @param set_index Set to the index of the set holding the victim way.
+ * @return The index of the victim way.
+ */
+unsigned int cache_find_skewed_victim(Cache *c, uint64_t line_addr,
+                                      uint64_t *set_index);
+
+/**
+ * Print how the accesses and misses of the given cache are spread over its
+ * sets: the maximum, average, and coefficient of variation per set, and the
+ * number of hot sets, which have more than twice the average misses.
+ *
+ * @param c The cache to print the statistics of.
+ * @param label A label for the cache, which is used as a prefix for each
+ *              statistic.
+ */
+void cache_print_set_stats(Cache *c, const char *label);
+
+/**
+ * Start recording the lifetime statistics of the given cache: the hits each
+ * evicted line received, how many cycles it stayed dead between its last
+ * access and its eviction, and the sampled reuse distances of the accesses.
+ *
+ * @param c The cache.
+ * @param sample_rate One in this many lines is tracked for reuse distances.
+ */
+void cache_enable_lifetime_stats(Cache *c, uint64_t sample_rate);
+
+/**
+ * Print the lifetime statistics of the given cache: the percentiles of the
+ * hits per evicted line, of the dead time of evicted lines and of the reuse
+ * distances; the share of evicted lines that were never hit; and the share
+ * of reuses whose distance fits in the cache's capacity.
+ *
+ * @param c The cache to print the statistics of.
+ * @param label A label for the cache, which is used as a prefix for each
+ *              statistic.
+ */
+void cache_print_lifetime_stats(Cache *c, const char *label);
+
+/**
+ * Write the per-set counters of the given cache to a CSV file, one row per
+ * set, for plotting as a heatmap: the accesses, misses and evictions of the
+ * set, and how many of its lines each core holds at the end of the
+ * simulation.
+ *
+ * @param c The cache to write the counters of.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool cache_write_set_heatmap(Cache *c, const char *path);
+
+/**
+ * Register the statistics of the given cache: its accesses, misses, miss
+ * percentages and dirty evictions, and its lifetime statistics if enabled.
+ *
+ * @param c The cache.
+ * @param reg The registry to add the statistics to.
+ * @param group The dot-separated groups the statistics belong to.
+ */
+void cache_register_stats(Cache *c, StatsRegistry *reg, const char *group);
+
 #endif // __CACHE_H__
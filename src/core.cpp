@@ -6,6 +6,8 @@
 // Defines the functions for the CPU cores.
 
 #include "core.h"
+#include "hostprof.h"
+#include "tracegen.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,16 +15,37 @@
 #include <unistd.h>
 
 extern uint64_t current_cycle;
+extern uint64_t CACHE_LINESIZE;
+extern CoreModel CORE_MODEL;
+extern unsigned int CORE_WIDTH;
+extern unsigned int ROB_SIZE;
+extern unsigned int LQ_SIZE;
+extern unsigned int SQ_SIZE;
+extern unsigned int SB_SIZE;
+extern unsigned int FETCH_LINES;
+extern unsigned int LOAD_PORTS;
+extern unsigned int STORE_PORTS;
+extern HostProfile *hostprof;
 
 int open_gunzip_pipe(const char *filename, int *fd, pid_t *pid);
-ssize_t trace_read(Core *core, void *buf, size_t size);
+int open_tracegen_pipe(const char *spec, int *fd, pid_t *pid);
 
 Core *core_new(MemorySystem *memsys, const char *trace_filename,
                unsigned int core_id)
 {
     int trace_fd;
     pid_t pid;
-    if (open_gunzip_pipe(trace_filename, &trace_fd, &pid) != 0)
+    int status;
+    if (strncmp(trace_filename, TRACEGEN_PREFIX,
+                strlen(TRACEGEN_PREFIX)) == 0)
+    {
+        status = open_tracegen_pipe(trace_filename, &trace_fd, &pid);
+    }
+    else
+    {
+        status = open_gunzip_pipe(trace_filename, &trace_fd, &pid);
+    }
+    if (status != 0)
     {
         return NULL;
     }
@@ -35,59 +58,342 @@ Core *core_new(MemorySystem *memsys, const char *trace_filename,
     core->read_buf_offset = 0;
     core->read_buf_left = 0;
 
+    if (CORE_MODEL == CORE_MODEL_OOO)
+    {
+        core->rob = (RobEntry *)calloc(ROB_SIZE, sizeof(RobEntry));
+    }
+
+    if (SB_SIZE)
+    {
+        core->sb = storebuf_new(SB_SIZE);
+    }
+
     core_read_trace(core);
     return core;
 }
 
 void core_cycle(Core *core)
 {
+    if (CORE_MODEL == CORE_MODEL_OOO)
+    {
+        core_cycle_ooo(core);
+        return;
+    }
+
     if (core->done)
     {
         return;
     }
 
+    if (core->sb)
+    {
+        storebuf_drain(core->sb, core->memsys, core->core_id);
+
+        // The core is done once the stores left in the buffer have drained.
+        if (core->trace_done)
+        {
+            if (core->sb->count == 0)
+            {
+                core_mark_done(core);
+            }
+            return;
+        }
+    }
+
     // If core is snoozing on DRAM hits, return.
     if (current_cycle <= core->snooze_end_cycle)
     {
         return;
     }
 
-    core->inst_count++;
+    // Consume up to CORE_WIDTH records in order. The group ends early when
+    // a record runs out of fetch or port bandwidth, or stalls on a miss.
+    IssueGroup group = {};
+    while (!core->trace_done && core_issue_slot(core, &group, true))
+    {
+        // A store that finds the store buffer full stalls the core and
+        // retries on the next cycle.
+        if (core->sb && core->trace_inst_type == INST_TYPE_STORE &&
+            !storebuf_insert(core->sb, core->trace_ldst_addr))
+        {
+            return;
+        }
+
+        core->inst_count++;
+
+        uint64_t ifetch_delay = 0;
+        uint64_t ld_delay = 0;
+        uint64_t bubble_cycles = 0;
+
+        ifetch_delay = memsys_access(core->memsys, core->trace_inst_addr,
+                                     ACCESS_TYPE_IFETCH, core->core_id);
+        if (ifetch_delay > 1)
+        {
+            bubble_cycles += (ifetch_delay - 1);
+        }
+
+        if (core->trace_inst_type == INST_TYPE_LOAD &&
+            !(core->sb && storebuf_forward(core->sb, core->trace_ldst_addr)))
+        {
+            ld_delay = memsys_access(core->memsys, core->trace_ldst_addr,
+                                     ACCESS_TYPE_LOAD, core->core_id);
+        }
+        if (ld_delay > 1)
+        {
+            bubble_cycles += (ld_delay - 1);
+        }
+
+        if (core->trace_inst_type == INST_TYPE_STORE && !core->sb)
+        {
+            memsys_access(core->memsys, core->trace_ldst_addr,
+                          ACCESS_TYPE_STORE, core->core_id);
+        }
+        // We don't incur bubbles for store misses.
+
+        core_read_trace(core);
 
-    uint64_t ifetch_delay = 0;
-    uint64_t ld_delay = 0;
-    uint64_t bubble_cycles = 0;
+        if (bubble_cycles)
+        {
+            core->snooze_end_cycle = current_cycle + bubble_cycles;
+            return;
+        }
+    }
+}
 
-    ifetch_delay = memsys_access(core->memsys, core->trace_inst_addr,
-                                 ACCESS_TYPE_IFETCH, core->core_id);
-    if (ifetch_delay > 1)
+// Check whether the current trace record fits in this cycle's issue group
+// and, if so, charge it to the group. A group holds at most CORE_WIDTH
+// records, fetched from at most FETCH_LINES distinct icache lines, with at
+// most LOAD_PORTS loads and (if uses_store_port) STORE_PORTS stores. The
+// first record of a cycle always fits.
+bool core_issue_slot(Core *core, IssueGroup *group, bool uses_store_port)
+{
+    if (group->slots == CORE_WIDTH)
     {
-        bubble_cycles += (ifetch_delay - 1);
+        return false;
     }
 
-    if (core->trace_inst_type == INST_TYPE_LOAD)
+    uint64_t inst_line = core->trace_inst_addr / CACHE_LINESIZE;
+    bool new_line = (group->slots == 0 || inst_line != group->fetch_line);
+    if (new_line && group->fetch_lines == FETCH_LINES)
+    {
+        core->stat_fetch_limited++;
+        return false;
+    }
+
+    if (core->trace_inst_type == INST_TYPE_LOAD &&
+        group->loads == LOAD_PORTS)
     {
-        ld_delay = memsys_access(core->memsys, core->trace_ldst_addr,
-                                 ACCESS_TYPE_LOAD, core->core_id);
+        core->stat_port_limited++;
+        return false;
     }
-    if (ld_delay > 1)
+
+    if (uses_store_port && core->trace_inst_type == INST_TYPE_STORE &&
+        group->stores == STORE_PORTS)
     {
-        bubble_cycles += (ld_delay - 1);
+        core->stat_port_limited++;
+        return false;
     }
 
+    group->slots++;
+    if (new_line)
+    {
+        group->fetch_lines++;
+        group->fetch_line = inst_line;
+    }
+    if (core->trace_inst_type == INST_TYPE_LOAD)
+    {
+        group->loads++;
+    }
     if (core->trace_inst_type == INST_TYPE_STORE)
     {
-        memsys_access(core->memsys, core->trace_ldst_addr, ACCESS_TYPE_STORE,
-                      core->core_id);
+        group->stores++;
     }
-    // We don't incur bubbles for store misses.
+    return true;
+}
 
-    if (bubble_cycles)
+// Out-of-order variant of core_cycle(). Up to CORE_WIDTH instructions retire
+// in order from the ROB and up to CORE_WIDTH new trace records are dispatched
+// each cycle. Loads access memory at dispatch and complete when their data
+// returns, so independent load misses overlap. Stores write to memory when
+// they retire. Dispatch stops when the ROB, load queue or store queue is full
+// or the fetch/load port bandwidth of core_issue_slot() runs out, and fetch
+// stalls on icache misses as in the in-order model. At most STORE_PORTS
+// stores retire per cycle. A load that hits the line of an older store is
+// forwarded its data, from the store queue while the store is in flight and
+// from the store buffer once it retires.
+void core_cycle_ooo(Core *core)
+{
+    if (core->done)
     {
-        core->snooze_end_cycle = current_cycle + bubble_cycles;
+        return;
     }
 
-    core_read_trace(core);
+    if (core->sb)
+    {
+        storebuf_drain(core->sb, core->memsys, core->core_id);
+    }
+
+    unsigned int retired_stores = 0;
+    for (unsigned int i = 0; i < CORE_WIDTH && core->rob_count; i++)
+    {
+        RobEntry *entry = &core->rob[core->rob_head];
+        if (entry->done_cycle > current_cycle)
+        {
+            break;
+        }
+
+        if (entry->inst_type == INST_TYPE_STORE &&
+            retired_stores == STORE_PORTS)
+        {
+            break;
+        }
+
+        // A store that finds the store buffer full blocks retirement.
+        if (entry->inst_type == INST_TYPE_STORE && core->sb &&
+            !storebuf_insert(core->sb, entry->ldst_addr))
+        {
+            break;
+        }
+
+        if (entry->inst_type == INST_TYPE_LOAD)
+        {
+            core->lq_count--;
+        }
+
+        if (entry->inst_type == INST_TYPE_STORE)
+        {
+            if (!core->sb)
+            {
+                core->memsys->inst_addr_coreid[core->core_id] =
+                    entry->inst_addr;
+                memsys_access(core->memsys, entry->ldst_addr,
+                              ACCESS_TYPE_STORE, core->core_id);
+                core->memsys->inst_addr_coreid[core->core_id] =
+                    core->trace_inst_addr;
+            }
+            core->sq_count--;
+            retired_stores++;
+        }
+
+        core->rob_head = (core->rob_head + 1) % ROB_SIZE;
+        core->rob_count--;
+    }
+
+    if (core->trace_done)
+    {
+        if (core->rob_count == 0 && (!core->sb || core->sb->count == 0))
+        {
+            core_mark_done(core);
+        }
+        return;
+    }
+
+    // If fetch is stalled on an icache miss, only retire this cycle.
+    if (current_cycle <= core->snooze_end_cycle)
+    {
+        return;
+    }
+
+    IssueGroup group = {};
+    while (!core->trace_done)
+    {
+        if (core->rob_count == ROB_SIZE)
+        {
+            core->stat_rob_full_stalls++;
+            break;
+        }
+
+        if (core->trace_inst_type == INST_TYPE_LOAD &&
+            core->lq_count == LQ_SIZE)
+        {
+            core->stat_lq_full_stalls++;
+            break;
+        }
+
+        if (core->trace_inst_type == INST_TYPE_STORE &&
+            core->sq_count == SQ_SIZE)
+        {
+            core->stat_sq_full_stalls++;
+            break;
+        }
+
+        if (!core_issue_slot(core, &group, false))
+        {
+            break;
+        }
+
+        core->inst_count++;
+
+        uint64_t ifetch_delay = memsys_access(core->memsys,
+                                              core->trace_inst_addr,
+                                              ACCESS_TYPE_IFETCH,
+                                              core->core_id);
+        uint64_t exec_delay = 1;
+
+        if (core->trace_inst_type == INST_TYPE_LOAD)
+        {
+            if (!core_sq_forward(core, core->trace_ldst_addr) &&
+                !(core->sb &&
+                  storebuf_forward(core->sb, core->trace_ldst_addr)))
+            {
+                uint64_t ld_delay = memsys_access(core->memsys,
+                                                  core->trace_ldst_addr,
+                                                  ACCESS_TYPE_LOAD,
+                                                  core->core_id);
+                if (ld_delay > 1)
+                {
+                    exec_delay = ld_delay;
+                }
+            }
+            core->lq_count++;
+        }
+
+        if (core->trace_inst_type == INST_TYPE_STORE)
+        {
+            core->sq_count++;
+        }
+
+        unsigned int tail = (core->rob_head + core->rob_count) % ROB_SIZE;
+        core->rob[tail].done_cycle = current_cycle + exec_delay;
+        core->rob[tail].inst_type = core->trace_inst_type;
+        core->rob[tail].ldst_addr = core->trace_ldst_addr;
+        core->rob[tail].inst_addr = core->trace_inst_addr;
+        core->rob_count++;
+
+        core_read_trace(core);
+
+        if (ifetch_delay > 1)
+        {
+            core->snooze_end_cycle = current_cycle + ifetch_delay - 1;
+            break;
+        }
+    }
+}
+
+// Check whether a load can be forwarded from a store still in the ROB, i.e.,
+// whether one of the sq_count stores in flight covers the same cache line.
+// Every ROB entry is older than the load being dispatched.
+bool core_sq_forward(Core *core, uint64_t addr)
+{
+    uint64_t line_addr = addr / CACHE_LINESIZE;
+    unsigned int stores_left = core->sq_count;
+
+    for (unsigned int i = core->rob_count; i > 0 && stores_left; i--)
+    {
+        RobEntry *entry = &core->rob[(core->rob_head + i - 1) % ROB_SIZE];
+        if (entry->inst_type != INST_TYPE_STORE)
+        {
+            continue;
+        }
+        if (entry->ldst_addr / CACHE_LINESIZE == line_addr)
+        {
+            core->stat_sq_forwards++;
+            return true;
+        }
+        stores_left--;
+    }
+
+    return false;
 }
 
 void core_read_trace(Core *core)
@@ -95,6 +401,8 @@ void core_read_trace(Core *core)
     uint32_t inst_addr;
     uint8_t inst_type;
     uint32_t ldst_addr;
+    uint64_t host_start =
+        hostprof ? hostprof_begin(hostprof, HOST_STAGE_TRACE) : 0;
 
     if (trace_read(core, &inst_addr, sizeof(inst_addr)) !=
             sizeof(inst_addr) ||
@@ -103,14 +411,91 @@ void core_read_trace(Core *core)
         trace_read(core, &ldst_addr, sizeof(ldst_addr)) !=
             sizeof(ldst_addr))
     {
-        core->done = true;
-        core->done_inst_count = core->inst_count;
-        core->done_cycle_count = current_cycle;
+        core->trace_done = true;
+
+        // An out-of-order core is done only after its ROB drains, and any
+        // core with a store buffer only after the buffer drains.
+        if (CORE_MODEL != CORE_MODEL_OOO && !core->sb)
+        {
+            core_mark_done(core);
+        }
     }
 
     core->trace_inst_addr = inst_addr;
     core->trace_inst_type = inst_type;
     core->trace_ldst_addr = ldst_addr;
+
+    // The memory accesses of the record are profiled under its address.
+    core->memsys->inst_addr_coreid[core->core_id] = inst_addr;
+
+    if (host_start)
+    {
+        hostprof_end(hostprof, HOST_STAGE_TRACE, host_start);
+    }
+}
+
+void core_mark_done(Core *core)
+{
+    core->done = true;
+    core->done_inst_count = core->inst_count;
+    core->done_cycle_count = current_cycle;
+}
+
+// run_cycles counts the cycles the core's trace actually ran, for a process
+// time-sliced by the scheduler, or is NULL if it runs every cycle.
+void core_register_stats(Core *core, StatsRegistry *reg, const char *group,
+                         const unsigned long long *run_cycles)
+{
+    // inst, cycles and ipc are live, so snapshots taken mid-run show them.
+    unsigned int insts = stats_add_ull(reg, group, "inst", &core->inst_count);
+    if (run_cycles)
+    {
+        // The run cycles stop when the process finishes.
+        unsigned int cycles = stats_add_ull(reg, group, "cycles",
+                                            run_cycles);
+        stats_add_ratio(reg, group, "ipc", insts, cycles, 1.0);
+        stats_add_ull(reg, group, "done_cycles", &core->done_cycle_count);
+    }
+    else
+    {
+        // inst_count stops when the core finishes, but the global cycle
+        // count does not, so the cycles and IPC at completion are kept
+        // apart.
+        unsigned int cycles = stats_add_u64(reg, group, "cycles",
+                                            &current_cycle);
+        stats_add_ratio(reg, group, "ipc", insts, cycles, 1.0);
+        unsigned int done_cycles = stats_add_ull(reg, group, "done_cycles",
+                                                 &core->done_cycle_count);
+        stats_add_ratio(reg, group, "done_ipc", insts, done_cycles, 1.0);
+    }
+
+    if (CORE_MODEL == CORE_MODEL_OOO)
+    {
+        stats_add_ull(reg, group, "rob_full_stalls",
+                      &core->stat_rob_full_stalls);
+        stats_add_ull(reg, group, "lq_full_stalls",
+                      &core->stat_lq_full_stalls);
+        stats_add_ull(reg, group, "sq_full_stalls",
+                      &core->stat_sq_full_stalls);
+        stats_add_ull(reg, group, "sq_forwards", &core->stat_sq_forwards);
+    }
+
+    if (CORE_WIDTH > 1)
+    {
+        stats_add_ull(reg, group, "fetch_limited", &core->stat_fetch_limited);
+        stats_add_ull(reg, group, "port_limited", &core->stat_port_limited);
+    }
+
+    if (core->sb)
+    {
+        char sb_group[64];
+        snprintf(sb_group, sizeof(sb_group), "%s.storebuf", group);
+        stats_add_ull(reg, sb_group, "stores", &core->sb->stat_stores);
+        stats_add_ull(reg, sb_group, "coalesced", &core->sb->stat_coalesced);
+        stats_add_ull(reg, sb_group, "full_stalls",
+                      &core->sb->stat_full_stalls);
+        stats_add_ull(reg, sb_group, "forwards", &core->sb->stat_forwards);
+    }
 }
 
 void core_print_stats(Core *core)
@@ -129,6 +514,36 @@ void core_print_stats(Core *core)
            core->done_cycle_count);
     printf("CORE_%01d_IPC          \t\t : %10.3f\n", core->core_id, ipc);
 
+    if (CORE_MODEL == CORE_MODEL_OOO)
+    {
+        printf("CORE_%01d_ROB_FULL_STALLS\t\t : %10llu\n", core->core_id,
+               core->stat_rob_full_stalls);
+        printf("CORE_%01d_LQ_FULL_STALLS\t\t : %10llu\n", core->core_id,
+               core->stat_lq_full_stalls);
+        printf("CORE_%01d_SQ_FULL_STALLS\t\t : %10llu\n", core->core_id,
+               core->stat_sq_full_stalls);
+        printf("CORE_%01d_SQ_FORWARDS \t\t : %10llu\n", core->core_id,
+               core->stat_sq_forwards);
+    }
+
+    if (CORE_WIDTH > 1)
+    {
+        printf("CORE_%01d_FETCH_LIMITED\t\t : %10llu\n", core->core_id,
+               core->stat_fetch_limited);
+        printf("CORE_%01d_PORT_LIMITED \t\t : %10llu\n", core->core_id,
+               core->stat_port_limited);
+    }
+
+    if (core->sb)
+    {
+        storebuf_print_stats(core->sb, core->core_id);
+    }
+
+    core_close_trace(core);
+}
+
+void core_close_trace(Core *core)
+{
     close(core->trace_fd);
     waitpid(core->pid, NULL, 0);
 }
@@ -172,6 +587,49 @@ int open_gunzip_pipe(const char *filename, int *fd, pid_t *pid)
     return 0;
 }
 
+// Generate the trace in a child process that feeds the pipe, as gunzip does
+// for trace files.
+int open_tracegen_pipe(const char *spec, int *fd, pid_t *pid)
+{
+    TraceGenSpec gen_spec;
+    int pipefd[2];
+
+    if (!tracegen_parse(spec, &gen_spec))
+    {
+        return 1;
+    }
+
+    if (pipe(pipefd) != 0)
+    {
+        perror("Couldn't create pipe");
+        return 1;
+    }
+
+    *pid = fork();
+    if (*pid == -1)
+    {
+        perror("Couldn't fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return 1;
+    }
+
+    if (*pid == 0)
+    {
+        // Child process: write the records until the trace ends or the
+        // simulator stops reading.
+        close(pipefd[0]);
+        tracegen_write(tracegen_new(&gen_spec), pipefd[1]);
+        close(pipefd[1]);
+        _exit(0);
+    }
+
+    // Parent process: return the read end of the pipe.
+    *fd = pipefd[0];
+    close(pipefd[1]);
+    return 0;
+}
+
 ssize_t trace_read(Core *core, void *buf, size_t size)
 {
     uint8_t *bytes = (uint8_t *)buf;
@@ -10,8 +10,42 @@
 
 #include "types.h"
 #include "memsys.h"
+#include "storebuf.h"
 #include <sys/types.h>
 
+/** Possible timing models for a CPU core. */
+typedef enum CoreModelEnum
+{
+    CORE_MODEL_INORDER = 0, // Blocking in-order core that stalls on misses.
+    CORE_MODEL_OOO = 1,     // Out-of-order core with a ROB and LSQ.
+} CoreModel;
+
+/** An in-flight instruction in the reorder buffer of an out-of-order core. */
+typedef struct RobEntry
+{
+    /** The cycle at which the instruction has finished executing. */
+    uint64_t done_cycle;
+
+    /** The type of the instruction (one of InstType). */
+    uint8_t inst_type;
+
+    /** The load/store address, used by stores when they retire. */
+    uint64_t ldst_addr;
+
+    /** The instruction address, which retiring stores are profiled under. */
+    uint64_t inst_addr;
+} RobEntry;
+
+/** The resources used so far by the records a core issues in one cycle. */
+typedef struct IssueGroup
+{
+    unsigned int slots;
+    unsigned int fetch_lines;
+    uint64_t fetch_line;
+    unsigned int loads;
+    unsigned int stores;
+} IssueGroup;
+
 typedef struct Core
 {
     unsigned int core_id;
@@ -25,6 +59,8 @@ typedef struct Core
     ssize_t read_buf_left;
 
     bool done;
+    // Set once the trace is exhausted; the core is done once it also drains.
+    bool trace_done;
 
     uint64_t trace_inst_addr;
     uint64_t trace_inst_type;
@@ -33,6 +69,28 @@ typedef struct Core
     // Used to stall when waiting for data to return from memory.
     uint64_t snooze_end_cycle;
 
+    // Out-of-order state, only used with CORE_MODEL_OOO. The ROB is a
+    // circular buffer of ROB_SIZE entries.
+    RobEntry *rob;
+    unsigned int rob_head;
+    unsigned int rob_count;
+    unsigned int lq_count;
+    unsigned int sq_count;
+
+    unsigned long long stat_rob_full_stalls;
+    unsigned long long stat_lq_full_stalls;
+    unsigned long long stat_sq_full_stalls;
+    unsigned long long stat_sq_forwards;
+
+    // Cycles in which issue stopped short of CORE_WIDTH because the next
+    // record needed another icache line or a busy load/store port.
+    unsigned long long stat_fetch_limited;
+    unsigned long long stat_port_limited;
+
+    // Store buffer between retired stores and the dcache. NULL if disabled,
+    // in which case stores access the memory system synchronously.
+    StoreBuffer *sb;
+
     unsigned long long inst_count;
     unsigned long long done_inst_count;
     unsigned long long done_cycle_count;
@@ -41,7 +99,15 @@ typedef struct Core
 Core *core_new(MemorySystem *memsys, const char *trace_filename,
                unsigned int core_id);
 void core_cycle(Core *core);
+void core_cycle_ooo(Core *core);
+bool core_issue_slot(Core *core, IssueGroup *group, bool uses_store_port);
+bool core_sq_forward(Core *core, uint64_t addr);
 void core_print_stats(Core *core);
+void core_close_trace(Core *core);
 void core_read_trace(Core *core);
+ssize_t trace_read(Core *core, void *buf, size_t size);
+void core_mark_done(Core *core);
+void core_register_stats(Core *core, StatsRegistry *reg, const char *group,
+                         const unsigned long long *run_cycles);
 
 #endif // __CORE_H__
@@ -39,9 +39,6 @@
 /** The row buffer size, in bytes. */
 #define ROW_BUFFER_SIZE 1024
 
-/** The number of banks in the DRAM module. */
-#define NUM_BANKS 16
-
 ///////////////////////////////////////////////////////////////////////////////
 //                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
 ///////////////////////////////////////////////////////////////////////////////
@@ -58,6 +55,18 @@ extern uint64_t CACHE_LINESIZE;
 /** Which page policy the DRAM should use. */
 extern DRAMPolicy DRAM_PAGE_POLICY;
 
+/**
+ * The capacity of DRAM in bytes when it acts as a memory-side cache in front
+ * of the far-memory tier. 0 disables the far-memory tier.
+ */
+extern uint64_t DRAMCACHE_SIZE;
+
+/** The associativity of the DRAM cache. */
+extern uint64_t DRAMCACHE_ASSOC;
+
+/** The granularity, in bytes, at which data migrates between the tiers. */
+extern uint64_t DRAMCACHE_BLOCKSIZE;
+
 ///////////////////////////////////////////////////////////////////////////////
 //                           FUNCTION DEFINITIONS                            //
 ///////////////////////////////////////////////////////////////////////////////
@@ -83,12 +92,18 @@ DRAM *dram_new()
         printf("Creating DRAM!\n");
     #endif
 
-    DRAM *newDRAM = (DRAM *)malloc(sizeof(DRAM));
-    newDRAM->rows = (RowbufEntry *) calloc(CACHE_LINESIZE, sizeof(RowbufEntry));
+    DRAM *newDRAM = (DRAM *)calloc(1, sizeof(DRAM));
+    newDRAM->rows = (RowbufEntry *) calloc(NUM_BANKS, sizeof(RowbufEntry));
     newDRAM->stat_read_access = 0;
     newDRAM->stat_read_delay = 0;
     newDRAM->stat_write_access = 0;
     newDRAM->stat_write_delay = 0;
+
+    if (DRAMCACHE_SIZE) {
+        newDRAM->tier_tags = cache_new(DRAMCACHE_SIZE, DRAMCACHE_ASSOC,
+                                       DRAMCACHE_BLOCKSIZE, LRU);
+        newDRAM->farmem = farmem_new();
+    }
     return newDRAM;
 }
 
@@ -126,6 +141,16 @@ uint64_t dram_access(DRAM *dram, uint64_t line_addr, bool is_dram_write)
         dram->stat_read_access++;
     }
 
+    if (dram->farmem) {
+        delay = dram_access_tiered(dram, line_addr, is_dram_write);
+        if (is_dram_write) {
+            dram->stat_write_delay += delay;
+        } else {
+            dram->stat_read_delay += delay;
+        }
+        return delay;
+    }
+
     if (SIM_MODE == SIM_MODE_A || SIM_MODE == SIM_MODE_B) {
         delay = DELAY_SIM_MODE_B;
         if (is_dram_write) {
@@ -175,9 +200,119 @@ uint64_t dram_access_mode_CDEF(DRAM *dram, uint64_t line_addr,
 {
     // Assume a mapping with consecutive lines in the same row and consecutive
     // row buffers in consecutive rows.
-    // TODO: Use this function to track open rows.
-    // TODO: Compute the delay based on row buffer hit/miss/empty.
-    return 0;
+    uint64_t row_buffer_id = line_addr / (ROW_BUFFER_SIZE / CACHE_LINESIZE);
+    uint64_t bank_index = row_buffer_id % NUM_BANKS;
+    uint64_t row_index = row_buffer_id / NUM_BANKS;
+
+    dram->stat_bank_access[bank_index]++;
+
+    #ifdef DEBUG
+        printf("\t\tbank index: %ld, row index: %ld\n", bank_index, row_index);
+    #endif
+
+    if (DRAM_PAGE_POLICY == CLOSE_PAGE) {
+        #ifdef DEBUG
+            printf("\t\tUsing CLOSE_PAGE policy!\n");
+        #endif
+        dram->stat_bank_busy[bank_index] += DELAY_ACT + DELAY_CAS + DELAY_BUS;
+        return DELAY_ACT + DELAY_CAS + DELAY_BUS;
+    }
+
+    #ifdef DEBUG
+        printf("\t\tUsing OPEN_PAGE policy!\n");
+    #endif
+
+    RowbufEntry *bank = &dram->rows[bank_index];
+    if (bank->valid) {
+        #ifdef DEBUG
+            printf("\t\tValid bank found!\n");
+        #endif
+        if (bank->rowID == row_index) {
+            #ifdef DEBUG
+                printf("\t\tRow index matched!\n");
+            #endif
+            dram->stat_bank_row_hits[bank_index]++;
+            dram->stat_bank_busy[bank_index] += DELAY_CAS + DELAY_BUS;
+            return DELAY_CAS + DELAY_BUS;
+        }
+
+        #ifdef DEBUG
+            printf("\t\tRow did not match! Updating row index.\n");
+        #endif
+        bank->rowID = row_index;
+        dram->stat_bank_row_conflicts[bank_index]++;
+        dram->stat_bank_busy[bank_index] +=
+            DELAY_PRE + DELAY_ACT + DELAY_CAS + DELAY_BUS;
+        return DELAY_PRE + DELAY_ACT + DELAY_CAS + DELAY_BUS;
+    }
+
+    #ifdef DEBUG
+        printf("\t\tBank not valid! Setting to valid and updating row index.\n");
+    #endif
+    bank->valid = true;
+    bank->rowID = row_index;
+    dram->stat_bank_busy[bank_index] += DELAY_ACT + DELAY_CAS + DELAY_BUS;
+    return DELAY_ACT + DELAY_CAS + DELAY_BUS;
+}
+
+/**
+ * Access the DRAM at the given cache line address when DRAM acts as a
+ * memory-side cache in front of the far-memory tier.
+ *
+ * DRAM is managed at DRAMCACHE_BLOCKSIZE granularity. Reads that miss migrate
+ * the whole block from the far-memory tier and may write a dirty victim block
+ * back to it. Writes that miss bypass DRAM and go straight to the far-memory
+ * tier.
+ *
+ * @param dram The DRAM module to access.
+ * @param line_addr The address of the cache line to access (in units of the
+ *                  cache line size).
+ * @param is_dram_write Whether this access writes to DRAM.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t dram_access_tiered(DRAM *dram, uint64_t line_addr,
+                            bool is_dram_write)
+{
+    uint64_t lines_per_block = DRAMCACHE_BLOCKSIZE / CACHE_LINESIZE;
+    uint64_t block_addr = line_addr / lines_per_block;
+    uint64_t delay = 0;
+
+    CacheResult outcome = cache_access(dram->tier_tags, block_addr,
+                                       is_dram_write, 0);
+
+    if (outcome == HIT) {
+        if (SIM_MODE == SIM_MODE_A || SIM_MODE == SIM_MODE_B) {
+            delay = DELAY_SIM_MODE_B;
+        } else {
+            delay = dram_access_mode_CDEF(dram, line_addr, is_dram_write);
+        }
+        dram->stat_near_access++;
+        dram->stat_near_delay += delay;
+        return delay;
+    }
+
+    if (is_dram_write) {
+        // No write-allocate: the line goes straight to the far-memory tier.
+        return farmem_access(dram->farmem, CACHE_LINESIZE, true);
+    }
+
+    #ifdef DEBUG
+        printf("\t\tDRAM cache miss! Migrating block %ld from far memory\n", block_addr);
+    #endif
+
+    delay = farmem_access(dram->farmem, DRAMCACHE_BLOCKSIZE, false);
+    dram->farmem->stat_migrate_in_bytes += DRAMCACHE_BLOCKSIZE;
+
+    // If num of dirty evicts goes up, the victim block has to be migrated
+    // back. The writeback only consumes far-memory bandwidth.
+    uint64_t nof_dirty_evicts = dram->tier_tags->stat_dirty_evicts;
+    cache_install(dram->tier_tags, block_addr, false, 0);
+    if (nof_dirty_evicts != dram->tier_tags->stat_dirty_evicts) {
+        farmem_access(dram->farmem, DRAMCACHE_BLOCKSIZE, true);
+        dram->farmem->stat_migrate_out_bytes += DRAMCACHE_BLOCKSIZE;
+    }
+
+    return delay;
 }
 
 /**
@@ -209,4 +344,122 @@ void dram_print_stats(DRAM *dram)
     printf("DRAM_WRITE_ACCESS    \t\t : %10llu\n", dram->stat_write_access);
     printf("DRAM_READ_DELAY_AVG  \t\t : %10.3f\n", avg_read_delay);
     printf("DRAM_WRITE_DELAY_AVG \t\t : %10.3f\n", avg_write_delay);
+
+    if (dram->farmem)
+    {
+        double avg_near_delay = 0.0;
+        if (dram->stat_near_access)
+        {
+            avg_near_delay = (double)(dram->stat_near_delay) /
+                             (double)(dram->stat_near_access);
+        }
+
+        cache_print_stats(dram->tier_tags, "DRAMCACHE");
+        printf("DRAMCACHE_HIT_DELAY_AVG\t\t : %10.3f\n", avg_near_delay);
+        farmem_print_stats(dram->farmem);
+    }
+}
+
+/**
+ * Print how evenly accesses were spread over the DRAM banks.
+ *
+ * @param dram The DRAM module to print the bank statistics of.
+ */
+void dram_print_bank_stats(DRAM *dram)
+{
+    unsigned long long bank_min = dram->stat_bank_access[0];
+    unsigned long long bank_max = dram->stat_bank_access[0];
+    unsigned long long bank_total = 0;
+    double imbalance = 0.0;
+
+    for (unsigned int i = 0; i < NUM_BANKS; i++)
+    {
+        if (dram->stat_bank_access[i] < bank_min)
+        {
+            bank_min = dram->stat_bank_access[i];
+        }
+        if (dram->stat_bank_access[i] > bank_max)
+        {
+            bank_max = dram->stat_bank_access[i];
+        }
+        bank_total += dram->stat_bank_access[i];
+    }
+
+    // The busiest bank relative to a perfectly even spread (1.0 is ideal).
+    if (bank_total)
+    {
+        imbalance = (double)bank_max * NUM_BANKS / (double)bank_total;
+    }
+
+    printf("\n");
+    printf("DRAM_BANK_ACCESS_MIN \t\t : %10llu\n", bank_min);
+    printf("DRAM_BANK_ACCESS_MAX \t\t : %10llu\n", bank_max);
+    printf("DRAM_BANK_IMBALANCE  \t\t : %10.3f\n", imbalance);
+}
+
+/**
+ * Write the per-bank counters of the DRAM module to a CSV file, one row per
+ * bank, for plotting as a heatmap: the accesses, row hits, row conflicts and
+ * busy cycles of the bank.
+ *
+ * @param dram The DRAM module to write the counters of.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool dram_write_bank_heatmap(DRAM *dram, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+
+    fprintf(f, "bank,access,row_hits,row_conflicts,busy_cycles\n");
+    for (unsigned int i = 0; i < NUM_BANKS; i++)
+    {
+        fprintf(f, "%u,%llu,%llu,%llu,%llu\n", i, dram->stat_bank_access[i],
+                dram->stat_bank_row_hits[i], dram->stat_bank_row_conflicts[i],
+                (unsigned long long)dram->stat_bank_busy[i]);
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * Register the statistics of the DRAM module: its accesses and delays, and
+ * the accesses, row hits, row conflicts and busy cycles of each bank.
+ *
+ * @param dram The DRAM module.
+ * @param reg The registry to add the statistics to.
+ * @param group The dot-separated groups the statistics belong to.
+ */
+void dram_register_stats(DRAM *dram, StatsRegistry *reg, const char *group)
+{
+    unsigned int read_access = stats_add_ull(reg, group, "read_access",
+                                             &dram->stat_read_access);
+    unsigned int write_access = stats_add_ull(reg, group, "write_access",
+                                              &dram->stat_write_access);
+    unsigned int read_delay = stats_add_u64(reg, group, "read_delay",
+                                            &dram->stat_read_delay);
+    unsigned int write_delay = stats_add_u64(reg, group, "write_delay",
+                                             &dram->stat_write_delay);
+    char bank_group[256];
+
+    stats_add_ratio(reg, group, "read_delay_avg", read_delay, read_access,
+                    1.0);
+    stats_add_ratio(reg, group, "write_delay_avg", write_delay, write_access,
+                    1.0);
+
+    for (unsigned int i = 0; i < NUM_BANKS; i++)
+    {
+        snprintf(bank_group, sizeof(bank_group), "%s.bank%d", group, i);
+        stats_add_ull(reg, bank_group, "access", &dram->stat_bank_access[i]);
+        stats_add_ull(reg, bank_group, "row_hits",
+                      &dram->stat_bank_row_hits[i]);
+        stats_add_ull(reg, bank_group, "row_conflicts",
+                      &dram->stat_bank_row_conflicts[i]);
+        stats_add_u64(reg, bank_group, "busy_cycles",
+                      &dram->stat_bank_busy[i]);
+    }
 }
@@ -10,9 +10,18 @@
 #define __DRAM_H__
 
 #include "types.h"
+#include "cache.h"
+#include "farmem.h"
 // You may add any other #include directives you need here, but make sure they
 // compile on the reference machine!
 
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The number of banks in the DRAM module. */
+#define NUM_BANKS 16
+
 ///////////////////////////////////////////////////////////////////////////////
 //                              DATA STRUCTURES                              //
 ///////////////////////////////////////////////////////////////////////////////
@@ -36,6 +45,27 @@ typedef struct DRAM
     // Refer to Appendix B for details on other fields you will need here.
     RowbufEntry *rows;
 
+    /**
+     * The tag store used when DRAM acts as a memory-side cache in front of
+     * the far-memory tier. NULL when the far-memory tier is disabled.
+     */
+    Cache *tier_tags;
+
+    /** The far-memory tier behind DRAM. NULL when it is disabled. */
+    FarMemory *farmem;
+
+    /**
+     * The total number of accesses serviced by DRAM itself when the
+     * far-memory tier is enabled (i.e., DRAM cache hits).
+     */
+    unsigned long long stat_near_access;
+
+    /**
+     * The total number of cycles spent on accesses serviced by DRAM itself
+     * when the far-memory tier is enabled.
+     */
+    uint64_t stat_near_delay;
+
     /**
      * The total number of times DRAM was accessed for a read.
      * You should initialize this to 0 and update it for every DRAM read!
@@ -61,6 +91,19 @@ typedef struct DRAM
      * You should initialize this to 0 and update it for every DRAM write!
      */
     uint64_t stat_write_delay;
+
+    /** The number of accesses to each bank (in parts C through F). */
+    unsigned long long stat_bank_access[NUM_BANKS];
+
+    /**
+     * The number of accesses to each bank that hit in its open row buffer,
+     * and that found another row open (a row conflict).
+     */
+    unsigned long long stat_bank_row_hits[NUM_BANKS];
+    unsigned long long stat_bank_row_conflicts[NUM_BANKS];
+
+    /** The total number of cycles each bank spent serving accesses. */
+    uint64_t stat_bank_busy[NUM_BANKS];
 } DRAM;
 
 
@@ -135,6 +178,24 @@ uint64_t dram_access(DRAM *dram, uint64_t line_addr, bool is_dram_write);
 uint64_t dram_access_mode_CDEF(DRAM *dram, uint64_t line_addr,
                                bool is_dram_write);
 
+/**
+ * Access the DRAM at the given cache line address when DRAM acts as a
+ * memory-side cache in front of the far-memory tier.
+ *
+ * DRAM is managed at DRAMCACHE_BLOCKSIZE granularity. Reads that miss migrate
+ * the whole block from the far-memory tier and may write a dirty victim block
+ * back to it. Writes that miss bypass DRAM and go straight to the far-memory
+ * tier.
+ *
+ * @param dram The DRAM module to access.
+ * @param line_addr The address of the cache line to access (in units of the
+ *                  cache line size).
+ * @param is_dram_write Whether this access writes to DRAM.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t dram_access_tiered(DRAM *dram, uint64_t line_addr,
+                            bool is_dram_write);
+
 /**
  * Print the statistics of the DRAM module.
  * 
@@ -144,4 +205,32 @@ uint64_t dram_access_mode_CDEF(DRAM *dram, uint64_t line_addr,
  */
 void dram_print_stats(DRAM *dram);
 
+/**
+ * Print how evenly accesses were spread over the DRAM banks.
+ *
+ * @param dram The DRAM module to print the bank statistics of.
+ */
+void dram_print_bank_stats(DRAM *dram);
+
+/**
+ * Register the statistics of the DRAM module: its accesses and delays, and
+ * the accesses, row hits, row conflicts and busy cycles of each bank.
+ *
+ * @param dram The DRAM module.
+ * @param reg The registry to add the statistics to.
+ * @param group The dot-separated groups the statistics belong to.
+ */
+void dram_register_stats(DRAM *dram, StatsRegistry *reg, const char *group);
+
+/**
+ * Write the per-bank counters of the DRAM module to a CSV file, one row per
+ * bank, for plotting as a heatmap: the accesses, row hits, row conflicts and
+ * busy cycles of the bank.
+ *
+ * @param dram The DRAM module to write the counters of.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool dram_write_bank_heatmap(DRAM *dram, const char *path);
+
 #endif // __DRAM_H__
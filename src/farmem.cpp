@@ -0,0 +1,121 @@
+// farmem.cpp
+// Defines the functions used to implement the far-memory tier.
+
+#include "farmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The number of bytes in a cache line. */
+extern uint64_t CACHE_LINESIZE;
+
+/** The access latency of the far-memory device, in cycles. */
+extern uint64_t FARMEM_LATENCY;
+
+/** The bandwidth of the far-memory device, in bytes per cycle. */
+extern uint64_t FARMEM_BW;
+
+/**
+ * The current clock cycle number.
+ *
+ * This is used to track when the device channel becomes free again.
+ */
+extern uint64_t current_cycle;
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a far-memory device.
+ *
+ * @return A pointer to the far-memory device.
+ */
+FarMemory *farmem_new()
+{
+    #ifdef DEBUG
+        printf("Creating far memory (latency: %ld, bw: %ld B/cycle)\n", FARMEM_LATENCY, FARMEM_BW);
+    #endif
+
+    FarMemory *fm = (FarMemory *)calloc(1, sizeof(FarMemory));
+    return fm;
+}
+
+/**
+ * Transfer the given number of bytes to or from the far-memory device.
+ *
+ * The transfer occupies the device channel for size / FARMEM_BW cycles. The
+ * returned delay covers queueing behind earlier transfers, the device latency
+ * and the transfer of the first cache line (critical word first); the rest of
+ * the transfer only consumes bandwidth. Also update the statistics
+ * accordingly.
+ *
+ * @param fm The far-memory device to access.
+ * @param size The number of bytes to transfer.
+ * @param is_write Whether this access writes to the device.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t farmem_access(FarMemory *fm, uint64_t size, bool is_write)
+{
+    uint64_t queue_delay = 0;
+    uint64_t first_line = (size < CACHE_LINESIZE) ? size : CACHE_LINESIZE;
+
+    if (fm->busy_until > current_cycle) {
+        queue_delay = fm->busy_until - current_cycle;
+    }
+
+    uint64_t delay = queue_delay + FARMEM_LATENCY +
+                     (first_line + FARMEM_BW - 1) / FARMEM_BW;
+    fm->busy_until = current_cycle + queue_delay +
+                     (size + FARMEM_BW - 1) / FARMEM_BW;
+
+    if (is_write) {
+        fm->stat_write_access++;
+        fm->stat_write_delay += delay;
+    } else {
+        fm->stat_read_access++;
+        fm->stat_read_delay += delay;
+    }
+
+    #ifdef DEBUG
+        printf("\t\tFar memory delay: %ld (queued: %ld), size: %ld, is_write: %d\n", delay, queue_delay, size, is_write);
+    #endif
+
+    return delay;
+}
+
+/**
+ * Print the statistics of the far-memory device.
+ *
+ * @param fm The far-memory device to print the statistics of.
+ */
+void farmem_print_stats(FarMemory *fm)
+{
+    double avg_read_delay = 0.0;
+    double avg_write_delay = 0.0;
+
+    if (fm->stat_read_access)
+    {
+        avg_read_delay = (double)(fm->stat_read_delay) /
+                         (double)(fm->stat_read_access);
+    }
+
+    if (fm->stat_write_access)
+    {
+        avg_write_delay = (double)(fm->stat_write_delay) /
+                          (double)(fm->stat_write_access);
+    }
+
+    printf("\n");
+    printf("FARMEM_READ_ACCESS   \t\t : %10llu\n", fm->stat_read_access);
+    printf("FARMEM_WRITE_ACCESS  \t\t : %10llu\n", fm->stat_write_access);
+    printf("FARMEM_READ_DELAY_AVG\t\t : %10.3f\n", avg_read_delay);
+    printf("FARMEM_WRITE_DELAY_AVG\t\t : %10.3f\n", avg_write_delay);
+    printf("FARMEM_MIGRATE_IN_KB \t\t : %10llu\n",
+           fm->stat_migrate_in_bytes / 1024);
+    printf("FARMEM_MIGRATE_OUT_KB\t\t : %10llu\n",
+           fm->stat_migrate_out_bytes / 1024);
+}
@@ -0,0 +1,78 @@
+// farmem.h
+// Contains declarations of data structures and functions used to implement a
+// slow, high-capacity memory tier (e.g., NVM or a CXL-attached device) that
+// sits behind DRAM. When this tier is enabled, DRAM acts as a memory-side
+// cache in front of it.
+
+#ifndef __FARMEM_H__
+#define __FARMEM_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** A far-memory device with a fixed latency and limited bandwidth. */
+typedef struct FarMemory
+{
+    /**
+     * The cycle at which the device finishes its last queued transfer.
+     * Requests issued before this cycle wait for the channel to free up.
+     */
+    uint64_t busy_until;
+
+    /** The total number of times the device was accessed for a read. */
+    unsigned long long stat_read_access;
+
+    /** The total number of cycles spent on device reads. */
+    uint64_t stat_read_delay;
+
+    /** The total number of times the device was accessed for a write. */
+    unsigned long long stat_write_access;
+
+    /** The total number of cycles spent on device writes. */
+    uint64_t stat_write_delay;
+
+    /** The total number of bytes moved from the device into DRAM. */
+    unsigned long long stat_migrate_in_bytes;
+
+    /** The total number of bytes moved from DRAM back into the device. */
+    unsigned long long stat_migrate_out_bytes;
+} FarMemory;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a far-memory device.
+ *
+ * @return A pointer to the far-memory device.
+ */
+FarMemory *farmem_new();
+
+/**
+ * Transfer the given number of bytes to or from the far-memory device.
+ *
+ * The transfer occupies the device channel for size / FARMEM_BW cycles. The
+ * returned delay covers queueing behind earlier transfers, the device latency
+ * and the transfer of the first cache line (critical word first); the rest of
+ * the transfer only consumes bandwidth. Also update the statistics
+ * accordingly.
+ *
+ * @param fm The far-memory device to access.
+ * @param size The number of bytes to transfer.
+ * @param is_write Whether this access writes to the device.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t farmem_access(FarMemory *fm, uint64_t size, bool is_write);
+
+/**
+ * Print the statistics of the far-memory device.
+ *
+ * @param fm The far-memory device to print the statistics of.
+ */
+void farmem_print_stats(FarMemory *fm);
+
+#endif // __FARMEM_H__
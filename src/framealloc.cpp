@@ -0,0 +1,164 @@
+// framealloc.cpp
+// Defines the functions used to implement the physical frame allocators.
+
+#include "framealloc.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The initial number of slots in the page map. Must be a power of two. */
+#define FRAME_MAP_INIT_CAPACITY 4096
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a frame allocator.
+ *
+ * @param policy The frame placement policy. Must not be FRAME_ALLOC_FIXED,
+ *               which needs no allocator.
+ * @param num_colors The number of page colors of the last shared cache, or 1
+ *                   if it has none (e.g., it uses a hashed index).
+ * @param core0_colors For the coloring policy, how many colors core 0 may
+ *                     use. Core 1 uses the remaining colors.
+ * @return A pointer to the frame allocator.
+ */
+FrameAllocator *framealloc_new(FrameAllocPolicy policy, uint64_t num_colors,
+                               uint64_t core0_colors)
+{
+    FrameAllocator *fa = (FrameAllocator *)calloc(1, sizeof(FrameAllocator));
+    fa->policy = policy;
+    fa->map = hashmap_new(FRAME_MAP_INIT_CAPACITY);
+
+    if (policy == FRAME_ALLOC_RANDOM)
+    {
+        fa->frame_used = (uint8_t *)calloc(PHYS_FRAMES, sizeof(uint8_t));
+    }
+
+    fa->num_colors = num_colors;
+    fa->color_next = (uint64_t *)calloc(num_colors, sizeof(uint64_t));
+    fa->stat_color_frames = (unsigned long long *)calloc(
+        num_colors, sizeof(unsigned long long));
+
+    fa->color_lo[0] = 0;
+    fa->color_hi[0] = core0_colors;
+    fa->color_lo[1] = core0_colors;
+    fa->color_hi[1] = num_colors;
+
+    #ifdef DEBUG
+        printf("Creating frame allocator (policy: %d, colors: %ld, core 0 colors: %ld)\n", policy, num_colors, core0_colors);
+    #endif
+
+    return fa;
+}
+
+/**
+ * Pick a free frame for a page first touched by the given core, according to
+ * the allocator's policy.
+ *
+ * @param fa The frame allocator to use.
+ * @param core_id The CPU core ID that touched the page.
+ * @return The physical frame number to use.
+ */
+uint64_t framealloc_pick(FrameAllocator *fa, unsigned int core_id)
+{
+    assert(fa->stat_frames < PHYS_FRAMES);
+
+    if (fa->policy == FRAME_ALLOC_RANDOM)
+    {
+        uint64_t pfn;
+        do
+        {
+            pfn = (((uint64_t)rand() << 31) | (uint64_t)rand()) % PHYS_FRAMES;
+        } while (fa->frame_used[pfn]);
+        fa->frame_used[pfn] = 1;
+        return pfn;
+    }
+
+    if (fa->policy == FRAME_ALLOC_COLOR)
+    {
+        // Rotate through the core's colors so its pages spread evenly over
+        // its share of the shared cache sets.
+        uint64_t lo = fa->color_lo[core_id];
+        uint64_t count = fa->color_hi[core_id] - lo;
+        uint64_t color = lo + (fa->color_cursor[core_id]++ % count);
+        return (fa->color_next[color]++ * fa->num_colors) + color;
+    }
+
+    return fa->next_pfn++;
+}
+
+/**
+ * Return the frame backing the given virtual page, allocating one according
+ * to the allocator's policy on the first touch.
+ *
+ * @param fa The frame allocator to use.
+ * @param asid The address space the page belongs to.
+ * @param vpn The virtual page number to translate.
+ * @param core_id The CPU core ID that touched the page.
+ * @return The physical frame number of the page.
+ */
+uint64_t framealloc_translate(FrameAllocator *fa, unsigned int asid,
+                              uint64_t vpn, unsigned int core_id)
+{
+    uint64_t key = (vpn << 8) | asid;
+    uint64_t slot = hashmap_find(fa->map, key);
+
+    if (fa->map->used[slot])
+    {
+        return fa->map->values[slot];
+    }
+
+    uint64_t pfn = framealloc_pick(fa, core_id);
+    hashmap_insert(fa->map, slot, key, pfn);
+    fa->stat_frames++;
+    fa->stat_color_frames[pfn % fa->num_colors]++;
+
+    #ifdef DEBUG
+        printf("\tAllocated frame %ld for vpn %ld (asid: %d, core_id: %d)\n", pfn, vpn, asid, core_id);
+    #endif
+
+    return pfn;
+}
+
+/**
+ * Print the statistics of the frame allocator.
+ *
+ * @param fa The frame allocator to print the statistics of.
+ */
+void framealloc_print_stats(FrameAllocator *fa)
+{
+    unsigned long long color_min = fa->stat_color_frames[0];
+    unsigned long long color_max = fa->stat_color_frames[0];
+    uint64_t colors_used = 0;
+
+    for (uint64_t i = 0; i < fa->num_colors; i++)
+    {
+        if (fa->stat_color_frames[i] < color_min)
+        {
+            color_min = fa->stat_color_frames[i];
+        }
+        if (fa->stat_color_frames[i] > color_max)
+        {
+            color_max = fa->stat_color_frames[i];
+        }
+        if (fa->stat_color_frames[i])
+        {
+            colors_used++;
+        }
+    }
+
+    printf("\n");
+    printf("FRAMEALLOC_FRAMES    \t\t : %10llu\n", fa->stat_frames);
+    printf("FRAMEALLOC_COLORS    \t\t : %10llu\n",
+           (unsigned long long)fa->num_colors);
+    printf("FRAMEALLOC_COLORS_USED\t\t : %10llu\n",
+           (unsigned long long)colors_used);
+    printf("FRAMEALLOC_COLOR_MIN \t\t : %10llu\n", color_min);
+    printf("FRAMEALLOC_COLOR_MAX \t\t : %10llu\n", color_max);
+}
@@ -0,0 +1,102 @@
+// framealloc.h
+// Contains declarations of data structures and functions used to implement
+// the physical frame allocators that back memsys_convert_vpn_to_pfn().
+
+#ifndef __FRAMEALLOC_H__
+#define __FRAMEALLOC_H__
+
+#include "types.h"
+#include "hashmap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The number of physical frames the allocators hand out (4 GB of 4 KB). */
+#define PHYS_FRAMES (1ULL << 20)
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** Possible policies for placing virtual pages in physical frames. */
+typedef enum FrameAllocPolicyEnum
+{
+    FRAME_ALLOC_FIXED = 0,       // The fixed arithmetic mapping.
+    FRAME_ALLOC_RANDOM = 1,      // A random free frame on first touch.
+    FRAME_ALLOC_FIRST_TOUCH = 2, // The next frame in order of first touch.
+    FRAME_ALLOC_COLOR = 3,       // A frame of one of the core's colors.
+} FrameAllocPolicy;
+
+/** A physical frame allocator with its page map. */
+typedef struct FrameAllocator
+{
+    FrameAllocPolicy policy;
+
+    /** The page map, from (address space, VPN) keys to PFNs. */
+    HashMap *map;
+
+    /** Which frames are in use, for the random policy. */
+    uint8_t *frame_used;
+
+    /** The next frame to hand out, for the first-touch policy. */
+    uint64_t next_pfn;
+
+    /**
+     * The number of page colors, i.e., groups of frames that map to the same
+     * shared cache sets, and the next frame index to hand out in each color.
+     */
+    uint64_t num_colors;
+    uint64_t *color_next;
+
+    /** The colors each core may use are [color_lo, color_hi) for that core. */
+    uint64_t color_lo[2];
+    uint64_t color_hi[2];
+    uint64_t color_cursor[2];
+
+    /** The total number of frames handed out. */
+    unsigned long long stat_frames;
+
+    /** The number of frames handed out of each color. */
+    unsigned long long *stat_color_frames;
+} FrameAllocator;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a frame allocator.
+ *
+ * @param policy The frame placement policy. Must not be FRAME_ALLOC_FIXED,
+ *               which needs no allocator.
+ * @param num_colors The number of page colors of the last shared cache, or 1
+ *                   if it has none (e.g., it uses a hashed index).
+ * @param core0_colors For the coloring policy, how many colors core 0 may
+ *                     use. Core 1 uses the remaining colors.
+ * @return A pointer to the frame allocator.
+ */
+FrameAllocator *framealloc_new(FrameAllocPolicy policy, uint64_t num_colors,
+                               uint64_t core0_colors);
+
+/**
+ * Return the frame backing the given virtual page, allocating one according
+ * to the allocator's policy on the first touch.
+ *
+ * @param fa The frame allocator to use.
+ * @param asid The address space the page belongs to.
+ * @param vpn The virtual page number to translate.
+ * @param core_id The CPU core ID that touched the page.
+ * @return The physical frame number of the page.
+ */
+uint64_t framealloc_translate(FrameAllocator *fa, unsigned int asid,
+                              uint64_t vpn, unsigned int core_id);
+
+/**
+ * Print the statistics of the frame allocator.
+ *
+ * @param fa The frame allocator to print the statistics of.
+ */
+void framealloc_print_stats(FrameAllocator *fa);
+
+#endif // __FRAMEALLOC_H__
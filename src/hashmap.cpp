@@ -0,0 +1,120 @@
+// hashmap.cpp
+// Defines the functions used to implement the open-addressing hash table.
+
+#include "hashmap.h"
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty hash table.
+ *
+ * @param capacity The initial number of slots. Must be a power of two.
+ * @return A pointer to the hash table.
+ */
+HashMap *hashmap_new(uint64_t capacity)
+{
+    HashMap *map = (HashMap *)calloc(1, sizeof(HashMap));
+
+    map->capacity = capacity;
+    map->keys = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    map->values = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    map->used = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+    return map;
+}
+
+/**
+ * Get the slot a key hashes to.
+ *
+ * @param map The hash table.
+ * @param key The key.
+ * @return The index of the slot.
+ */
+uint64_t hashmap_hash(HashMap *map, uint64_t key)
+{
+    // Fibonacci hashing spreads nearby keys over the whole table.
+    return (key * 0x9E3779B97F4A7C15ULL >> 32) & (map->capacity - 1);
+}
+
+/**
+ * Find the slot of the given key, or the empty slot it would go in.
+ *
+ * @param map The hash table to search.
+ * @param key The key.
+ * @return The index of the slot.
+ */
+uint64_t hashmap_find(HashMap *map, uint64_t key)
+{
+    uint64_t slot = hashmap_hash(map, key);
+
+    while (map->used[slot] && map->keys[slot] != key)
+    {
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    return slot;
+}
+
+/**
+ * Double the number of slots in the table, reinserting every key.
+ *
+ * @param map The hash table to grow.
+ */
+void hashmap_grow(HashMap *map)
+{
+    uint64_t *old_keys = map->keys;
+    uint64_t *old_values = map->values;
+    uint8_t *old_used = map->used;
+    uint64_t old_capacity = map->capacity;
+
+    map->capacity *= 2;
+    map->keys = (uint64_t *)calloc(map->capacity, sizeof(uint64_t));
+    map->values = (uint64_t *)calloc(map->capacity, sizeof(uint64_t));
+    map->used = (uint8_t *)calloc(map->capacity, sizeof(uint8_t));
+
+    for (uint64_t i = 0; i < old_capacity; i++)
+    {
+        if (!old_used[i])
+        {
+            continue;
+        }
+
+        uint64_t slot = hashmap_find(map, old_keys[i]);
+        map->keys[slot] = old_keys[i];
+        map->values[slot] = old_values[i];
+        map->used[slot] = 1;
+    }
+
+    free(old_keys);
+    free(old_values);
+    free(old_used);
+}
+
+/**
+ * Put a key and its value in the empty slot hashmap_find() returned for it,
+ * growing the table if it gets three quarters full.
+ *
+ * @param map The hash table.
+ * @param slot The empty slot of the key.
+ * @param key The key.
+ * @param value The value of the key.
+ * @return Whether the table grew, which moves every key to a new slot.
+ */
+bool hashmap_insert(HashMap *map, uint64_t slot, uint64_t key,
+                    uint64_t value)
+{
+    map->keys[slot] = key;
+    map->values[slot] = value;
+    map->used[slot] = 1;
+    map->count++;
+
+    if (map->count * 4 > map->capacity * 3)
+    {
+        hashmap_grow(map);
+        return true;
+    }
+
+    return false;
+}
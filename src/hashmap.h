@@ -0,0 +1,70 @@
+// hashmap.h
+// Contains declarations of data structures and functions used to implement a
+// small open-addressing hash table (linear probing) from 64-bit keys to 64-bit
+// values. It backs the per-instruction profile, the reuse distance tracker
+// and the page map of the frame allocators.
+
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A hash table from keys to values. Every key may be used, so the used slots
+ * are marked apart from the keys. It doubles in size when it gets three
+ * quarters full, which moves the keys to new slots.
+ */
+typedef struct HashMap
+{
+    uint64_t *keys;
+    uint64_t *values;
+
+    /** Whether each slot holds a key. */
+    uint8_t *used;
+
+    /** The number of slots in the table. Always a power of two. */
+    uint64_t capacity;
+
+    /** The number of slots in use. */
+    uint64_t count;
+} HashMap;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty hash table.
+ *
+ * @param capacity The initial number of slots. Must be a power of two.
+ * @return A pointer to the hash table.
+ */
+HashMap *hashmap_new(uint64_t capacity);
+
+/**
+ * Find the slot of the given key, or the empty slot it would go in.
+ *
+ * @param map The hash table to search.
+ * @param key The key.
+ * @return The index of the slot.
+ */
+uint64_t hashmap_find(HashMap *map, uint64_t key);
+
+/**
+ * Put a key and its value in the empty slot hashmap_find() returned for it,
+ * growing the table if it gets three quarters full.
+ *
+ * @param map The hash table.
+ * @param slot The empty slot of the key.
+ * @param key The key.
+ * @param value The value of the key.
+ * @return Whether the table grew, which moves every key to a new slot.
+ */
+bool hashmap_insert(HashMap *map, uint64_t slot, uint64_t key,
+                    uint64_t value);
+
+#endif // __HASHMAP_H__
@@ -0,0 +1,232 @@
+// hostprof.cpp
+// Defines the functions used to profile the simulator itself.
+
+#include "hostprof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Start counting a host hardware event for this process in user mode.
+ *
+ * @param config The PERF_COUNT_HW_* event to count.
+ * @return The perf event file descriptor, or -1 if the event is unavailable
+ *         (e.g., in a container or with a restrictive perf_event_paranoid).
+ */
+int hostprof_open_event(uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Draw the number of calls until the next timed call of a stage.
+ *
+ * @param hp The host profile.
+ * @return A gap between 1 and 2 * HOSTPROF_SAMPLE_RATE - 1, uniformly
+ *         distributed, so the mean is HOSTPROF_SAMPLE_RATE.
+ */
+unsigned long long hostprof_next_gap(HostProfile *hp)
+{
+    // xorshift64
+    hp->rng ^= hp->rng << 13;
+    hp->rng ^= hp->rng >> 7;
+    hp->rng ^= hp->rng << 17;
+    return 1 + hp->rng % (2 * HOSTPROF_SAMPLE_RATE - 1);
+}
+
+/**
+ * Allocate a host profile, start its clock, and start counting the host
+ * hardware events where the system allows it.
+ *
+ * @return A pointer to the host profile.
+ */
+HostProfile *hostprof_new()
+{
+    HostProfile *hp = (HostProfile *)calloc(1, sizeof(HostProfile));
+
+    uint64_t overhead = 0;
+    for (unsigned int i = 0; i < HOSTPROF_CALIBRATE_ROUNDS; i++)
+    {
+        uint64_t start = hostprof_now();
+        overhead += hostprof_now() - start;
+    }
+    hp->overhead_ns = overhead / HOSTPROF_CALIBRATE_ROUNDS;
+
+    // The first call is not timed, since it includes one-off startup costs
+    // such as page faults on the freshly allocated caches.
+    hp->rng = 0x9E3779B97F4A7C15ULL;
+    for (unsigned int s = 0; s < NUM_HOST_STAGES; s++)
+    {
+        hp->until_timed[s] = hostprof_next_gap(hp);
+    }
+
+    hp->perf_fd[HOST_EVENT_CYCLES] =
+        hostprof_open_event(PERF_COUNT_HW_CPU_CYCLES);
+    hp->perf_fd[HOST_EVENT_INSTRUCTIONS] =
+        hostprof_open_event(PERF_COUNT_HW_INSTRUCTIONS);
+    hp->perf_fd[HOST_EVENT_CACHE_MISSES] =
+        hostprof_open_event(PERF_COUNT_HW_CACHE_MISSES);
+
+    hp->start_ns = hostprof_now();
+    hp->status_ns = hp->start_ns;
+    return hp;
+}
+
+/**
+ * Get the current host time.
+ *
+ * @return The host time in nanoseconds (CLOCK_MONOTONIC).
+ */
+uint64_t hostprof_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Count a call of the given stage and, on average for one in
+ * HOSTPROF_SAMPLE_RATE calls, start timing it.
+ *
+ * @param hp The host profile.
+ * @param stage The stage being entered.
+ * @return The host time to pass to hostprof_end(), or 0 if this call is not
+ *         timed.
+ */
+uint64_t hostprof_begin(HostProfile *hp, HostStage stage)
+{
+    hp->calls[stage]++;
+    if (--hp->until_timed[stage])
+    {
+        return 0;
+    }
+    hp->until_timed[stage] = hostprof_next_gap(hp);
+    return hostprof_now();
+}
+
+/**
+ * Finish timing a call of the given stage.
+ *
+ * @param hp The host profile.
+ * @param stage The stage being left.
+ * @param start The value hostprof_begin() returned. Nothing is recorded if
+ *              it is 0.
+ */
+void hostprof_end(HostProfile *hp, HostStage stage, uint64_t start)
+{
+    if (start)
+    {
+        uint64_t elapsed = hostprof_now() - start;
+        if (elapsed > HOSTPROF_MAX_TIMED_NS)
+        {
+            hp->stat_interrupted++;
+            return;
+        }
+        hp->timed[stage]++;
+        if (elapsed > hp->overhead_ns)
+        {
+            hp->timed_ns[stage] += elapsed - hp->overhead_ns;
+        }
+    }
+}
+
+/**
+ * Print a status line with the simulated cycles and instructions so far and
+ * the simulation speed, overall and since the last status line, to stderr.
+ *
+ * @param hp The host profile.
+ * @param cycle The current clock cycle number.
+ * @param insts The number of instructions simulated so far.
+ */
+void hostprof_print_status(HostProfile *hp, uint64_t cycle,
+                           unsigned long long insts)
+{
+    uint64_t now = hostprof_now();
+    double seconds = (now - hp->start_ns) / 1e9;
+    double recent_seconds = (now - hp->status_ns) / 1e9;
+
+    fprintf(stderr, "%6llu M cycles %10llu insts %10.1f KIPS "
+                    "(recent %10.1f) %8.1f s\n",
+            (unsigned long long)cycle / 1000000, insts,
+            seconds > 0 ? insts / seconds / 1000 : 0.0,
+            recent_seconds > 0
+            ? (insts - hp->status_insts) / recent_seconds / 1000 : 0.0,
+            seconds);
+
+    hp->status_ns = now;
+    hp->status_insts = insts;
+}
+
+/**
+ * Print the host time and speed of the run, the estimated share of host
+ * time spent in each stage with its cost per call, and the host hardware
+ * events if they were counted.
+ *
+ * @param hp The host profile to print the statistics of.
+ * @param insts The number of instructions simulated.
+ */
+void hostprof_print_stats(HostProfile *hp, unsigned long long insts)
+{
+    const char *stage_names[NUM_HOST_STAGES] = {"TRACE", "CORE", "CACHE",
+                                                "VICTIM", "DRAM"};
+    const char *event_names[NUM_HOST_EVENTS] = {"CYCLES", "INSTRUCTIONS",
+                                                "CACHE_MISSES"};
+    uint64_t total_ns = hostprof_now() - hp->start_ns;
+    double seconds = total_ns / 1e9;
+
+    printf("\n");
+    printf("HOST_SECONDS         \t\t : %10.3f\n", seconds);
+    printf("HOST_KIPS            \t\t : %10.1f\n",
+           seconds > 0 ? insts / seconds / 1000 : 0.0);
+    printf("HOST_MIPS            \t\t : %10.3f\n",
+           seconds > 0 ? insts / seconds / 1000000 : 0.0);
+    printf("HOST_INTERRUPTED_SAMPLES\t\t : %10llu\n", hp->stat_interrupted);
+
+    // Stages nest (the core stage includes the others), so the shares are
+    // inclusive and do not add up to 100%.
+    for (unsigned int s = 0; s < NUM_HOST_STAGES; s++)
+    {
+        double ns_per_call = 0.0;
+        if (hp->timed[s])
+        {
+            ns_per_call = (double)hp->timed_ns[s] / hp->timed[s];
+        }
+        printf("HOST_%s_CALLS     \t\t : %10llu\n", stage_names[s],
+               hp->calls[s]);
+        printf("HOST_%s_NS_PER_CALL\t\t : %10.1f\n", stage_names[s],
+               ns_per_call);
+        printf("HOST_%s_PERC      \t\t : %10.3f\n", stage_names[s],
+               total_ns ? 100.0 * ns_per_call * hp->calls[s] / total_ns
+                        : 0.0);
+    }
+
+    for (unsigned int e = 0; e < NUM_HOST_EVENTS; e++)
+    {
+        unsigned long long count = 0;
+        if (hp->perf_fd[e] < 0 ||
+            read(hp->perf_fd[e], &count, sizeof(count)) != sizeof(count))
+        {
+            continue;
+        }
+        printf("HOST_PERF_%s     \t\t : %10llu\n", event_names[e], count);
+    }
+}
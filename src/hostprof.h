@@ -0,0 +1,154 @@
+// hostprof.h
+// Contains declarations of data structures and functions used to profile the
+// simulator itself: its throughput in simulated instructions per host second
+// and where the host time goes, so optimization effort can be aimed and
+// speed regressions caught.
+
+#ifndef __HOSTPROF_H__
+#define __HOSTPROF_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * On average, one in this many calls of each stage is timed. Reading the
+ * clock costs about as much as a cache lookup, so timing every call would
+ * distort the breakdown it measures. The gaps between timed calls are random
+ * so they cannot line up with periodic work such as trace buffer refills.
+ */
+#define HOSTPROF_SAMPLE_RATE 64
+
+/**
+ * Timed calls longer than this many nanoseconds are assumed to have been
+ * descheduled or interrupted by the host and are left out of the estimates.
+ * Scaled up by the sampling rate, one of them would swamp a short run.
+ */
+#define HOSTPROF_MAX_TIMED_NS 50000
+
+/** The number of empty timings used to measure the cost of the clock. */
+#define HOSTPROF_CALIBRATE_ROUNDS 1000
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The parts of the simulator whose host time is measured. */
+typedef enum HostStageEnum
+{
+    HOST_STAGE_TRACE = 0,  // Reading and decoding trace records.
+    HOST_STAGE_CORE = 1,   // core_cycle(), including everything below.
+    HOST_STAGE_CACHE = 2,  // cache_access() lookups.
+    HOST_STAGE_VICTIM = 3, // Victim selection in cache_install().
+    HOST_STAGE_DRAM = 4,   // DRAM modeling in dram_access().
+    NUM_HOST_STAGES = 5,
+} HostStage;
+
+/** The host hardware events counted with perf_event_open(), if allowed. */
+typedef enum HostEventEnum
+{
+    HOST_EVENT_CYCLES = 0,
+    HOST_EVENT_INSTRUCTIONS = 1,
+    HOST_EVENT_CACHE_MISSES = 2,
+    NUM_HOST_EVENTS = 3,
+} HostEvent;
+
+/** The host time profile of a simulation run. */
+typedef struct HostProfile
+{
+    /** The host time at which the profile started, in nanoseconds. */
+    uint64_t start_ns;
+
+    /** The host time and instruction count at the last status line. */
+    uint64_t status_ns;
+    unsigned long long status_insts;
+
+    /**
+     * The time an empty region measures, in nanoseconds. This is subtracted
+     * from every timed call so the clock itself is not charged to the stage.
+     */
+    uint64_t overhead_ns;
+
+    /** The state of the generator of the gaps between timed calls. */
+    uint64_t rng;
+
+    /**
+     * The number of calls of each stage, how many of them were timed, and
+     * the host time of the timed calls in nanoseconds.
+     */
+    unsigned long long calls[NUM_HOST_STAGES];
+    unsigned long long until_timed[NUM_HOST_STAGES];
+    unsigned long long timed[NUM_HOST_STAGES];
+    uint64_t timed_ns[NUM_HOST_STAGES];
+
+    /** The number of timed calls left out as interrupted. */
+    unsigned long long stat_interrupted;
+
+    /** The perf event file descriptors, or -1 where unavailable. */
+    int perf_fd[NUM_HOST_EVENTS];
+} HostProfile;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate a host profile, start its clock, and start counting the host
+ * hardware events where the system allows it.
+ *
+ * @return A pointer to the host profile.
+ */
+HostProfile *hostprof_new();
+
+/**
+ * Get the current host time.
+ *
+ * @return The host time in nanoseconds (CLOCK_MONOTONIC).
+ */
+uint64_t hostprof_now();
+
+/**
+ * Count a call of the given stage and, on average for one in
+ * HOSTPROF_SAMPLE_RATE calls, start timing it.
+ *
+ * @param hp The host profile.
+ * @param stage The stage being entered.
+ * @return The host time to pass to hostprof_end(), or 0 if this call is not
+ *         timed.
+ */
+uint64_t hostprof_begin(HostProfile *hp, HostStage stage);
+
+/**
+ * Finish timing a call of the given stage.
+ *
+ * @param hp The host profile.
+ * @param stage The stage being left.
+ * @param start The value hostprof_begin() returned. Nothing is recorded if
+ *              it is 0.
+ */
+void hostprof_end(HostProfile *hp, HostStage stage, uint64_t start);
+
+/**
+ * Print a status line with the simulated cycles and instructions so far and
+ * the simulation speed, overall and since the last status line, to stderr.
+ *
+ * @param hp The host profile.
+ * @param cycle The current clock cycle number.
+ * @param insts The number of instructions simulated so far.
+ */
+void hostprof_print_status(HostProfile *hp, uint64_t cycle,
+                           unsigned long long insts);
+
+/**
+ * Print the host time and speed of the run, the estimated share of host
+ * time spent in each stage with its cost per call, and the host hardware
+ * events if they were counted.
+ *
+ * @param hp The host profile to print the statistics of.
+ * @param insts The number of instructions simulated.
+ */
+void hostprof_print_stats(HostProfile *hp, unsigned long long insts);
+
+#endif // __HOSTPROF_H__
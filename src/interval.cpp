@@ -0,0 +1,170 @@
+// interval.cpp
+// Defines the functions used to write interval snapshots of the statistics.
+
+#include "interval.h"
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The current clock cycle number. */
+extern uint64_t current_cycle;
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Get the total number of DRAM row-buffer accesses so far (open-page and
+ * close-page accesses in modes C through F), and how many of them hit in an
+ * open row.
+ *
+ * @param dram The DRAM module.
+ * @param row_hits Set to the number of row-buffer hits.
+ * @return The number of row-buffer accesses.
+ */
+unsigned long long interval_dram_row_access(DRAM *dram,
+                                            unsigned long long *row_hits)
+{
+    unsigned long long row_access = 0;
+
+    *row_hits = 0;
+    for (unsigned int i = 0; i < NUM_BANKS; i++)
+    {
+        row_access += dram->stat_bank_access[i];
+        *row_hits += dram->stat_bank_row_hits[i];
+    }
+
+    return row_access;
+}
+
+/**
+ * Open an interval log and write its CSV header.
+ *
+ * @param path The path of the CSV file.
+ * @param sys The memory system whose statistics are sampled.
+ * @param nof_streams The number of instruction streams.
+ * @return A pointer to the interval log, or NULL if the file could not be
+ *         opened.
+ */
+IntervalLog *interval_new(const char *path, MemorySystem *sys,
+                          unsigned int nof_streams)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return NULL;
+    }
+
+    IntervalLog *log = (IntervalLog *)calloc(1, sizeof(IntervalLog));
+    char labels[MAX_MEMSYS_CACHES][16];
+
+    log->f = f;
+    log->nof_streams = nof_streams;
+    log->last_insts = (unsigned long long *)calloc(
+        nof_streams, sizeof(unsigned long long));
+    log->nof_caches = memsys_list_caches(sys, log->caches, labels);
+
+    fprintf(f, "cycle");
+    for (unsigned int i = 0; i < nof_streams; i++)
+    {
+        fprintf(f, ",insts_%d,ipc_%d", i, i);
+    }
+    for (unsigned int c = 0; c < log->nof_caches; c++)
+    {
+        fprintf(f, ",%s_mpki", labels[c]);
+    }
+    if (sys->dram)
+    {
+        fprintf(f, ",dram_access,dram_row_hit_rate,dram_avg_delay");
+    }
+    fprintf(f, ",load_avg_delay\n");
+
+    return log;
+}
+
+/**
+ * Write one row covering the cycles since the last sample: the instructions
+ * and IPC of each stream, the MPKI of each cache (per thousand instructions
+ * of all streams), the DRAM row-buffer hit rate and average latency, and the
+ * average load delay.
+ *
+ * @param log The interval log.
+ * @param sys The memory system whose statistics are sampled.
+ * @param insts The instruction count of each stream so far.
+ */
+void interval_sample(IntervalLog *log, MemorySystem *sys,
+                     unsigned long long *insts)
+{
+    uint64_t cycles = current_cycle - log->last_cycle;
+    unsigned long long total_insts = 0;
+
+    fprintf(log->f, "%llu", (unsigned long long)current_cycle);
+    for (unsigned int i = 0; i < log->nof_streams; i++)
+    {
+        unsigned long long delta = insts[i] - log->last_insts[i];
+        total_insts += delta;
+        fprintf(log->f, ",%llu,%.4f", delta,
+                cycles ? (double)delta / cycles : 0.0);
+        log->last_insts[i] = insts[i];
+    }
+
+    for (unsigned int c = 0; c < log->nof_caches; c++)
+    {
+        unsigned long long misses = log->caches[c]->stat_read_miss +
+                                    log->caches[c]->stat_write_miss;
+        fprintf(log->f, ",%.3f", total_insts
+                ? 1000.0 * (misses - log->last_misses[c]) / total_insts
+                : 0.0);
+        log->last_misses[c] = misses;
+    }
+
+    if (sys->dram)
+    {
+        DRAM *dram = sys->dram;
+        unsigned long long access = dram->stat_read_access +
+                                    dram->stat_write_access;
+        uint64_t delay = dram->stat_read_delay + dram->stat_write_delay;
+        unsigned long long row_hits;
+        unsigned long long row_access = interval_dram_row_access(dram,
+                                                                 &row_hits);
+        unsigned long long row_delta = row_access - log->last_dram_row_access;
+
+        fprintf(log->f, ",%llu,%.4f,%.3f", access - log->last_dram_access,
+                row_delta ? (double)(row_hits - log->last_dram_row_hits) /
+                            row_delta
+                          : 0.0,
+                (access > log->last_dram_access)
+                ? (double)(delay - log->last_dram_delay) /
+                  (access - log->last_dram_access)
+                : 0.0);
+
+        log->last_dram_access = access;
+        log->last_dram_delay = delay;
+        log->last_dram_row_access = row_access;
+        log->last_dram_row_hits = row_hits;
+    }
+
+    unsigned long long loads = sys->stat_load_access - log->last_load_access;
+    fprintf(log->f, ",%.3f\n", loads
+            ? (double)(sys->stat_load_delay - log->last_load_delay) / loads
+            : 0.0);
+    log->last_load_access = sys->stat_load_access;
+    log->last_load_delay = sys->stat_load_delay;
+
+    log->last_cycle = current_cycle;
+    log->stat_samples++;
+}
+
+/**
+ * Close the interval log.
+ *
+ * @param log The interval log to close.
+ */
+void interval_close(IntervalLog *log)
+{
+    fclose(log->f);
+    free(log->last_insts);
+    free(log);
+}
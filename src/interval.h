@@ -0,0 +1,83 @@
+// interval.h
+// Contains declarations of data structures and functions used to write
+// periodic snapshots of the simulation statistics (a time series), so phase
+// behavior such as the point where a cache starts thrashing can be seen.
+
+#ifndef __INTERVAL_H__
+#define __INTERVAL_H__
+
+#include "types.h"
+#include "memsys.h"
+#include <stdio.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A CSV stream of interval samples. Each row covers the cycles since the
+ * previous row, so the counters are kept as of the last sample.
+ */
+typedef struct IntervalLog
+{
+    FILE *f;
+
+    /** The number of instruction streams (cores, or scheduled processes). */
+    unsigned int nof_streams;
+
+    /** The caches whose MPKI is sampled. */
+    Cache *caches[MAX_MEMSYS_CACHES];
+    unsigned int nof_caches;
+
+    /** The counters as of the last sample. */
+    uint64_t last_cycle;
+    unsigned long long *last_insts;
+    unsigned long long last_misses[MAX_MEMSYS_CACHES];
+    unsigned long long last_dram_access;
+    unsigned long long last_dram_row_access;
+    unsigned long long last_dram_row_hits;
+    uint64_t last_dram_delay;
+    unsigned long long last_load_access;
+    uint64_t last_load_delay;
+
+    /** The total number of samples written. */
+    unsigned long long stat_samples;
+} IntervalLog;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Open an interval log and write its CSV header.
+ *
+ * @param path The path of the CSV file.
+ * @param sys The memory system whose statistics are sampled.
+ * @param nof_streams The number of instruction streams.
+ * @return A pointer to the interval log, or NULL if the file could not be
+ *         opened.
+ */
+IntervalLog *interval_new(const char *path, MemorySystem *sys,
+                          unsigned int nof_streams);
+
+/**
+ * Write one row covering the cycles since the last sample: the instructions
+ * and IPC of each stream, the MPKI of each cache (per thousand instructions
+ * of all streams), the DRAM row-buffer hit rate and average latency, and the
+ * average load delay.
+ *
+ * @param log The interval log.
+ * @param sys The memory system whose statistics are sampled.
+ * @param insts The instruction count of each stream so far.
+ */
+void interval_sample(IntervalLog *log, MemorySystem *sys,
+                     unsigned long long *insts);
+
+/**
+ * Close the interval log.
+ *
+ * @param log The interval log to close.
+ */
+void interval_close(IntervalLog *log);
+
+#endif // __INTERVAL_H__
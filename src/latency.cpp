@@ -0,0 +1,178 @@
+// latency.cpp
+// Defines the functions used to implement the latency histograms.
+
+#include "latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Get the bucket of the given latency.
+ *
+ * @param latency The latency, in cycles.
+ * @return The index of its bucket.
+ */
+unsigned int latency_hist_bucket(uint64_t latency)
+{
+    if (latency < LATENCY_SUB_BUCKETS)
+    {
+        return (unsigned int)latency;
+    }
+
+    unsigned int msb = 63 - __builtin_clzll(latency);
+    unsigned int shift = msb - LATENCY_SUB_BITS;
+    unsigned int sub = (latency >> shift) & (LATENCY_SUB_BUCKETS - 1);
+
+    return (shift + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+/**
+ * Get the largest latency that falls into the given bucket.
+ *
+ * @param bucket The index of the bucket.
+ * @return The upper bound of the bucket, in cycles.
+ */
+uint64_t latency_hist_bucket_max(unsigned int bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    unsigned int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(LATENCY_SUB_BUCKETS +
+                              bucket % LATENCY_SUB_BUCKETS) << shift;
+
+    return low + (1ULL << shift) - 1;
+}
+
+/**
+ * Allocate and initialize an empty latency histogram.
+ *
+ * @return A pointer to the histogram.
+ */
+LatencyHist *latency_hist_new()
+{
+    LatencyHist *h = (LatencyHist *)calloc(1, sizeof(LatencyHist));
+    return h;
+}
+
+/**
+ * Record one latency in the histogram.
+ *
+ * @param h The histogram.
+ * @param latency The latency to record, in cycles.
+ */
+void latency_hist_record(LatencyHist *h, uint64_t latency)
+{
+    h->buckets[latency_hist_bucket(latency)]++;
+    h->count++;
+    h->sum += latency;
+
+    if (latency > h->max)
+    {
+        h->max = latency;
+    }
+}
+
+/**
+ * Get the given percentile of the recorded latencies. The result is the
+ * upper bound of the bucket the percentile falls in (never more than the
+ * largest latency recorded), so it overestimates by at most one bucket.
+ *
+ * @param h The histogram.
+ * @param percentile The percentile to get, between 0 and 100.
+ * @return The percentile in cycles, or 0 if nothing was recorded.
+ */
+uint64_t latency_hist_percentile(const LatencyHist *h, double percentile)
+{
+    if (!h->count)
+    {
+        return 0;
+    }
+
+    // The rank of the percentile, counting from 1.
+    unsigned long long rank =
+        (unsigned long long)(percentile / 100.0 * h->count + 0.5);
+    unsigned long long seen = 0;
+
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    for (unsigned int b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        seen += h->buckets[b];
+        if (seen >= rank)
+        {
+            uint64_t bucket_max = latency_hist_bucket_max(b);
+            return (bucket_max < h->max) ? bucket_max : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+/**
+ * Count the recorded values that are at most the given value. Values in the
+ * bucket the given value falls in count only if the whole bucket is at most
+ * the given value.
+ *
+ * @param h The histogram.
+ * @param value The value to compare against.
+ * @return The number of recorded values at most the given value.
+ */
+unsigned long long latency_hist_count_at_most(LatencyHist *h, uint64_t value)
+{
+    unsigned long long count = 0;
+
+    for (unsigned int b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        if (latency_hist_bucket_max(b) > value)
+        {
+            break;
+        }
+        count += h->buckets[b];
+    }
+
+    return count;
+}
+
+/**
+ * Print the count, average, p50, p90, p99, p99.9 and maximum of the recorded
+ * values.
+ *
+ * @param h The histogram to print the statistics of.
+ * @param header A label for the histogram, which is used as a prefix for
+ *               each statistic.
+ * @param name The name of the recorded quantity (e.g., LAT for latencies),
+ *             which follows the label in each statistic.
+ */
+void latency_hist_print_stats(LatencyHist *h, const char *header,
+                              const char *name)
+{
+    double avg = 0.0;
+
+    if (h->count)
+    {
+        avg = (double)(h->sum) / (double)(h->count);
+    }
+
+    printf("\n");
+    printf("%s_%s_COUNT      \t\t : %10llu\n", header, name, h->count);
+    printf("%s_%s_AVG        \t\t : %10.3f\n", header, name, avg);
+    printf("%s_%s_P50        \t\t : %10llu\n", header, name,
+           (unsigned long long)latency_hist_percentile(h, 50.0));
+    printf("%s_%s_P90        \t\t : %10llu\n", header, name,
+           (unsigned long long)latency_hist_percentile(h, 90.0));
+    printf("%s_%s_P99        \t\t : %10llu\n", header, name,
+           (unsigned long long)latency_hist_percentile(h, 99.0));
+    printf("%s_%s_P999       \t\t : %10llu\n", header, name,
+           (unsigned long long)latency_hist_percentile(h, 99.9));
+    printf("%s_%s_MAX        \t\t : %10llu\n", header, name,
+           (unsigned long long)h->max);
+}
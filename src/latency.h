@@ -0,0 +1,108 @@
+// latency.h
+// Contains declarations of data structures and functions used to implement
+// log-bucketed latency histograms. Unlike the delay sums kept elsewhere,
+// these give the tail of the latency distribution (e.g., the 99th
+// percentile), not just its average.
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The number of bits of each latency kept below its most significant bit.
+ * Latencies under 2^LATENCY_SUB_BITS cycles are counted exactly; larger ones
+ * fall into buckets at most 1 / 2^LATENCY_SUB_BITS (6.25%) of their value
+ * wide.
+ */
+#define LATENCY_SUB_BITS 4
+
+/** The number of buckets for each power of two. */
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+
+/** The number of buckets needed to cover every 64-bit latency. */
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A histogram of latencies in the style of HdrHistogram: each power of two
+ * is split into LATENCY_SUB_BUCKETS linear buckets, so the relative error of
+ * every percentile is bounded while the histogram stays a fixed size.
+ */
+typedef struct LatencyHist
+{
+    /** The number of latencies recorded in each bucket. */
+    unsigned long long buckets[LATENCY_BUCKETS];
+
+    /** The total number of latencies recorded. */
+    unsigned long long count;
+
+    /** The sum of the latencies recorded, in cycles. */
+    uint64_t sum;
+
+    /** The largest latency recorded, in cycles. */
+    uint64_t max;
+} LatencyHist;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty latency histogram.
+ *
+ * @return A pointer to the histogram.
+ */
+LatencyHist *latency_hist_new();
+
+/**
+ * Record one latency in the histogram.
+ *
+ * @param h The histogram.
+ * @param latency The latency to record, in cycles.
+ */
+void latency_hist_record(LatencyHist *h, uint64_t latency);
+
+/**
+ * Get the given percentile of the recorded latencies. The result is the
+ * upper bound of the bucket the percentile falls in (never more than the
+ * largest latency recorded), so it overestimates by at most one bucket.
+ *
+ * @param h The histogram.
+ * @param percentile The percentile to get, between 0 and 100.
+ * @return The percentile in cycles, or 0 if nothing was recorded.
+ */
+uint64_t latency_hist_percentile(const LatencyHist *h, double percentile);
+
+/**
+ * Count the recorded values that are at most the given value. Values in the
+ * bucket the given value falls in count only if the whole bucket is at most
+ * the given value.
+ *
+ * @param h The histogram.
+ * @param value The value to compare against.
+ * @return The number of recorded values at most the given value.
+ */
+unsigned long long latency_hist_count_at_most(LatencyHist *h, uint64_t value);
+
+/**
+ * Print the count, average, p50, p90, p99, p99.9 and maximum of the recorded
+ * values.
+ *
+ * @param h The histogram to print the statistics of.
+ * @param header A label for the histogram, which is used as a prefix for
+ *               each statistic.
+ * @param name The name of the recorded quantity (e.g., LAT for latencies),
+ *             which follows the label in each statistic.
+ */
+void latency_hist_print_stats(LatencyHist *h, const char *header,
+                              const char *name);
+
+#endif // __LATENCY_H__
@@ -13,10 +13,13 @@
 // Defines the functions for the memory system.
 
 #include "memsys.h"
+#include "hostprof.h"
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 // You may add any other #include directives you need here, but make sure they
 // compile on the reference machine!
 
@@ -36,6 +39,36 @@
 /** The hit time of the L2 cache in cycles. */
 #define L2CACHE_HIT_LATENCY 10
 
+/** The extra time to find a line in a victim cache after an L1 miss. */
+#define VICTIM_CACHE_HIT_LATENCY 1
+
+/** The round trip time to the coherence directory at the L2 in cycles. */
+#define COH_DIRECTORY_LATENCY 10
+
+/** The time to invalidate other copies and collect their acks in cycles. */
+#define COH_INVALIDATE_LATENCY 5
+
+/** The time for the owning core to forward a line to another core. */
+#define COH_FORWARD_LATENCY 15
+
+/** The hit time of the L2 TLB in cycles. */
+#define L2TLB_HIT_LATENCY 7
+
+/** The number of page-table levels walked for 4 KB pages. */
+#define PAGE_WALK_LEVELS 4
+
+/** The number of virtual page number bits translated per page-table level. */
+#define PAGE_WALK_BITS_PER_LEVEL 9
+
+/** The size of a page-table entry in bytes. */
+#define PTE_SIZE 8
+
+/**
+ * The physical byte address above which page tables are placed, well clear of
+ * the frames handed out by memsys_convert_vpn_to_pfn().
+ */
+#define PAGE_TABLE_BASE (1ULL << 44)
+
 ///////////////////////////////////////////////////////////////////////////////
 //                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
 ///////////////////////////////////////////////////////////////////////////////
@@ -70,12 +103,110 @@ extern uint64_t L2CACHE_SIZE;
 /** The associativity of the L2 cache. */
 extern uint64_t L2CACHE_ASSOC;
 
+/** The line size of the L2 cache in bytes. 0 means the L1 line size. */
+extern uint64_t L2CACHE_LINESIZE;
+
+/** The set index function of the L1 caches and of the levels below them. */
+extern IndexFunction L1_INDEX_FN;
+extern IndexFunction L2_INDEX_FN;
+
+/** Whether to print the per-set access and miss distribution of each cache. */
+extern bool SET_STATS;
+
+/** Whether to keep and print latency histograms (tail latencies). */
+extern bool LATENCY_HIST;
+
+/**
+ * Whether to record the lifetime statistics of each cache: 0 disables them;
+ * otherwise one in this many lines is tracked for reuse distances.
+ */
+extern uint64_t LIFETIME_STATS;
+
+/** The path prefix of the per-set and per-bank heatmap files (NULL for none). */
+extern const char *HEATMAP_PREFIX;
+
+/**
+ * The number of instruction addresses in the per-instruction miss profile
+ * report, and the path of its CSV file (NULL for none). The profiler is
+ * enabled if either is set.
+ */
+extern unsigned int PCPROF_TOP_N;
+extern const char *PCPROF_CSV;
+
+/** The number of sectors in each L2 cache line. 1 means not sectored. */
+extern unsigned int L2CACHE_SECTORS;
+
 /** The replacement policy to use for the L2 cache. */
 extern ReplacementPolicy L2CACHE_REPL;
 
 /** The number of cores being simulated. */
 extern unsigned int NUM_CORES;
 
+/** The number of entries in each L1 victim cache. 0 disables them. */
+extern uint64_t VICTIM_ENTRIES;
+
+/** The inclusion policy of the L2 cache with respect to the L1 caches. */
+extern InclusionPolicy L2_INCLUSION;
+
+/**
+ * A description of the cache levels below the L1 caches (see
+ * memsys_build_hierarchy()), or NULL for a single shared L2 cache.
+ */
+extern const char *HIERARCHY_DESC;
+
+/** Whether the cores share an address space and keep their L1s coherent. */
+extern bool COHERENCE;
+
+/** The number of banks of each shared cache level. 0 disables banking. */
+extern unsigned int CACHE_BANKS;
+
+/** The number of cycles a bank is busy with each access. */
+extern uint64_t BANK_BUSY_CYCLES;
+
+/** The extra latency to cross each bank between a core and the bank (NUCA). */
+extern uint64_t NUCA_HOP_LATENCY;
+
+/** Whether the L1 data caches write stores through to the next level. */
+extern bool DCACHE_WRITE_THROUGH;
+
+/** Whether the L1 data caches allocate lines on a store miss. */
+extern bool DCACHE_WRITE_ALLOCATE;
+
+/** The number of lines in each write-combining buffer. 0 disables them. */
+extern uint64_t WC_ENTRIES;
+
+/**
+ * The write-back and write-allocate policies of the default L2 cache (0 or
+ * 1), or -1 to follow its inclusion policy.
+ */
+extern int L2_WRITE_BACK;
+extern int L2_WRITE_ALLOC;
+
+/** The number of entries in each L1 TLB. 0 disables the TLBs. */
+extern uint64_t L1TLB_ENTRIES;
+
+/** The associativity of each L1 TLB. */
+extern uint64_t L1TLB_ASSOC;
+
+/** The number of entries in the shared L2 TLB. */
+extern uint64_t L2TLB_ENTRIES;
+
+/** The associativity of the shared L2 TLB. */
+extern uint64_t L2TLB_ASSOC;
+
+/** The page size in bytes used by the TLBs (4 KB or 2 MB). */
+extern uint64_t TLB_PAGE_SIZE;
+
+/** The policy used to place virtual pages in physical frames. */
+extern FrameAllocPolicy FRAME_ALLOC_POLICY;
+
+/**
+ * For the page-coloring frame allocator, the number of page colors of the
+ * last shared cache level that core 0 may use. The remaining colors are for
+ * core 1. 0 means half.
+ */
+extern uint64_t COLOR_CORE0;
+
 /**
  * The current clock cycle number.
  * 
@@ -83,6 +214,9 @@ extern unsigned int NUM_CORES;
  */
 extern uint64_t current_cycle;
 
+/** The host time profile of the simulator, or NULL if disabled. */
+extern HostProfile *hostprof;
+
 ///////////////////////////////////////////////////////////////////////////////
 //                           FUNCTION DEFINITIONS                            //
 ///////////////////////////////////////////////////////////////////////////////
@@ -98,10 +232,16 @@ MemorySystem *memsys_new()
 {
     MemorySystem *sys = (MemorySystem *)calloc(1, sizeof(MemorySystem));
 
+    if (PCPROF_TOP_N || PCPROF_CSV)
+    {
+        sys->pcprof = pcprof_new();
+    }
+
     if (SIM_MODE == SIM_MODE_A)
     {
         sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE,
                                 REPL_POLICY);
+        cache_set_index_fn(sys->dcache, L1_INDEX_FN);
     }
 
     if (SIM_MODE == SIM_MODE_B || SIM_MODE == SIM_MODE_C)
@@ -110,15 +250,30 @@ MemorySystem *memsys_new()
                                 REPL_POLICY);
         sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE,
                                 REPL_POLICY);
-        sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE,
-                                 REPL_POLICY);
+        cache_set_index_fn(sys->dcache, L1_INDEX_FN);
+        cache_set_index_fn(sys->icache, L1_INDEX_FN);
+        memsys_build_hierarchy(sys);
         sys->dram = dram_new();
+
+        if (WC_ENTRIES)
+        {
+            sys->wcbuf_coreid[0] = (WriteCombiningBuffer *)calloc(
+                1, sizeof(WriteCombiningBuffer));
+        }
+
+        if (VICTIM_ENTRIES)
+        {
+            // A fully-associative cache is a cache with a single set.
+            sys->dcache_vc = cache_new(VICTIM_ENTRIES * CACHE_LINESIZE,
+                                       VICTIM_ENTRIES, CACHE_LINESIZE, LRU);
+            sys->icache_vc = cache_new(VICTIM_ENTRIES * CACHE_LINESIZE,
+                                       VICTIM_ENTRIES, CACHE_LINESIZE, LRU);
+        }
     }
 
     if (SIM_MODE == SIM_MODE_DEF)
     {
-        sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE,
-                                 L2CACHE_REPL);
+        memsys_build_hierarchy(sys);
         sys->dram = dram_new();
         for (unsigned int i = 0; i < NUM_CORES; i++)
         {
@@ -126,12 +281,277 @@ MemorySystem *memsys_new()
                                               CACHE_LINESIZE, REPL_POLICY);
             sys->icache_coreid[i] = cache_new(ICACHE_SIZE, ICACHE_ASSOC,
                                               CACHE_LINESIZE, REPL_POLICY);
+            cache_set_index_fn(sys->dcache_coreid[i], L1_INDEX_FN);
+            cache_set_index_fn(sys->icache_coreid[i], L1_INDEX_FN);
+            sys->asid_coreid[i] = COHERENCE ? 0 : i;
+
+            if (WC_ENTRIES)
+            {
+                sys->wcbuf_coreid[i] = (WriteCombiningBuffer *)calloc(
+                    1, sizeof(WriteCombiningBuffer));
+            }
+
+            if (VICTIM_ENTRIES)
+            {
+                sys->dcache_vc_coreid[i] = cache_new(
+                    VICTIM_ENTRIES * CACHE_LINESIZE, VICTIM_ENTRIES,
+                    CACHE_LINESIZE, LRU);
+                sys->icache_vc_coreid[i] = cache_new(
+                    VICTIM_ENTRIES * CACHE_LINESIZE, VICTIM_ENTRIES,
+                    CACHE_LINESIZE, LRU);
+            }
+        }
+
+        if (FRAME_ALLOC_POLICY != FRAME_ALLOC_FIXED)
+        {
+            // Frames whose numbers differ by a multiple of num_colors map to
+            // the same sets of the last shared cache level. That only holds
+            // if the level takes its set index from the low address bits.
+            // Without such a level, there is a single color.
+            CacheLevel *shared = NULL;
+            for (unsigned int k = 0; k < sys->nof_levels; k++)
+            {
+                if (!sys->levels[k].is_private)
+                {
+                    shared = &sys->levels[k];
+                }
+            }
+            bool has_colors = shared &&
+                              shared->caches[0]->index_fn == INDEX_MODULO;
+            uint64_t num_colors = 1;
+            if (has_colors)
+            {
+                num_colors = shared->caches[0]->nof_sets *
+                             shared->blocks_per_line * CACHE_LINESIZE /
+                             PAGE_SIZE;
+                if (num_colors < 1)
+                {
+                    num_colors = 1;
+                }
+            }
+
+            // The other policies only count the frames of each color.
+            uint64_t core0_colors = 0;
+            if (FRAME_ALLOC_POLICY == FRAME_ALLOC_COLOR)
+            {
+                if (!has_colors)
+                {
+                    fprintf(stderr, "Error: page coloring needs a shared "
+                                    "cache level with modulo indexing\n");
+                    exit(2);
+                }
+                core0_colors = COLOR_CORE0 ? COLOR_CORE0 : num_colors / 2;
+                if (num_colors < 2 || core0_colors >= num_colors)
+                {
+                    fprintf(stderr, "Error: need 1 to %ld colors for core 0 "
+                                    "(the shared cache has %ld page "
+                                    "colors)\n",
+                            (long)num_colors - 1, (long)num_colors);
+                    exit(2);
+                }
+            }
+            sys->frames = framealloc_new(FRAME_ALLOC_POLICY, num_colors,
+                                         core0_colors);
+        }
+
+        if (L1TLB_ENTRIES)
+        {
+            // A TLB is a cache of one-"byte" lines, one per translation.
+            sys->l2tlb = cache_new(L2TLB_ENTRIES, L2TLB_ASSOC, 1, LRU);
+            for (unsigned int i = 0; i < NUM_CORES; i++)
+            {
+                sys->itlb_coreid[i] = cache_new(L1TLB_ENTRIES, L1TLB_ASSOC,
+                                                1, LRU);
+                sys->dtlb_coreid[i] = cache_new(L1TLB_ENTRIES, L1TLB_ASSOC,
+                                                1, LRU);
+            }
+        }
+    }
+
+    if (LATENCY_HIST)
+    {
+        for (unsigned int t = 0; t < 3; t++)
+        {
+            for (unsigned int i = 0; i < NUM_CORES; i++)
+            {
+                sys->hist_type_coreid[t][i] = latency_hist_new();
+            }
+        }
+        for (unsigned int k = 0; k < sys->nof_levels; k++)
+        {
+            sys->levels[k].hist_read = latency_hist_new();
+        }
+        if (sys->dram)
+        {
+            sys->hist_dram = latency_hist_new();
+        }
+    }
+
+    if (LIFETIME_STATS)
+    {
+        Cache *caches[MAX_MEMSYS_CACHES];
+        char labels[MAX_MEMSYS_CACHES][16];
+        unsigned int nof_caches = memsys_list_caches(sys, caches, labels);
+
+        for (unsigned int c = 0; c < nof_caches; c++)
+        {
+            cache_enable_lifetime_stats(caches[c], LIFETIME_STATS);
         }
     }
 
     return sys;
 }
 
+/**
+ * Build the cache levels below the L1 caches from HIERARCHY_DESC, or a single
+ * shared L2 cache from the L2 options if no description was given.
+ *
+ * A description is a comma-separated list of levels, from the one closest to
+ * the L1 caches outwards, each given as
+ * name:sizeKB:assoc:latency:scope:inclusion, where scope is p (one cache per
+ * core) or s (shared by all cores) and inclusion is an InclusionPolicy. For
+ * example, L2:256:8:12:p:0,L3:8192:16:40:s:1 models private L2 caches and a
+ * shared inclusive L3 cache. Exit with an error on a malformed description.
+ *
+ * @param sys The memory system to add the cache levels to.
+ */
+void memsys_build_hierarchy(MemorySystem *sys)
+{
+    ReplacementPolicy repl = (SIM_MODE == SIM_MODE_DEF) ? L2CACHE_REPL
+                                                        : REPL_POLICY;
+
+    if (!HIERARCHY_DESC)
+    {
+        CacheLevel *level = &sys->levels[0];
+        strcpy(level->name, "L2");
+        level->is_private = false;
+        level->hit_latency = L2CACHE_HIT_LATENCY;
+        level->inclusion = L2_INCLUSION;
+        // Without an explicit policy, a non-inclusive L2 passes writebacks
+        // on to DRAM, and an inclusive one absorbs them in its copy.
+        level->write_back = (L2_WRITE_BACK >= 0) ? L2_WRITE_BACK != 0
+                            : L2_INCLUSION == INCLUSIVE;
+        level->write_allocate = (L2_WRITE_ALLOC >= 0) ? L2_WRITE_ALLOC != 0
+                                : false;
+        level->nof_banks = CACHE_BANKS;
+        sys->nof_levels = 1;
+        uint64_t line_size = L2CACHE_LINESIZE ? L2CACHE_LINESIZE
+                                              : CACHE_LINESIZE;
+        if (!memsys_level_set_lines(sys, 0, line_size, L2CACHE_SECTORS) ||
+            L2CACHE_SIZE < L2CACHE_ASSOC * line_size)
+        {
+            fprintf(stderr, "Error: bad L2 line size or sectors (the line "
+                            "size must be a power of two multiple of %ld, "
+                            "with 1 to 32 sectors of at least that size, and "
+                            "an exclusive L2 keeps that size)\n",
+                    CACHE_LINESIZE);
+            exit(2);
+        }
+        level->caches[0] = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, line_size,
+                                     repl);
+        cache_set_index_fn(level->caches[0], L2_INDEX_FN);
+        return;
+    }
+
+    char *desc = strdup(HIERARCHY_DESC);
+    for (char *tok = strtok(desc, ","); tok; tok = strtok(NULL, ","))
+    {
+        char name[8];
+        unsigned long size_kb, assoc, latency;
+        char scope;
+        int inclusion;
+        int write_back = -1;
+        int write_alloc = -1;
+        unsigned long line_size = CACHE_LINESIZE;
+        unsigned long nof_sectors = 1;
+        int nof_fields = sscanf(tok, "%7[^:]:%lu:%lu:%lu:%c:%d:%d:%d:%lu:%lu",
+                                name, &size_kb, &assoc, &latency, &scope,
+                                &inclusion, &write_back, &write_alloc,
+                                &line_size, &nof_sectors);
+
+        if (sys->nof_levels == MAX_CACHE_LEVELS ||
+            (nof_fields != 6 && nof_fields != 8 && nof_fields != 10) ||
+            (scope != 'p' && scope != 's') || (scope == 'p' && COHERENCE) ||
+            inclusion < NON_INCLUSIVE ||
+            inclusion > EXCLUSIVE || (inclusion == EXCLUSIVE && COHERENCE) ||
+            assoc < 1 ||
+            assoc > MAX_WAYS_PER_CACHE_SET || size_kb * 1024 <
+            assoc * line_size)
+        {
+            fprintf(stderr, "Error: bad cache level \"%s\" in hierarchy "
+                            "(expected name:sizeKB:assoc:latency:p|s:0-2"
+                            "[:wb:wa[:lineB:sectors]], "
+                            "at most %d levels, shared and not exclusive "
+                            "with coherence)\n", tok, MAX_CACHE_LEVELS);
+            exit(2);
+        }
+
+        CacheLevel *level = &sys->levels[sys->nof_levels++];
+        level->inclusion = (InclusionPolicy)inclusion;
+        if (!memsys_level_set_lines(sys, sys->nof_levels - 1, line_size,
+                                    nof_sectors))
+        {
+            fprintf(stderr, "Error: bad line size or sectors in cache level "
+                            "\"%s\" (the line size must be a power of two "
+                            "multiple of %ld and no smaller than the level "
+                            "above, with 1 to 32 sectors of at least %ld "
+                            "bytes, and exclusive levels keep %ld-byte "
+                            "lines)\n", tok, CACHE_LINESIZE, CACHE_LINESIZE,
+                    CACHE_LINESIZE);
+            exit(2);
+        }
+        strcpy(level->name, name);
+        level->is_private = (scope == 'p');
+        level->hit_latency = latency;
+        level->write_back = (write_back >= 0) ? write_back != 0
+                            : inclusion == INCLUSIVE;
+        level->write_allocate = (write_alloc >= 0) ? write_alloc != 0 : false;
+        level->nof_banks = level->is_private ? 0 : CACHE_BANKS;
+        for (unsigned int i = 0; i < (level->is_private ? NUM_CORES : 1); i++)
+        {
+            level->caches[i] = cache_new(size_kb * 1024, assoc, line_size,
+                                         repl);
+            cache_set_index_fn(level->caches[i], L2_INDEX_FN);
+        }
+    }
+    free(desc);
+}
+
+/**
+ * Set the line size and number of sectors of the given cache level, after
+ * checking them. The line size must be a power of two multiple of the L1
+ * line size and no smaller than that of the level above, so each line of a
+ * level covers whole lines of the levels above. Sectors must be at least an
+ * L1 line, and an exclusive level, which swaps whole lines with the level
+ * above, keeps L1-sized lines.
+ *
+ * @param sys The memory system being built.
+ * @param level The index of the level. Its inclusion policy must be set.
+ * @param line_size The line size of the level, in bytes.
+ * @param nof_sectors The number of sectors per line (1 if not sectored).
+ * @return Whether the line size and number of sectors are valid.
+ */
+bool memsys_level_set_lines(MemorySystem *sys, unsigned int level,
+                            uint64_t line_size, unsigned long nof_sectors)
+{
+    CacheLevel *lvl = &sys->levels[level];
+    uint64_t blocks_per_line = line_size / CACHE_LINESIZE;
+    uint64_t above = level ? sys->levels[level - 1].blocks_per_line : 1;
+
+    if (line_size % CACHE_LINESIZE || !blocks_per_line ||
+        (blocks_per_line & (blocks_per_line - 1)) ||
+        blocks_per_line < above || nof_sectors < 1 || nof_sectors > 32 ||
+        (nof_sectors & (nof_sectors - 1)) || nof_sectors > blocks_per_line ||
+        (lvl->inclusion == EXCLUSIVE && blocks_per_line > 1))
+    {
+        return false;
+    }
+
+    lvl->blocks_per_line = blocks_per_line;
+    lvl->nof_sectors = nof_sectors;
+    return true;
+}
+
 /**
  * Access the given memory address from an instruction fetch or load/store.
  * 
@@ -150,11 +570,19 @@ uint64_t memsys_access(MemorySystem *sys, uint64_t addr, AccessType type,
                        unsigned int core_id)
 {
     uint64_t delay = 0;
+    PcProfCounts pcprof_before;
 
     // All cache transactions happen at line granularity, so we convert the
     // byte address to a cache line address.
     uint64_t line_addr = addr / CACHE_LINESIZE;
 
+    sys->request_id++;
+
+    if (sys->pcprof)
+    {
+        memsys_pcprof_counts(sys, core_id, &pcprof_before);
+    }
+
     if (SIM_MODE == SIM_MODE_A)
     {
         delay = memsys_access_modeA(sys, line_addr, type, core_id);
@@ -189,9 +617,53 @@ uint64_t memsys_access(MemorySystem *sys, uint64_t addr, AccessType type,
         sys->stat_store_delay += delay;
     }
 
+    memsys_record_latency(sys->hist_type_coreid[type][core_id], delay);
+
+    if (sys->pcprof)
+    {
+        PcProfCounts pcprof_after;
+        memsys_pcprof_counts(sys, core_id, &pcprof_after);
+        pcprof_record(sys->pcprof, sys->inst_addr_coreid[core_id], type,
+                      delay, &pcprof_before, &pcprof_after);
+    }
+
     return delay;
 }
 
+/**
+ * Take a snapshot of the miss counters that an access by the given core can
+ * advance: its L1 caches, the first cache level below them, and DRAM.
+ *
+ * @param sys The memory system.
+ * @param core_id The CPU core ID.
+ * @param counts The snapshot to fill in.
+ */
+void memsys_pcprof_counts(MemorySystem *sys, unsigned int core_id,
+                          PcProfCounts *counts)
+{
+    Cache *icache = (SIM_MODE == SIM_MODE_DEF) ? sys->icache_coreid[core_id]
+                                               : sys->icache;
+    Cache *dcache = (SIM_MODE == SIM_MODE_DEF) ? sys->dcache_coreid[core_id]
+                                               : sys->dcache;
+
+    counts->icache_miss = icache ? icache->stat_read_miss : 0;
+    counts->dcache_miss = dcache->stat_read_miss + dcache->stat_write_miss;
+    counts->l2_miss = 0;
+    counts->dram_access = 0;
+
+    if (sys->nof_levels)
+    {
+        Cache *l2 = memsys_level_cache(&sys->levels[0], core_id);
+        counts->l2_miss = l2->stat_read_miss + l2->stat_write_miss;
+    }
+
+    if (sys->dram)
+    {
+        counts->dram_access = sys->dram->stat_read_access +
+                              sys->dram->stat_write_access;
+    }
+}
+
 /**
  * In mode A, access the given memory address from a load or store.
  * 
@@ -302,40 +774,15 @@ uint64_t memsys_access_modeBC(MemorySystem *sys, uint64_t line_addr,
 
     if(needs_dcache_access) {
         delay += DCACHE_HIT_LATENCY;
-        outcome = cache_access(sys->dcache, line_addr, is_write, core_id);
-
-        if(outcome == MISS) {
-            delay += memsys_l2_access(sys, line_addr, false, core_id);
-            
-            #ifdef DEBUG
-                printf("\tInstalling line in L1 cache!\n");
-            #endif
-            
-            // If num of dirty evicts goes up for the cache, that means the L1 entry was dirty.
-            uint64_t nof_dirty_evicts = sys->dcache->stat_dirty_evicts;
-            cache_install(sys->dcache, line_addr, is_write, core_id);
-            if (nof_dirty_evicts != sys->dcache->stat_dirty_evicts) {
-                #ifdef DEBUG
-                    printf("\tEvicted L1 entry was dirty! Performing writeback (addr: %lld)\n", (sys->dcache->LEL.tag << (u_int64_t)log2(sys->dcache->nof_sets)) | (((1 << (u_int64_t)log2(sys->dcache->nof_sets)) - 1) & line_addr) );
-                #endif
-                delay += memsys_l2_access(sys, (sys->dcache->LEL.tag << (u_int64_t)log2(sys->dcache->nof_sets)) | (((1 << (u_int64_t)log2(sys->dcache->nof_sets)) - 1) & line_addr) , true, core_id);
-            }
-        }
-
+        delay += memsys_dcache_access(sys, sys->dcache, sys->dcache_vc,
+                                      line_addr, is_write, core_id);
     } else if (needs_icache_access) {
         delay += DCACHE_HIT_LATENCY;
         outcome = cache_access(sys->icache, line_addr, is_write, core_id);
 
         if(outcome == MISS) {
-            delay += memsys_l2_access(sys, line_addr, false, core_id);
-            
-            #ifdef DEBUG
-                printf("\tInstalling line in L1 cache!\n");
-            #endif
-            
-            // Icache data should never be modified or dirties so no need to check here
-            cache_install(sys->icache, line_addr, is_write, core_id);
-            
+            delay += memsys_l1_fill(sys, sys->icache, sys->icache_vc,
+                                    line_addr, is_write, core_id);
         }
     }
 
@@ -343,12 +790,15 @@ uint64_t memsys_access_modeBC(MemorySystem *sys, uint64_t line_addr,
 }
 
 /**
- * Access the given address through the shared L2 cache.
+ * Access the given address through the cache levels below the L1 caches.
  * 
- * Return the delay in cycles incurred by the L2 (and possibly DRAM) access.
+ * Return the delay in cycles incurred by the L2 (and possibly lower levels
+ * and DRAM) access.
  * 
  * This is intended to be implemented in part B and used in parts B through F
- * for icache misses, dcache misses, and dcache writebacks.
+ * for icache misses, dcache misses, and dcache writebacks. It is a thin
+ * wrapper around memsys_level_read() and memsys_level_evict() for requesters
+ * that do not keep the line, such as page walks.
  * 
  * @param sys The memory system to use for the access.
  * @param line_addr The (physical) address of the cache line to access (in
@@ -361,174 +811,1989 @@ uint64_t memsys_access_modeBC(MemorySystem *sys, uint64_t line_addr,
 uint64_t memsys_l2_access(MemorySystem *sys, uint64_t line_addr,
                           bool is_writeback, unsigned int core_id)
 {
-    #ifdef DEBUG      
-        printf("\tAccessing L2 cache!\n");
+    if (is_writeback) {
+        return memsys_level_evict(sys, 0, line_addr, 1, true, core_id);
+    }
+    return memsys_level_read(sys, 0, line_addr, 1, core_id, NULL);
+}
+
+/**
+ * Handle an L1 cache miss: fetch the line (from the victim cache if the L1
+ * has one and it holds the line, otherwise from the levels below), install
+ * it in the L1 cache, and pass the line the L1 evicts on to the first level.
+ *
+ * With a victim cache, the L1 victim (clean or dirty) is saved there and
+ * only the line the victim cache evicts goes on to the levels below. What
+ * happens to an evicted line there depends on their inclusion policies; see
+ * memsys_level_evict().
+ *
+ * @param sys The memory system to use for the access.
+ * @param l1 The L1 cache that missed.
+ * @param vc The victim cache of that L1 cache, or NULL if it has none.
+ * @param line_addr The (physical) address of the cache line that missed (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access that missed is a write.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
+ */
+uint64_t memsys_l1_fill(MemorySystem *sys, Cache *l1, Cache *vc,
+                        uint64_t line_addr, bool is_write,
+                        unsigned int core_id)
+{
+    uint64_t delay = 0;
+    bool was_dirty = false;
+
+    if (vc && cache_access(vc, line_addr, false, core_id) == HIT) {
+        #ifdef DEBUG
+            printf("\tHit in the victim cache! Swapping line back into L1\n");
+        #endif
+        delay += VICTIM_CACHE_HIT_LATENCY;
+        was_dirty = cache_invalidate(vc, line_addr);
+    } else {
+        delay += memsys_level_read(sys, 0, line_addr, 1, core_id,
+                                   &was_dirty);
+    }
+
+    #ifdef DEBUG
+        printf("\tInstalling line in L1 cache!\n");
     #endif
-    uint64_t delay = L2CACHE_HIT_LATENCY;
-    if (!is_writeback) {
-        CacheResult outcome = cache_access(sys->l2cache, line_addr, is_writeback, core_id);
 
-        if (outcome == MISS) {
-            delay += dram_access(sys->dram, line_addr, is_writeback);
+    cache_install(l1, line_addr, is_write, core_id);
+    if (was_dirty) {
+        cache_set_dirty(l1, line_addr);
+    }
 
-            #ifdef DEBUG
-                printf("\tInstalling line in L2 cache!\n");
-            #endif
+    if (!l1->LEL.valid) {
+        return delay;
+    }
 
-            // If num of dirty evicts goes up for the cache, that means the L1 entry was dirty.
-            uint64_t nof_dirty_evicts = sys->dcache->stat_dirty_evicts;
-            cache_install(sys->l2cache, line_addr, is_writeback, core_id);
-            if (nof_dirty_evicts != sys->dcache->stat_dirty_evicts) {
-                #ifdef DEBUG
-                    printf("\tEvicted L2 entry was dirty! Performing writeback (addr: %lld)\n", (sys->l2cache->LEL.tag << (u_int64_t)log2(sys->l2cache->nof_sets)) | (((1 << (u_int64_t)log2(sys->l2cache->nof_sets)) - 1) & line_addr) );
-                #endif
-                delay += dram_access(sys->dram, line_addr, is_writeback);
+    if (!vc) {
+        #ifdef DEBUG
+            if (l1->LEL.dirty) {
+                printf("\tEvicted L1 entry was dirty! Performing writeback (addr: %ld)\n", l1->LEL_line_addr);
             }
-        }
-    } else {
-        delay += dram_access(sys->dram, line_addr, is_writeback);
+        #endif
+        return delay + memsys_level_evict(sys, 0, l1->LEL_line_addr, 1,
+                                          l1->LEL.dirty, core_id);
+    }
+
+    cache_install(vc, l1->LEL_line_addr, false, core_id);
+    if (l1->LEL.dirty) {
+        cache_set_dirty(vc, l1->LEL_line_addr);
     }
 
+    if (vc->LEL.valid) {
+        #ifdef DEBUG
+            if (vc->LEL.dirty) {
+                printf("\tEvicted victim cache entry was dirty! Performing writeback (addr: %ld)\n", vc->LEL_line_addr);
+            }
+        #endif
+        delay += memsys_level_evict(sys, 0, vc->LEL_line_addr, 1,
+                                    vc->LEL.dirty, core_id);
+    }
 
     return delay;
 }
 
 /**
- * In mode D, E, or F, access the given virtual address from an instruction
- * fetch or load/store.
- * 
- * Note that you will need to access the per-core icache and dcache. Also note
- * that all caches are physically indexed and physically tagged.
- * 
- * Return the delay in cycles incurred by this memory access. It is intended
- * that the calling function will be responsible for updating the statistics
- * accordingly.
- * 
- * This is intended to be implemented in part D.
- * 
+ * Access an L1 data cache for a load or store, applying the data cache write
+ * policies, and handle a miss.
+ *
+ * A store hit marks the line dirty under write-back, or sends the write down
+ * under write-through. A store miss allocates the line (write-allocate) or
+ * sends the write straight down (no-write-allocate). Writes sent down go
+ * through the core's write-combining buffer if there is one. A load miss
+ * first drains any combined write to the same line.
+ *
  * @param sys The memory system to use for the access.
- * @param v_line_addr The virtual address of the cache line to access (in units
- *                    of the cache line size, i.e., excluding the line offset
- *                    bits).
- * @param type The type of memory access.
+ * @param dcache The L1 data cache of the core.
+ * @param vc The victim cache of that data cache, or NULL if it has none.
+ * @param line_addr The (physical) address of the cache line to access (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access is a store.
  * @param core_id The CPU core ID that requested this access.
- * @return The delay in cycles incurred by this memory access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
  */
-uint64_t memsys_access_modeDEF(MemorySystem *sys, uint64_t v_line_addr,
-                               AccessType type, unsigned int core_id)
+uint64_t memsys_dcache_access(MemorySystem *sys, Cache *dcache, Cache *vc,
+                              uint64_t line_addr, bool is_write,
+                              unsigned int core_id)
 {
     uint64_t delay = 0;
-    uint64_t p_line_addr = 0;
+    WriteCombiningBuffer *wc = sys->wcbuf_coreid[core_id];
+
+    if (!is_write) {
+        if (cache_access(dcache, line_addr, false, core_id) == HIT) {
+            return 0;
+        }
 
-    // TODO: First convert lineaddr from virtual (v) to physical (p) using the
-    //       function memsys_convert_vpn_to_pfn(). Page size is defined to be
-    //       4 KB, as indicated by the PAGE_SIZE constant.
-    // Note: memsys_convert_vpn_to_pfn() operates at page granularity and
-    //       returns a page number.
-    p_line_addr = v_line_addr; // Replace this with a correct implementation.
+        // A combined write to this line must reach the next level before
+        // the line is read back from it. The rest stay oldest first.
+        for (unsigned int i = 0; wc && i < wc->count; i++) {
+            if (wc->line_addrs[i] == line_addr) {
+                wc->count--;
+                memmove(&wc->line_addrs[i], &wc->line_addrs[i + 1],
+                        (wc->count - i) * sizeof(uint64_t));
+                wc->stat_flushes++;
+                delay += memsys_level_evict(sys, 0, line_addr, 1, true,
+                                            core_id);
+                break;
+            }
+        }
 
-    if (type == ACCESS_TYPE_IFETCH)
-    {
-        // TODO: Simulate the instruction fetch and update delay accordingly.
+        return delay + memsys_l1_fill(sys, dcache, vc, line_addr, false,
+                                      core_id);
     }
 
-    if (type == ACCESS_TYPE_LOAD)
-    {
-        // TODO: Simulate the data load and update delay accordingly.
+    if (cache_access(dcache, line_addr, true, core_id) == MISS) {
+        if (!DCACHE_WRITE_ALLOCATE) {
+            #ifdef DEBUG
+                printf("\tStore miss without write-allocate! Sending write down\n");
+            #endif
+            return memsys_l1_write_out(sys, line_addr, core_id);
+        }
+        delay += memsys_l1_fill(sys, dcache, vc, line_addr, true, core_id);
     }
 
-    if (type == ACCESS_TYPE_STORE)
-    {
-        // TODO: Simulate the data store and update delay accordingly.
+    if (DCACHE_WRITE_THROUGH) {
+        cache_find_line(dcache, line_addr)->dirty = false;
+        delay += memsys_l1_write_out(sys, line_addr, core_id);
     }
 
-    if (p_line_addr) {
-        return delay;
+    return delay;
+}
+
+/**
+ * Send a write of the given line from a core's L1 data cache to the first
+ * cache level, combining it with earlier writes to the same line if the core
+ * has a write-combining buffer. A full buffer first flushes its oldest line.
+ *
+ * @param sys The memory system to use for the access.
+ * @param line_addr The (physical) address of the written cache line (in units
+ *                  of the cache line size).
+ * @param core_id The CPU core ID that wrote the line.
+ * @return The delay in cycles incurred by sending the write down.
+ */
+uint64_t memsys_l1_write_out(MemorySystem *sys, uint64_t line_addr,
+                             unsigned int core_id)
+{
+    WriteCombiningBuffer *wc = sys->wcbuf_coreid[core_id];
+    uint64_t delay = 0;
+
+    if (!wc) {
+        return memsys_level_evict(sys, 0, line_addr, 1, true, core_id);
+    }
+
+    wc->stat_writes++;
+    for (unsigned int i = 0; i < wc->count; i++) {
+        if (wc->line_addrs[i] == line_addr) {
+            wc->stat_coalesced++;
+            return 0;
+        }
     }
+
+    if (wc->count == WC_ENTRIES) {
+        delay += memsys_wcbuf_flush_oldest(sys, wc, core_id);
+    }
+
+    wc->line_addrs[wc->count++] = line_addr;
     return delay;
 }
 
 /**
- * Convert the given virtual page number (VPN) to its corresponding physical
- * frame number (PFN; also known as physical page number, or PPN).
- * 
- * This is implemented for you and shouldn't need to be modified.
- * 
- * Note that you will need additional operations to obtain the VPN from the
- * v_line_addr and to get the physical line_addr using the PFN.
- * 
- * @param sys The memory system being used.
- * @param vpn The virtual page number to convert.
- * @param core_id The CPU core ID that requested this access.
- * @return The physical frame number corresponding to the given VPN.
+ * Flush the oldest line of a write-combining buffer to the first cache level.
+ *
+ * @param sys The memory system to use for the access.
+ * @param wc The write-combining buffer, which must not be empty.
+ * @param core_id The CPU core ID that owns the buffer.
+ * @return The delay in cycles incurred by sending the write down.
  */
-uint64_t memsys_convert_vpn_to_pfn(MemorySystem *sys, uint64_t vpn,
+uint64_t memsys_wcbuf_flush_oldest(MemorySystem *sys,
+                                   WriteCombiningBuffer *wc,
                                    unsigned int core_id)
 {
-    assert(NUM_CORES == 2);
-    uint64_t tail = vpn & 0x000fffff;
-    uint64_t head = vpn >> 20;
-    uint64_t pfn = tail + (core_id << 21) + (head << 21);
-    return pfn;
+    uint64_t delay = memsys_level_evict(sys, 0, wc->line_addrs[0], 1, true,
+                                        core_id);
+
+    wc->stat_flushes++;
+    wc->count--;
+    memmove(&wc->line_addrs[0], &wc->line_addrs[1],
+            wc->count * sizeof(uint64_t));
+    return delay;
 }
 
 /**
- * Print the statistics of the memory system.
- * 
- * This is implemented for you. You must not modify its output format.
- * 
- * @param dram The memory system to print the statistics of.
+ * Flush every line of the given core's write-combining buffer, if it has
+ * one, to the first cache level. Used at the end of the simulation, so the
+ * pending writes reach the caches and DRAM before the statistics are
+ * printed.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID whose write-combining buffer to flush.
  */
-void memsys_print_stats(MemorySystem *sys)
+void memsys_flush_wcbuf(MemorySystem *sys, unsigned int core_id)
 {
-    double ifetch_delay_avg = 0;
-    double load_delay_avg = 0;
-    double store_delay_avg = 0;
+    WriteCombiningBuffer *wc = sys->wcbuf_coreid[core_id];
 
-    if (sys->stat_ifetch_access)
-    {
-        ifetch_delay_avg = (double)(sys->stat_ifetch_delay) / (double)(sys->stat_ifetch_access);
+    while (wc && wc->count) {
+        memsys_wcbuf_flush_oldest(sys, wc, core_id);
+    }
+}
+
+/**
+ * Get the cache of the given level that serves the given core.
+ *
+ * @param level The cache level.
+ * @param core_id The CPU core ID.
+ * @return The core's private cache, or the shared cache of the level.
+ */
+Cache *memsys_level_cache(CacheLevel *level, unsigned int core_id)
+{
+    return level->caches[level->is_private ? core_id : 0];
+}
+
+/**
+ * Get the time the given level takes to serve an access to the given line
+ * from the given core, and update the bank statistics.
+ *
+ * This is the level's hit latency, plus for a banked level any time spent
+ * queued behind earlier requests to the same bank and, with NUCA, the time
+ * to cross the banks between the core and the line's bank.
+ *
+ * @param sys The memory system, whose request in flight makes the access.
+ * @param lvl The cache level being accessed.
+ * @param line_addr The (physical) address of the cache line (in units of the
+ *                  cache line size).
+ * @param core_id The CPU core ID that requested the access.
+ * @return The delay in cycles incurred by the access at this level.
+ */
+uint64_t memsys_level_latency(MemorySystem *sys, CacheLevel *lvl,
+                              uint64_t line_addr, unsigned int core_id)
+{
+    if (!lvl->nof_banks) {
+        return lvl->hit_latency;
+    }
+
+    unsigned int bank = line_addr % lvl->nof_banks;
+    uint64_t queue_delay = 0;
+    uint64_t nuca_delay = 0;
+
+    // All accesses of a request are timed at the cycle it was issued, so a
+    // later access of the same request (e.g., the writeback of the L1
+    // victim, which maps to the bank of the fill) would otherwise queue
+    // behind the request itself. It only keeps the bank busy for longer.
+    if (lvl->bank_request[bank] == sys->request_id) {
+        lvl->bank_busy_until[bank] += BANK_BUSY_CYCLES;
+    } else {
+        if (lvl->bank_busy_until[bank] > current_cycle) {
+            queue_delay = lvl->bank_busy_until[bank] - current_cycle;
+        }
+        lvl->bank_busy_until[bank] = current_cycle + queue_delay +
+                                     BANK_BUSY_CYCLES;
+        lvl->bank_request[bank] = sys->request_id;
+    }
+
+    if (NUCA_HOP_LATENCY) {
+        // The banks sit in a row with the cores spread evenly along it, so
+        // core 0 is next to bank 0 and the last core next to the last bank.
+        unsigned int last_bank = lvl->nof_banks - 1;
+        unsigned int core_pos = (NUM_CORES > 1)
+                                ? core_id * last_bank / (NUM_CORES - 1) : 0;
+        unsigned int hops = (core_pos > bank) ? core_pos - bank
+                                              : bank - core_pos;
+        nuca_delay = hops * NUCA_HOP_LATENCY;
+    }
+
+    lvl->stat_bank_access[bank]++;
+    lvl->stat_bank_queue_delay[bank] += queue_delay;
+    lvl->stat_nuca_delay += nuca_delay;
+
+    #ifdef DEBUG
+        printf("\t%s bank %d (queued: %ld, nuca: %ld)\n", lvl->name, bank, queue_delay, nuca_delay);
+    #endif
+
+    return lvl->hit_latency + queue_delay + nuca_delay;
+}
+
+/**
+ * Get the sectors of the given level's line that the given run of L1-sized
+ * blocks touches, as a bit mask. The run is clipped to the line holding its
+ * first block. A level that is not sectored has a single sector.
+ *
+ * @param lvl The cache level.
+ * @param line_addr The (physical) address of the first block (in units of the
+ *                  L1 cache line size).
+ * @param nof_blocks The number of blocks in the run.
+ * @return The mask of sectors touched.
+ */
+uint32_t memsys_level_sectors(CacheLevel *lvl, uint64_t line_addr,
+                              uint64_t nof_blocks)
+{
+    uint64_t blocks_per_sector = lvl->blocks_per_line / lvl->nof_sectors;
+    uint64_t first = line_addr % lvl->blocks_per_line;
+    uint64_t last = first + nof_blocks - 1;
+    uint32_t sectors = 0;
+
+    if (last >= lvl->blocks_per_line) {
+        last = lvl->blocks_per_line - 1;
+    }
+
+    for (uint64_t s = first / blocks_per_sector;
+         s <= last / blocks_per_sector; s++) {
+        sectors |= 1u << s;
+    }
+
+    return sectors;
+}
+
+/**
+ * Get the run of L1-sized blocks that spans the given sectors of one of the
+ * given level's lines, from the first sector in the mask to the last.
+ *
+ * @param lvl The cache level.
+ * @param key The address of the line in the level's cache (in units of the
+ *            level's line size).
+ * @param sectors The mask of sectors. Must not be empty.
+ * @param nof_blocks Set to the number of blocks in the run.
+ * @return The (physical) address of the first block (in units of the L1
+ *         cache line size).
+ */
+uint64_t memsys_level_span(CacheLevel *lvl, uint64_t key, uint32_t sectors,
+                           uint64_t *nof_blocks)
+{
+    uint64_t blocks_per_sector = lvl->blocks_per_line / lvl->nof_sectors;
+    unsigned int first = 0;
+    unsigned int last = 0;
+
+    while (!(sectors & (1u << first))) {
+        first++;
+    }
+    for (unsigned int s = first; s < lvl->nof_sectors; s++) {
+        if (sectors & (1u << s)) {
+            last = s;
+        }
+    }
+
+    *nof_blocks = (last - first + 1) * blocks_per_sector;
+    return key * lvl->blocks_per_line + first * blocks_per_sector;
+}
+
+/**
+ * Read a run of blocks into the level above the given level (an L1 cache for
+ * level 0) by walking the hierarchy down until some level, or DRAM, has it.
+ *
+ * Levels that miss install the line on the way back up, except exclusive
+ * levels, which only receive victims. An exclusive level that hits gives its
+ * copy up to the requester, along with its dirty bit. A sectored level only
+ * fetches the sectors the run touches, both when it misses and when it holds
+ * the line but not all of those sectors (a sector miss).
+ *
+ * @param sys The memory system to use for the access.
+ * @param level The index of the level to read from. sys->nof_levels means
+ *              DRAM.
+ * @param line_addr The (physical) address of the first block to read (in
+ *                  units of the L1 cache line size).
+ * @param nof_blocks The number of blocks the requester needs, within one of
+ *                   its lines.
+ * @param core_id The CPU core ID that requested this access.
+ * @param is_dirty Set to true if the line comes up dirty. NULL if the
+ *                 requester does not keep the line, in which case exclusive
+ *                 levels keep their copy.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t memsys_level_read(MemorySystem *sys, unsigned int level,
+                           uint64_t line_addr, uint64_t nof_blocks,
+                           unsigned int core_id, bool *is_dirty)
+{
+    if (level == sys->nof_levels) {
+        sys->stat_dram_read_bytes += nof_blocks * CACHE_LINESIZE;
+        return memsys_dram_access(sys, line_addr, false);
+    }
+
+    CacheLevel *lvl = &sys->levels[level];
+    Cache *c = memsys_level_cache(lvl, core_id);
+    uint64_t key = line_addr / lvl->blocks_per_line;
+    uint32_t sectors = memsys_level_sectors(lvl, line_addr, nof_blocks);
+    uint64_t delay = memsys_level_latency(sys, lvl, key, core_id);
+    uint64_t fill_blocks;
+    uint64_t fill_addr;
+    bool was_dirty = false;
+
+    lvl->stat_read_bytes += nof_blocks * CACHE_LINESIZE;
+
+    #ifdef DEBUG
+        printf("\tAccessing %s cache!\n", lvl->name);
+    #endif
+
+    if (cache_access(c, key, false, core_id) == HIT) {
+        CacheLine *line = cache_find_line(c, key);
+        uint32_t missing = sectors & ~line->sector_valid;
+
+        if (missing) {
+            #ifdef DEBUG
+                printf("\tSector miss in %s cache (sectors: 0x%x)\n", lvl->name, missing);
+            #endif
+            lvl->stat_sector_misses++;
+            fill_addr = memsys_level_span(lvl, key, missing, &fill_blocks);
+            delay += memsys_level_read(sys, level + 1, fill_addr, fill_blocks,
+                                       core_id, &was_dirty);
+            line = cache_find_line(c, key);
+            if (line) {
+                line->sector_valid |= missing;
+                if (was_dirty) {
+                    line->dirty = true;
+                    line->sector_dirty |= missing;
+                }
+            }
+        }
+
+        if (lvl->inclusion == EXCLUSIVE && is_dirty) {
+            // The line moves up; this level keeps no copy of it.
+            *is_dirty = cache_invalidate(c, key);
+            lvl->stat_excl_moves++;
+        }
+        return memsys_record_latency(lvl->hist_read, delay);
+    }
+
+    // A sectored level only fetches the sectors asked for.
+    uint32_t fill = (lvl->nof_sectors > 1) ? sectors : 1;
+    fill_addr = memsys_level_span(lvl, key, fill, &fill_blocks);
+    delay += memsys_level_read(sys, level + 1, fill_addr, fill_blocks,
+                               core_id, &was_dirty);
+
+    if (lvl->inclusion == EXCLUSIVE && is_dirty) {
+        // An exclusive level is only filled by victims from above.
+        *is_dirty = was_dirty;
+        return memsys_record_latency(lvl->hist_read, delay);
+    }
+
+    #ifdef DEBUG
+        printf("\tInstalling line in %s cache!\n", lvl->name);
+    #endif
+
+    cache_install(c, key, was_dirty, core_id);
+    CacheLine *line = cache_find_line(c, key);
+    line->sector_valid = fill;
+    line->sector_dirty = was_dirty ? fill : 0;
+
+    delay += memsys_level_victim(sys, level, core_id);
+    return memsys_record_latency(lvl->hist_read, delay);
+}
+
+/**
+ * Pass a run of blocks evicted from the level above the given level (an L1
+ * cache or victim cache for level 0) down to the given level.
+ *
+ * An exclusive level installs every victim, clean or dirty, unless it already
+ * holds the line. Other levels only see dirty victims: an inclusive level is
+ * guaranteed to hold the line and just marks it dirty, and a non-inclusive
+ * level passes the writeback on to the next level without allocating it. DRAM
+ * only receives dirty lines. In a sectored level, only the sectors the run
+ * touches are marked dirty.
+ *
+ * @param sys The memory system to use for the access.
+ * @param level The index of the level receiving the line. sys->nof_levels
+ *              means DRAM.
+ * @param line_addr The (physical) address of the first evicted block (in
+ *                  units of the L1 cache line size).
+ * @param nof_blocks The number of evicted blocks, within one line of the
+ *                   level above.
+ * @param is_dirty Whether the evicted line was dirty.
+ * @param core_id The CPU core ID that evicted the line.
+ * @return The delay in cycles incurred by passing the line on.
+ */
+uint64_t memsys_level_evict(MemorySystem *sys, unsigned int level,
+                            uint64_t line_addr, uint64_t nof_blocks,
+                            bool is_dirty, unsigned int core_id)
+{
+    if (level == 0 && is_dirty) {
+        sys->stat_l1_writes_out_coreid[core_id]++;
+    }
+
+    if (level == sys->nof_levels) {
+        if (!is_dirty) {
+            return 0;
+        }
+        sys->stat_dram_write_bytes += nof_blocks * CACHE_LINESIZE;
+        return memsys_dram_access(sys, line_addr, true);
+    }
+
+    CacheLevel *lvl = &sys->levels[level];
+    Cache *c = memsys_level_cache(lvl, core_id);
+    uint64_t key = line_addr / lvl->blocks_per_line;
+    uint32_t sectors = memsys_level_sectors(lvl, line_addr, nof_blocks);
+
+    if (lvl->inclusion == EXCLUSIVE) {
+        // The level can already hold the line, e.g., when the icache and the
+        // dcache both held it, or a no-write-allocate store wrote it here.
+        // It then keeps its one copy, refreshed and dirtied by the victim.
+        CacheLine *line = cache_find_line(c, key);
+        if (line) {
+            line->LAT = current_cycle;
+            if (is_dirty) {
+                line->dirty = true;
+                lvl->stat_write_bytes += nof_blocks * CACHE_LINESIZE;
+            }
+            return memsys_level_latency(sys, lvl, key, core_id);
+        }
+
+        lvl->stat_excl_fills++;
+        lvl->stat_write_bytes += nof_blocks * CACHE_LINESIZE;
+        cache_install(c, key, false, core_id);
+        if (is_dirty) {
+            cache_set_dirty(c, key);
+        }
+        return memsys_level_latency(sys, lvl, key, core_id) +
+               memsys_level_victim(sys, level, core_id);
+    }
+
+    if (!is_dirty) {
+        return 0;
+    }
+
+    uint64_t delay = memsys_level_latency(sys, lvl, key, core_id);
+    CacheLine *line = cache_find_line(c, key);
+    lvl->stat_writes_in++;
+    lvl->stat_write_bytes += nof_blocks * CACHE_LINESIZE;
+
+    if (line) {
+        // The written sectors are now present, whether or not they stop here.
+        line->sector_valid |= sectors;
+        if (lvl->write_back) {
+            line->dirty = true;
+            line->sector_dirty |= sectors;
+            lvl->stat_writes_absorbed++;
+            return delay;
+        }
+    } else if (lvl->write_allocate) {
+        #ifdef DEBUG
+            printf("\tAllocating written line in %s cache!\n", lvl->name);
+        #endif
+        cache_install(c, key, lvl->write_back, core_id);
+        line = cache_find_line(c, key);
+        line->sector_valid = sectors;
+        line->sector_dirty = lvl->write_back ? sectors : 0;
+        delay += memsys_level_victim(sys, level, core_id);
+        if (lvl->write_back) {
+            lvl->stat_writes_absorbed++;
+            return delay;
+        }
+    }
+
+    return delay + memsys_level_evict(sys, level + 1, line_addr, nof_blocks,
+                                      is_dirty, core_id);
+}
+
+/**
+ * Pass on the line the given level's cache evicted in its last install, if
+ * any, back-invalidating it from the levels above first if the level is
+ * inclusive. A dirty victim of a sectored level only writes back the run
+ * from its first dirty sector to its last.
+ *
+ * @param sys The memory system being used.
+ * @param level The index of the level that just installed a line.
+ * @param core_id The CPU core ID that caused the install.
+ * @return The delay in cycles incurred by writing back or passing on the
+ *         victim.
+ */
+uint64_t memsys_level_victim(MemorySystem *sys, unsigned int level,
+                             unsigned int core_id)
+{
+    CacheLevel *lvl = &sys->levels[level];
+    Cache *c = memsys_level_cache(lvl, core_id);
+
+    if (!c->LEL.valid) {
+        return 0;
+    }
+
+    uint64_t key = c->LEL_line_addr;
+    uint64_t victim_addr = key * lvl->blocks_per_line;
+    bool is_dirty = c->LEL.dirty;
+    uint32_t sectors = (lvl->nof_sectors > 1 && is_dirty)
+                       ? c->LEL.sector_dirty : 0;
+
+    // An inclusive level must not evict a line the levels above still hold.
+    // A dirty copy above is newer than this level's, so it is written back
+    // in place of (or in addition to) this level's victim.
+    if (lvl->inclusion == INCLUSIVE &&
+        memsys_back_invalidate(sys, level, victim_addr, lvl->blocks_per_line,
+                               core_id)) {
+        is_dirty = true;
+        sectors = 0;
+    }
+
+    if (!sectors) {
+        sectors = (lvl->nof_sectors == 32) ? ~0u
+                                           : (1u << lvl->nof_sectors) - 1;
+    }
+
+    uint64_t nof_blocks;
+    victim_addr = memsys_level_span(lvl, key, sectors, &nof_blocks);
+
+    #ifdef DEBUG
+        if (is_dirty) {
+            printf("\tEvicted %s entry was dirty! Performing writeback (addr: %ld, blocks: %ld)\n", lvl->name, victim_addr, nof_blocks);
+        }
+    #endif
+
+    return memsys_level_evict(sys, level + 1, victim_addr, nof_blocks,
+                              is_dirty, core_id);
+}
+
+/**
+ * Collect the L1 caches (and, if with_vcs is set, their victim caches) of the
+ * given core.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID.
+ * @param with_vcs Whether to include the victim caches.
+ * @param caches The array to append the caches to.
+ * @return The number of caches appended.
+ */
+unsigned int memsys_l1_caches(MemorySystem *sys, unsigned int core_id,
+                              bool with_vcs, Cache **caches)
+{
+    Cache *all[4];
+    unsigned int nof_caches = 0;
+
+    if (SIM_MODE == SIM_MODE_DEF)
+    {
+        all[0] = sys->icache_coreid[core_id];
+        all[1] = sys->dcache_coreid[core_id];
+        all[2] = sys->icache_vc_coreid[core_id];
+        all[3] = sys->dcache_vc_coreid[core_id];
+    }
+    else
+    {
+        all[0] = sys->icache;
+        all[1] = sys->dcache;
+        all[2] = sys->icache_vc;
+        all[3] = sys->dcache_vc;
+    }
+
+    for (unsigned int i = 0; i < (with_vcs ? 4u : 2u); i++)
+    {
+        if (all[i])
+        {
+            caches[nof_caches++] = all[i];
+        }
+    }
+
+    return nof_caches;
+}
+
+/**
+ * Remove the given line from every cache above the given level that it
+ * covers (for a private level, only the caches of that core), because the
+ * level is inclusive and evicted the line.
+ *
+ * @param sys The memory system being used.
+ * @param level The index of the inclusive level that evicted the line.
+ * @param line_addr The (physical) address of the first block of the evicted
+ *                  line (in units of the L1 cache line size).
+ * @param nof_blocks The number of blocks in the evicted line.
+ * @param core_id The CPU core ID that caused the eviction.
+ * @return Whether any of the removed copies was dirty.
+ */
+bool memsys_back_invalidate(MemorySystem *sys, unsigned int level,
+                            uint64_t line_addr, uint64_t nof_blocks,
+                            unsigned int core_id)
+{
+    CacheLevel *lvl = &sys->levels[level];
+    Cache *above[4 * 2 + MAX_CACHE_LEVELS * 2];
+    uint64_t above_blocks_per_line[4 * 2 + MAX_CACHE_LEVELS * 2];
+    unsigned int nof_above = 0;
+    bool any_dirty = false;
+
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        if (lvl->is_private && i != core_id)
+        {
+            continue;
+        }
+
+        unsigned int nof_l1 = memsys_l1_caches(sys, i, true,
+                                               &above[nof_above]);
+        for (unsigned int c = 0; c < nof_l1; c++)
+        {
+            above_blocks_per_line[nof_above++] = 1;
+        }
+        for (unsigned int j = 0; j < level; j++)
+        {
+            // A shared level above is only added once.
+            if (sys->levels[j].is_private || i == 0 || lvl->is_private)
+            {
+                above_blocks_per_line[nof_above] =
+                    sys->levels[j].blocks_per_line;
+                above[nof_above++] = memsys_level_cache(&sys->levels[j], i);
+            }
+        }
+    }
+
+    for (unsigned int c = 0; c < nof_above; c++)
+    {
+        // Lines above are never larger than this level's, so each covers
+        // part of the evicted line.
+        for (uint64_t b = line_addr; b < line_addr + nof_blocks;
+             b += above_blocks_per_line[c])
+        {
+            uint64_t key = b / above_blocks_per_line[c];
+            if (!cache_probe(above[c], key))
+            {
+                continue;
+            }
+
+            lvl->stat_incl_victims++;
+            if (cache_invalidate(above[c], key))
+            {
+                lvl->stat_incl_dirty_victims++;
+                any_dirty = true;
+            }
+        }
+    }
+
+    return any_dirty;
+}
+
+/**
+ * In mode D, E, or F, access the given virtual address from an instruction
+ * fetch or load/store.
+ * 
+ * Note that you will need to access the per-core icache and dcache. Also note
+ * that all caches are physically indexed and physically tagged.
+ * 
+ * Return the delay in cycles incurred by this memory access. It is intended
+ * that the calling function will be responsible for updating the statistics
+ * accordingly.
+ * 
+ * This is intended to be implemented in part D.
+ * 
+ * @param sys The memory system to use for the access.
+ * @param v_line_addr The virtual address of the cache line to access (in units
+ *                    of the cache line size, i.e., excluding the line offset
+ *                    bits).
+ * @param type The type of memory access.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred by this memory access.
+ */
+uint64_t memsys_access_modeDEF(MemorySystem *sys, uint64_t v_line_addr,
+                               AccessType type, unsigned int core_id)
+{
+    uint64_t delay = 0;
+    uint64_t p_line_addr = 0;
+    bool is_write = false;
+    CacheResult outcome;
+
+    #ifdef DEBUG
+        printf("\nAccessing memory in mode DEF (line_addr: %ld, AccessType: %d, core_id: %d)\n", v_line_addr, type, core_id);
+    #endif
+
+    // memsys_convert_vpn_to_pfn() operates at page granularity, so split the
+    // line address into a page number and the line offset within the page.
+    uint64_t lines_per_page = PAGE_SIZE / CACHE_LINESIZE;
+    uint64_t vpn = v_line_addr / lines_per_page;
+    uint64_t pfn = memsys_convert_vpn_to_pfn(sys, vpn, core_id);
+    p_line_addr = (pfn * lines_per_page) + (v_line_addr % lines_per_page);
+
+    Cache *dcache = sys->dcache_coreid[core_id];
+    Cache *icache = sys->icache_coreid[core_id];
+
+    if (sys->l2tlb)
+    {
+        delay += memsys_tlb_access(sys, v_line_addr, type, core_id);
+    }
+
+    if (type == ACCESS_TYPE_STORE)
+    {
+        is_write = true;
+    }
+
+    if (type == ACCESS_TYPE_IFETCH) {
+        delay += ICACHE_HIT_LATENCY;
+        outcome = cache_access(icache, p_line_addr, is_write, core_id);
+
+        if (outcome == MISS) {
+            delay += memsys_l1_fill(sys, icache,
+                                    sys->icache_vc_coreid[core_id],
+                                    p_line_addr, is_write, core_id);
+        }
+    } else if (COHERENCE) {
+        delay += DCACHE_HIT_LATENCY;
+        delay += memsys_coherent_access(sys, dcache, p_line_addr, is_write,
+                                        core_id);
+    } else {
+        delay += DCACHE_HIT_LATENCY;
+        delay += memsys_dcache_access(sys, dcache,
+                                      sys->dcache_vc_coreid[core_id],
+                                      p_line_addr, is_write, core_id);
+    }
+
+    return delay;
+}
+
+/**
+ * In mode D, E, or F with coherence enabled, access the given core's data
+ * cache under the MESI protocol.
+ *
+ * The directory sits at the L2 cache and is modelled as a copy of the L1
+ * tags, so it knows exactly which other data caches hold a line. A store to
+ * a shared line pays a round trip to the directory to invalidate the other
+ * copies (an upgrade). A miss on a line another core holds in E or M is
+ * served by that core (a cache-to-cache transfer) instead of the L2 cache;
+ * a load leaves both copies shared, writing back a modified line, and a
+ * store invalidates the other copy. A store miss on a line others share
+ * invalidates them.
+ *
+ * @param sys The memory system to use for the access.
+ * @param dcache The data cache of the core.
+ * @param line_addr The (physical) address of the cache line to access (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access is a store.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
+ */
+uint64_t memsys_coherent_access(MemorySystem *sys, Cache *dcache,
+                                uint64_t line_addr, bool is_write,
+                                unsigned int core_id)
+{
+    uint64_t delay = 0;
+    CacheLine *line = cache_find_line(dcache, line_addr);
+
+    if (line) {
+        cache_access(dcache, line_addr, is_write, core_id);
+        if (is_write && line->shared) {
+            #ifdef DEBUG
+                printf("\tStore to a shared line! Upgrading to M (addr: %ld)\n", line_addr);
+            #endif
+            sys->stat_coh_upgrades++;
+            delay += COH_DIRECTORY_LATENCY;
+            delay += memsys_coh_invalidate_peers(sys, line_addr, core_id);
+            line->shared = false;
+        }
+        return delay;
+    }
+
+    cache_access(dcache, line_addr, is_write, core_id);
+
+    // The way the line was invalidated in keeps its tag until it is reused.
+    CacheLocStats lineStats = findTagAngIndex(dcache, line_addr);
+    for (uint8_t i = 0; i < dcache->nof_ways; i++) {
+        CacheLine *way =
+            &dcache->sets[cache_set_index(dcache, line_addr, i)].lines[i];
+        if (way->coh_invalidated && way->tag == lineStats.tag) {
+            sys->stat_coh_misses_coreid[core_id]++;
+            break;
+        }
+    }
+
+    // Ask the directory which other cores hold the line.
+    CacheLine *owner = NULL;
+    unsigned int owner_id = 0;
+    bool has_sharers = false;
+    for (unsigned int i = 0; i < NUM_CORES; i++) {
+        CacheLine *peer = (i == core_id) ? NULL
+                          : cache_find_line(sys->dcache_coreid[i], line_addr);
+        if (!peer) {
+            continue;
+        }
+        has_sharers = true;
+        if (peer->dirty || !peer->shared) {
+            owner = peer;
+            owner_id = i;
+        }
+    }
+
+    if (owner) {
+        #ifdef DEBUG
+            printf("\tLine owned by core %d! Forwarding it (addr: %ld)\n", owner_id, line_addr);
+        #endif
+        sys->stat_coh_forwards++;
+        delay += COH_DIRECTORY_LATENCY + COH_FORWARD_LATENCY;
+
+        if (is_write) {
+            // The dirty data (if any) moves over with the ownership.
+            delay += memsys_coh_invalidate_peers(sys, line_addr, core_id);
+        } else {
+            if (owner->dirty) {
+                sys->stat_coh_writebacks++;
+                memsys_level_evict(sys, 0, line_addr, 1, true, owner_id);
+                owner->dirty = false;
+            }
+            owner->shared = true;
+        }
+
+        cache_install(dcache, line_addr, is_write, core_id);
+        if (dcache->LEL.valid) {
+            delay += memsys_level_evict(sys, 0, dcache->LEL_line_addr, 1,
+                                        dcache->LEL.dirty, core_id);
+        }
+    } else {
+        delay += memsys_l1_fill(sys, dcache, NULL, line_addr, is_write,
+                                core_id);
+        if (is_write && has_sharers) {
+            delay += memsys_coh_invalidate_peers(sys, line_addr, core_id);
+        }
+    }
+
+    // A store miss leaves the line in M, since installing it dirtied it.
+    if (!is_write) {
+        cache_find_line(dcache, line_addr)->shared = has_sharers;
+    }
+
+    return delay;
+}
+
+/**
+ * Invalidate the copies of the given line in the data caches of every core
+ * other than the given one, marking them so that a later miss on them counts
+ * as a coherence miss.
+ *
+ * @param sys The memory system being used.
+ * @param line_addr The (physical) address of the cache line (in units of the
+ *                  cache line size).
+ * @param core_id The CPU core ID that is taking ownership of the line.
+ * @return The delay in cycles to invalidate the copies and collect the
+ *         acknowledgements, or 0 if no other core held the line.
+ */
+uint64_t memsys_coh_invalidate_peers(MemorySystem *sys, uint64_t line_addr,
+                                     unsigned int core_id)
+{
+    bool any_invalidated = false;
+
+    for (unsigned int i = 0; i < NUM_CORES; i++) {
+        CacheLine *peer = (i == core_id) ? NULL
+                          : cache_find_line(sys->dcache_coreid[i], line_addr);
+        if (!peer) {
+            continue;
+        }
+
+        peer->valid = false;
+        peer->dirty = false;
+        peer->coh_invalidated = true;
+        sys->stat_coh_invalidations++;
+        any_invalidated = true;
+    }
+
+    return any_invalidated ? COH_INVALIDATE_LATENCY : 0;
+}
+
+/**
+ * Look up the translation of the given virtual address in the TLBs of the
+ * given core, walking the page table on an L2 TLB miss.
+ *
+ * Return the delay in cycles added by address translation: nothing on an L1
+ * TLB hit (it is looked up in parallel with the L1 cache), the L2 TLB hit
+ * latency on an L1 TLB miss, and the page walk on top of it on an L2 TLB
+ * miss.
+ *
+ * @param sys The memory system being used.
+ * @param v_line_addr The virtual address of the cache line being accessed (in
+ *                    units of the cache line size).
+ * @param type The type of memory access.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred by address translation.
+ */
+uint64_t memsys_tlb_access(MemorySystem *sys, uint64_t v_line_addr,
+                           AccessType type, unsigned int core_id)
+{
+    uint64_t delay = 0;
+    uint64_t vpn = v_line_addr / (TLB_PAGE_SIZE / CACHE_LINESIZE);
+
+    // Translations of different processes must not hit each other, so the
+    // address space id goes into the upper (tag) bits of the lookup key.
+    uint64_t key = vpn | ((uint64_t)sys->asid_coreid[core_id] << 48);
+
+    Cache *l1tlb = (type == ACCESS_TYPE_IFETCH) ? sys->itlb_coreid[core_id]
+                                                : sys->dtlb_coreid[core_id];
+
+    if (cache_access(l1tlb, key, false, core_id) == HIT) {
+        return delay;
+    }
+
+    delay += L2TLB_HIT_LATENCY;
+    if (cache_access(sys->l2tlb, key, false, core_id) == MISS) {
+        #ifdef DEBUG
+            printf("\tTLB miss! Walking page table (vpn: %ld, core_id: %d)\n", vpn, core_id);
+        #endif
+        uint64_t walk_delay = memsys_page_walk(sys, vpn, core_id);
+        sys->stat_walk_count++;
+        sys->stat_walk_delay += walk_delay;
+        delay += walk_delay;
+        cache_install(sys->l2tlb, key, false, core_id);
+    }
+    cache_install(l1tlb, key, false, core_id);
+
+    return delay;
+}
+
+/**
+ * Walk the radix page table of the process running on the given core for the
+ * given virtual page. Every level reads one page-table entry through the L2
+ * cache (and DRAM on a miss).
+ *
+ * @param sys The memory system being used.
+ * @param vpn The virtual page number (of TLB_PAGE_SIZE pages) to walk for.
+ * @param core_id The CPU core ID that requested this walk.
+ * @return The delay in cycles incurred by the walk.
+ */
+uint64_t memsys_page_walk(MemorySystem *sys, uint64_t vpn,
+                          unsigned int core_id)
+{
+    uint64_t delay = 0;
+    uint64_t asid = sys->asid_coreid[core_id];
+
+    // 2 MB pages are mapped one level up, so their walk skips the last level.
+    unsigned int levels = (TLB_PAGE_SIZE == PAGE_SIZE) ? PAGE_WALK_LEVELS
+                                                       : PAGE_WALK_LEVELS - 1;
+
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        // Each level is laid out as one flat table indexed by the VPN bits
+        // translated so far, so neighbouring pages share PTE cache lines.
+        uint64_t prefix = vpn >> (PAGE_WALK_BITS_PER_LEVEL *
+                                  (levels - 1 - level));
+        uint64_t pte_addr = PAGE_TABLE_BASE + (asid << 40) +
+                            ((uint64_t)level << 36) + (prefix * PTE_SIZE);
+        delay += memsys_l2_access(sys, pte_addr / CACHE_LINESIZE, false,
+                                  core_id);
+    }
+
+    return delay;
+}
+
+/**
+ * Convert the given virtual page number (VPN) to its corresponding physical
+ * frame number (PFN; also known as physical page number, or PPN).
+ * 
+ * This is implemented for you and shouldn't need to be modified.
+ * 
+ * Note that you will need additional operations to obtain the VPN from the
+ * v_line_addr and to get the physical line_addr using the PFN.
+ * 
+ * @param sys The memory system being used.
+ * @param vpn The virtual page number to convert.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The physical frame number corresponding to the given VPN.
+ */
+uint64_t memsys_convert_vpn_to_pfn(MemorySystem *sys, uint64_t vpn,
+                                   unsigned int core_id)
+{
+    assert(NUM_CORES == 2);
+    uint64_t asid = sys->asid_coreid[core_id];
+
+    if (sys->frames)
+    {
+        return framealloc_translate(sys->frames, asid, vpn, core_id);
+    }
+
+    uint64_t tail = vpn & 0x000fffff;
+    uint64_t head = vpn >> 20;
+    uint64_t pfn = tail + (asid << 21) + (head << 21);
+    return pfn;
+}
+
+/**
+ * Flush the private L1 caches of the given core, writing dirty lines back to
+ * the L2 cache and invalidating every line. Used on context switches in mode
+ * D, E, or F.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID whose L1 caches to flush.
+ */
+void memsys_flush_l1(MemorySystem *sys, unsigned int core_id)
+{
+    Cache *l1caches[2] = {sys->icache_coreid[core_id],
+                          sys->dcache_coreid[core_id]};
+
+    for (unsigned int c = 0; c < 2; c++)
+    {
+        Cache *l1 = l1caches[c];
+        for (uint32_t set = 0; set < l1->nof_sets; set++)
+        {
+            for (uint8_t way = 0; way < l1->nof_ways; way++)
+            {
+                CacheLine *line = &l1->sets[set].lines[way];
+                if (line->valid)
+                {
+                    uint64_t line_addr = cache_line_addr(l1, line, set);
+                    memsys_level_evict(sys, 0, line_addr, 1, line->dirty,
+                                       core_id);
+                }
+                line->valid = false;
+                line->dirty = false;
+            }
+        }
+    }
+}
+
+/**
+ * Print the statistics of the memory system.
+ * 
+ * This is implemented for you. You must not modify its output format.
+ * 
+ * @param dram The memory system to print the statistics of.
+ */
+void memsys_print_stats(MemorySystem *sys)
+{
+    double ifetch_delay_avg = 0;
+    double load_delay_avg = 0;
+    double store_delay_avg = 0;
+
+    if (sys->stat_ifetch_access)
+    {
+        ifetch_delay_avg = (double)(sys->stat_ifetch_delay) / (double)(sys->stat_ifetch_access);
+    }
+
+    if (sys->stat_load_access)
+    {
+        load_delay_avg = (double)(sys->stat_load_delay) / (double)(sys->stat_load_access);
+    }
+
+    if (sys->stat_store_access)
+    {
+        store_delay_avg = (double)(sys->stat_store_delay) / (double)(sys->stat_store_access);
+    }
+
+    printf("\n");
+    printf("MEMSYS_IFETCH_ACCESS   \t\t : %10llu\n", sys->stat_ifetch_access);
+    printf("MEMSYS_LOAD_ACCESS     \t\t : %10llu\n", sys->stat_load_access);
+    printf("MEMSYS_STORE_ACCESS    \t\t : %10llu\n", sys->stat_store_access);
+    printf("MEMSYS_IFETCH_AVGDELAY \t\t : %10.3f\n", ifetch_delay_avg);
+    printf("MEMSYS_LOAD_AVGDELAY   \t\t : %10.3f\n", load_delay_avg);
+    printf("MEMSYS_STORE_AVGDELAY  \t\t : %10.3f\n", store_delay_avg);
+
+    if (SIM_MODE == SIM_MODE_A)
+    {
+        cache_print_stats(sys->dcache, "DCACHE");
+    }
+
+    if ((SIM_MODE == SIM_MODE_B) || (SIM_MODE == SIM_MODE_C))
+    {
+        cache_print_stats(sys->icache, "ICACHE");
+        cache_print_stats(sys->dcache, "DCACHE");
+        memsys_print_level_stats(sys);
+        dram_print_stats(sys->dram);
+
+        if (sys->dcache_vc)
+        {
+            memsys_print_victim_stats(sys->icache_vc, sys->icache,
+                                      "ICACHE_VC");
+            memsys_print_victim_stats(sys->dcache_vc, sys->dcache,
+                                      "DCACHE_VC");
+        }
+
+        memsys_print_bank_stats(sys);
+        if (DCACHE_WRITE_THROUGH || !DCACHE_WRITE_ALLOCATE || WC_ENTRIES ||
+            L2_WRITE_BACK >= 0 || L2_WRITE_ALLOC >= 0)
+        {
+            memsys_print_write_stats(sys);
+        }
+        memsys_print_traffic_stats(sys);
+        memsys_print_inclusion_stats(sys);
+    }
+
+    if (SIM_MODE == SIM_MODE_DEF)
+    {
+        assert(NUM_CORES == 2);
+        cache_print_stats(sys->icache_coreid[0], "ICACHE_0");
+        cache_print_stats(sys->dcache_coreid[0], "DCACHE_0");
+        cache_print_stats(sys->icache_coreid[1], "ICACHE_1");
+        cache_print_stats(sys->dcache_coreid[1], "DCACHE_1");
+        memsys_print_level_stats(sys);
+        dram_print_stats(sys->dram);
+
+        if (sys->l2tlb)
+        {
+            memsys_print_tlb_stats(sys);
+        }
+
+        if (sys->dcache_vc_coreid[0])
+        {
+            char label[16];
+            for (unsigned int i = 0; i < NUM_CORES; i++)
+            {
+                snprintf(label, sizeof(label), "ICACHE_%d_VC", i);
+                memsys_print_victim_stats(sys->icache_vc_coreid[i],
+                                          sys->icache_coreid[i], label);
+                snprintf(label, sizeof(label), "DCACHE_%d_VC", i);
+                memsys_print_victim_stats(sys->dcache_vc_coreid[i],
+                                          sys->dcache_coreid[i], label);
+            }
+        }
+
+        memsys_print_bank_stats(sys);
+        if (DCACHE_WRITE_THROUGH || !DCACHE_WRITE_ALLOCATE || WC_ENTRIES ||
+            L2_WRITE_BACK >= 0 || L2_WRITE_ALLOC >= 0)
+        {
+            memsys_print_write_stats(sys);
+        }
+        memsys_print_traffic_stats(sys);
+        memsys_print_inclusion_stats(sys);
+
+        if (COHERENCE)
+        {
+            memsys_print_coherence_stats(sys);
+        }
+
+        if (sys->frames)
+        {
+            framealloc_print_stats(sys->frames);
+            dram_print_bank_stats(sys->dram);
+        }
+    }
+
+    if (SET_STATS)
+    {
+        memsys_print_set_stats(sys);
+    }
+
+    if (LATENCY_HIST)
+    {
+        memsys_print_latency_stats(sys);
+    }
+
+    if (LIFETIME_STATS)
+    {
+        memsys_print_lifetime_stats(sys);
+    }
+
+    if (HEATMAP_PREFIX && !memsys_write_heatmaps(sys, HEATMAP_PREFIX))
+    {
+        fprintf(stderr, "Warning: could not write the heatmaps to %s_*.csv\n",
+                HEATMAP_PREFIX);
+    }
+
+    if (sys->pcprof)
+    {
+        pcprof_print_stats(sys->pcprof, PCPROF_TOP_N);
+        if (PCPROF_CSV && !pcprof_write_csv(sys->pcprof, PCPROF_CSV))
+        {
+            fprintf(stderr, "Warning: could not write %s\n", PCPROF_CSV);
+        }
+    }
+}
+
+/**
+ * Collect the L1 caches and the caches of every level below them, together
+ * with the labels used in their cache statistics (e.g., DCACHE_0, L2CACHE).
+ *
+ * @param sys The memory system being used.
+ * @param caches The array (of MAX_MEMSYS_CACHES entries) to fill in.
+ * @param labels The array (of MAX_MEMSYS_CACHES entries) to fill in with the
+ *               label of each cache.
+ * @return The number of caches collected.
+ */
+unsigned int memsys_list_caches(MemorySystem *sys, Cache **caches,
+                                char (*labels)[16])
+{
+    unsigned int nof_caches = 0;
+
+    if (SIM_MODE == SIM_MODE_DEF)
+    {
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            snprintf(labels[nof_caches], 16, "ICACHE_%d", i);
+            caches[nof_caches++] = sys->icache_coreid[i];
+            snprintf(labels[nof_caches], 16, "DCACHE_%d", i);
+            caches[nof_caches++] = sys->dcache_coreid[i];
+        }
+    }
+    else
+    {
+        if (sys->icache)
+        {
+            snprintf(labels[nof_caches], 16, "ICACHE");
+            caches[nof_caches++] = sys->icache;
+        }
+        snprintf(labels[nof_caches], 16, "DCACHE");
+        caches[nof_caches++] = sys->dcache;
     }
 
-    if (sys->stat_load_access)
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
     {
-        load_delay_avg = (double)(sys->stat_load_delay) / (double)(sys->stat_load_access);
+        CacheLevel *lvl = &sys->levels[k];
+        for (unsigned int i = 0; i < (lvl->is_private ? NUM_CORES : 1); i++)
+        {
+            if (lvl->is_private)
+            {
+                snprintf(labels[nof_caches], 16, "%sCACHE_%d", lvl->name, i);
+            }
+            else
+            {
+                snprintf(labels[nof_caches], 16, "%sCACHE", lvl->name);
+            }
+            caches[nof_caches++] = lvl->caches[i];
+        }
     }
 
-    if (sys->stat_store_access)
+    return nof_caches;
+}
+
+/**
+ * Print the per-set access and miss distribution of the L1 caches and of
+ * every cache level below them, labelled as in their cache statistics.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_set_stats(MemorySystem *sys)
+{
+    Cache *caches[MAX_MEMSYS_CACHES];
+    char labels[MAX_MEMSYS_CACHES][16];
+    unsigned int nof_caches = memsys_list_caches(sys, caches, labels);
+
+    for (unsigned int c = 0; c < nof_caches; c++)
     {
-        store_delay_avg = (double)(sys->stat_store_delay) / (double)(sys->stat_store_access);
+        cache_print_set_stats(caches[c], labels[c]);
+    }
+}
+
+/**
+ * Write the per-set counters of every cache (see memsys_list_caches()) and
+ * the per-bank counters of DRAM to CSV files for plotting as heatmaps. The
+ * files are named after the given prefix and the label of each cache, e.g.,
+ * prefix_L2CACHE.csv and prefix_DRAM.csv.
+ *
+ * @param sys The memory system to write the counters of.
+ * @param prefix The path prefix of the CSV files.
+ * @return Whether every file was written.
+ */
+bool memsys_write_heatmaps(MemorySystem *sys, const char *prefix)
+{
+    Cache *caches[MAX_MEMSYS_CACHES];
+    char labels[MAX_MEMSYS_CACHES][16];
+    unsigned int nof_caches = memsys_list_caches(sys, caches, labels);
+    char path[4096];
+    bool written = true;
+
+    for (unsigned int c = 0; c < nof_caches; c++)
+    {
+        snprintf(path, sizeof(path), "%s_%s.csv", prefix, labels[c]);
+        written = cache_write_set_heatmap(caches[c], path) && written;
+    }
+
+    if (sys->dram)
+    {
+        snprintf(path, sizeof(path), "%s_DRAM.csv", prefix);
+        written = dram_write_bank_heatmap(sys->dram, path) && written;
+    }
+
+    return written;
+}
+
+/**
+ * Print the lifetime statistics (hits per evicted line, dead time and reuse
+ * distances) of the L1 caches and of every cache level below them.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_lifetime_stats(MemorySystem *sys)
+{
+    Cache *caches[MAX_MEMSYS_CACHES];
+    char labels[MAX_MEMSYS_CACHES][16];
+    unsigned int nof_caches = memsys_list_caches(sys, caches, labels);
+
+    for (unsigned int c = 0; c < nof_caches; c++)
+    {
+        cache_print_lifetime_stats(caches[c], labels[c]);
+    }
+}
+
+/**
+ * Register the statistics of the memory system under the group "memsys":
+ * the accesses and average delay of each access type, every cache (grouped
+ * by its lowercase label, e.g., memsys.l2cache), the traffic and latency of
+ * each cache level (e.g., memsys.l2), DRAM, and the latency histograms if
+ * enabled.
+ *
+ * @param sys The memory system.
+ * @param reg The registry to add the statistics to.
+ */
+void memsys_register_stats(MemorySystem *sys, StatsRegistry *reg)
+{
+    const char *type_names[3] = {"ifetch", "load", "store"};
+    unsigned long long *type_access[3] = {&sys->stat_ifetch_access,
+                                          &sys->stat_load_access,
+                                          &sys->stat_store_access};
+    uint64_t *type_delay[3] = {&sys->stat_ifetch_delay, &sys->stat_load_delay,
+                               &sys->stat_store_delay};
+    Cache *caches[MAX_MEMSYS_CACHES];
+    char labels[MAX_MEMSYS_CACHES][16];
+    unsigned int nof_caches = memsys_list_caches(sys, caches, labels);
+    char group[64];
+    char name[32];
+
+    for (unsigned int t = 0; t < 3; t++)
+    {
+        snprintf(name, sizeof(name), "%s_access", type_names[t]);
+        unsigned int access = stats_add_ull(reg, "memsys", name,
+                                            type_access[t]);
+        snprintf(name, sizeof(name), "%s_delay", type_names[t]);
+        unsigned int delay = stats_add_u64(reg, "memsys", name,
+                                           type_delay[t]);
+        snprintf(name, sizeof(name), "%s_delay_avg", type_names[t]);
+        stats_add_ratio(reg, "memsys", name, delay, access, 1.0);
+
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            if (sys->hist_type_coreid[t][i])
+            {
+                snprintf(name, sizeof(name), "%s_latency_%d", type_names[t],
+                         i);
+                stats_add_hist(reg, "memsys", name,
+                               sys->hist_type_coreid[t][i]);
+            }
+        }
+    }
+
+    for (unsigned int c = 0; c < nof_caches; c++)
+    {
+        snprintf(group, sizeof(group), "memsys.%.15s", labels[c]);
+        for (char *p = group; *p; p++)
+        {
+            *p = tolower(*p);
+        }
+        cache_register_stats(caches[c], reg, group);
+    }
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        CacheLevel *lvl = &sys->levels[k];
+
+        snprintf(group, sizeof(group), "memsys.%s", lvl->name);
+        for (char *p = group; *p; p++)
+        {
+            *p = tolower(*p);
+        }
+        stats_add_ull(reg, group, "read_bytes", &lvl->stat_read_bytes);
+        stats_add_ull(reg, group, "write_bytes", &lvl->stat_write_bytes);
+        stats_add_ull(reg, group, "sector_misses", &lvl->stat_sector_misses);
+        if (lvl->hist_read)
+        {
+            stats_add_hist(reg, group, "read_latency", lvl->hist_read);
+        }
+    }
+
+    if (sys->dram)
+    {
+        dram_register_stats(sys->dram, reg, "memsys.dram");
+        stats_add_ull(reg, "memsys.dram", "read_bytes",
+                      &sys->stat_dram_read_bytes);
+        stats_add_ull(reg, "memsys.dram", "write_bytes",
+                      &sys->stat_dram_write_bytes);
+        if (sys->hist_dram)
+        {
+            stats_add_hist(reg, "memsys.dram", "latency", sys->hist_dram);
+        }
+    }
+}
+
+/**
+ * Record a latency in the given histogram, if there is one.
+ *
+ * @param h The histogram, or NULL if latency histograms are disabled.
+ * @param delay The latency to record, in cycles.
+ * @return The latency, so calls can wrap a return value.
+ */
+uint64_t memsys_record_latency(LatencyHist *h, uint64_t delay)
+{
+    if (h)
+    {
+        latency_hist_record(h, delay);
+    }
+    return delay;
+}
+
+/**
+ * Access DRAM, recording the latency in the DRAM histogram and the host time
+ * in the host profile if they are enabled.
+ *
+ * @param sys The memory system.
+ * @param line_addr The address of the cache line to access.
+ * @param is_write Whether this access writes to DRAM.
+ * @return The delay in cycles incurred by the DRAM access.
+ */
+uint64_t memsys_dram_access(MemorySystem *sys, uint64_t line_addr,
+                            bool is_write)
+{
+    uint64_t host_start =
+        hostprof ? hostprof_begin(hostprof, HOST_STAGE_DRAM) : 0;
+    uint64_t delay = dram_access(sys->dram, line_addr, is_write);
+
+    if (host_start)
+    {
+        hostprof_end(hostprof, HOST_STAGE_DRAM, host_start);
+    }
+    return memsys_record_latency(sys->hist_dram, delay);
+}
+
+/**
+ * Print the latency percentiles of each access type (per core in a multicore
+ * system), of each cache level below the L1 caches, and of DRAM.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_latency_stats(MemorySystem *sys)
+{
+    const char *type_names[3] = {"IFETCH", "LOAD", "STORE"};
+    char label[16];
+
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        for (unsigned int t = 0; t < 3; t++)
+        {
+            if (SIM_MODE == SIM_MODE_DEF)
+            {
+                snprintf(label, sizeof(label), "%s_%d", type_names[t], i);
+            }
+            else
+            {
+                snprintf(label, sizeof(label), "%s", type_names[t]);
+            }
+            latency_hist_print_stats(sys->hist_type_coreid[t][i], label,
+                                     "LAT");
+        }
+    }
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        snprintf(label, sizeof(label), "%sCACHE", sys->levels[k].name);
+        latency_hist_print_stats(sys->levels[k].hist_read, label, "LAT");
+    }
+
+    if (sys->hist_dram)
+    {
+        latency_hist_print_stats(sys->hist_dram, "DRAM", "LAT");
+    }
+}
+
+/**
+ * Print the statistics of a victim cache, including the L2 traffic it saved.
+ *
+ * @param vc The victim cache to print the statistics of.
+ * @param l1 The L1 cache the victim cache belongs to.
+ * @param label A label for the victim cache, which is used as a prefix for
+ *              each statistic.
+ */
+void memsys_print_victim_stats(Cache *vc, Cache *l1, const char *label)
+{
+    // Every victim cache hit replaces an L2 read, and every dirty L1 victim
+    // that never leaves the victim cache dirty replaces an L2 writeback.
+    unsigned long long hits = vc->stat_read_access - vc->stat_read_miss;
+    unsigned long long writebacks_saved = 0;
+    double hit_percent = 0.0;
+
+    if (l1->stat_dirty_evicts > vc->stat_dirty_evicts)
+    {
+        writebacks_saved = l1->stat_dirty_evicts - vc->stat_dirty_evicts;
+    }
+
+    if (vc->stat_read_access)
+    {
+        hit_percent = 100.0 * (double)hits / (double)(vc->stat_read_access);
+    }
+
+    cache_print_stats(vc, label);
+    printf("%s_HIT_PERC        \t\t : %10.3f\n", label, hit_percent);
+    printf("%s_L2_READS_SAVED  \t\t : %10llu\n", label, hits);
+    printf("%s_L2_WBS_SAVED    \t\t : %10llu\n", label, writebacks_saved);
+}
+
+/**
+ * Print the statistics of every cache level below the L1 caches. Each cache
+ * is labelled with its level name, followed by the core ID if the level is
+ * private (e.g., L2CACHE, or L2CACHE_0 and L2CACHE_1).
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_level_stats(MemorySystem *sys)
+{
+    char label[16];
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        CacheLevel *lvl = &sys->levels[k];
+        if (!lvl->is_private)
+        {
+            snprintf(label, sizeof(label), "%sCACHE", lvl->name);
+            cache_print_stats(lvl->caches[0], label);
+            continue;
+        }
+
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            snprintf(label, sizeof(label), "%sCACHE_%d", lvl->name, i);
+            cache_print_stats(lvl->caches[i], label);
+        }
+    }
+}
+
+/**
+ * Print the per-bank utilization and queuing statistics of every banked
+ * cache level.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_bank_stats(MemorySystem *sys)
+{
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        CacheLevel *lvl = &sys->levels[k];
+        unsigned long long total_access = 0;
+        uint64_t total_queue_delay = 0;
+
+        if (!lvl->nof_banks)
+        {
+            continue;
+        }
+
+        printf("\n");
+        for (unsigned int b = 0; b < lvl->nof_banks; b++)
+        {
+            double util = 0.0;
+            double avg_queue = 0.0;
+
+            if (current_cycle)
+            {
+                util = 100.0 * (double)(lvl->stat_bank_access[b] *
+                                        BANK_BUSY_CYCLES) /
+                       (double)current_cycle;
+            }
+            if (lvl->stat_bank_access[b])
+            {
+                avg_queue = (double)lvl->stat_bank_queue_delay[b] /
+                            (double)lvl->stat_bank_access[b];
+            }
+
+            printf("%s_BANK_%02d_UTIL_PERC\t\t : %10.3f\n", lvl->name, b,
+                   util);
+            printf("%s_BANK_%02d_QUEUE_AVG\t\t : %10.3f\n", lvl->name, b,
+                   avg_queue);
+
+            total_access += lvl->stat_bank_access[b];
+            total_queue_delay += lvl->stat_bank_queue_delay[b];
+        }
+
+        double avg_queue = 0.0;
+        double avg_nuca = 0.0;
+        if (total_access)
+        {
+            avg_queue = (double)total_queue_delay / (double)total_access;
+            avg_nuca = (double)lvl->stat_nuca_delay / (double)total_access;
+        }
+
+        printf("%s_BANK_QUEUE_AVG    \t\t : %10.3f\n", lvl->name, avg_queue);
+        printf("%s_NUCA_DELAY_AVG    \t\t : %10.3f\n", lvl->name, avg_nuca);
     }
+}
 
+/**
+ * Print the write policy statistics: the writes each L1 data cache sent
+ * down, the write-combining buffers, and the writes each cache level
+ * received and absorbed.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_write_stats(MemorySystem *sys)
+{
     printf("\n");
-    printf("MEMSYS_IFETCH_ACCESS   \t\t : %10llu\n", sys->stat_ifetch_access);
-    printf("MEMSYS_LOAD_ACCESS     \t\t : %10llu\n", sys->stat_load_access);
-    printf("MEMSYS_STORE_ACCESS    \t\t : %10llu\n", sys->stat_store_access);
-    printf("MEMSYS_IFETCH_AVGDELAY \t\t : %10.3f\n", ifetch_delay_avg);
-    printf("MEMSYS_LOAD_AVGDELAY   \t\t : %10.3f\n", load_delay_avg);
-    printf("MEMSYS_STORE_AVGDELAY  \t\t : %10.3f\n", store_delay_avg);
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        WriteCombiningBuffer *wc = sys->wcbuf_coreid[i];
 
-    if (SIM_MODE == SIM_MODE_A)
+        printf("CORE_%01d_L1_WRITES_OUT\t\t : %10llu\n", i,
+               sys->stat_l1_writes_out_coreid[i]);
+        if (wc)
+        {
+            printf("CORE_%01d_WC_WRITES    \t\t : %10llu\n", i,
+                   wc->stat_writes);
+            printf("CORE_%01d_WC_COALESCED \t\t : %10llu\n", i,
+                   wc->stat_coalesced);
+            printf("CORE_%01d_WC_FLUSHES   \t\t : %10llu\n", i,
+                   wc->stat_flushes);
+        }
+    }
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
     {
-        cache_print_stats(sys->dcache, "DCACHE");
+        CacheLevel *lvl = &sys->levels[k];
+        printf("%s_WRITES_IN         \t\t : %10llu\n", lvl->name,
+               lvl->stat_writes_in);
+        printf("%s_WRITES_ABSORBED   \t\t : %10llu\n", lvl->name,
+               lvl->stat_writes_absorbed);
     }
+}
 
-    if ((SIM_MODE == SIM_MODE_B) || (SIM_MODE == SIM_MODE_C))
+/**
+ * Print the line size, sector misses, and data traffic of each cache level,
+ * and the traffic to and from DRAM, if any level has lines larger than the
+ * L1 caches or is sectored. The read traffic of a level is the data it sent
+ * up, and the write traffic the data written into it from above.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_traffic_stats(MemorySystem *sys)
+{
+    bool resized = false;
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
     {
-        cache_print_stats(sys->icache, "ICACHE");
-        cache_print_stats(sys->dcache, "DCACHE");
-        cache_print_stats(sys->l2cache, "L2CACHE");
-        dram_print_stats(sys->dram);
+        resized |= sys->levels[k].blocks_per_line > 1 ||
+                   sys->levels[k].nof_sectors > 1;
     }
 
-    if (SIM_MODE == SIM_MODE_DEF)
+    if (!resized)
     {
-        assert(NUM_CORES == 2);
-        cache_print_stats(sys->icache_coreid[0], "ICACHE_0");
-        cache_print_stats(sys->dcache_coreid[0], "DCACHE_0");
-        cache_print_stats(sys->icache_coreid[1], "ICACHE_1");
-        cache_print_stats(sys->dcache_coreid[1], "DCACHE_1");
-        cache_print_stats(sys->l2cache, "L2CACHE");
-        dram_print_stats(sys->dram);
+        return;
+    }
+
+    printf("\n");
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        CacheLevel *lvl = &sys->levels[k];
+        printf("%s_LINE_SIZE         \t\t : %10llu\n", lvl->name,
+               (unsigned long long)(lvl->blocks_per_line * CACHE_LINESIZE));
+        printf("%s_SECTORS           \t\t : %10u\n", lvl->name, lvl->nof_sectors);
+        printf("%s_SECTOR_MISSES     \t\t : %10llu\n", lvl->name,
+               lvl->stat_sector_misses);
+        printf("%s_READ_KB           \t\t : %10llu\n", lvl->name,
+               lvl->stat_read_bytes / 1024);
+        printf("%s_WRITE_KB          \t\t : %10llu\n", lvl->name,
+               lvl->stat_write_bytes / 1024);
+    }
+    printf("DRAM_READ_KB         \t\t : %10llu\n",
+           sys->stat_dram_read_bytes / 1024);
+    printf("DRAM_WRITE_KB        \t\t : %10llu\n",
+           sys->stat_dram_write_bytes / 1024);
+}
+
+/**
+ * Print the inclusion policy statistics of each cache level that is not
+ * non-inclusive. The effective capacity of a level is the number of distinct
+ * lines held in the L1 caches and the levels down to it together at the end
+ * of the simulation.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_inclusion_stats(MemorySystem *sys)
+{
+    Cache *caches[4 * 2 + MAX_CACHE_LEVELS * 2];
+    CacheLevel *levels[4 * 2 + MAX_CACHE_LEVELS * 2];
+    unsigned int nof_caches = 0;
+    unsigned long long nominal_kb = 0;
+
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        unsigned int nof_l1 = memsys_l1_caches(sys, i, false,
+                                               &caches[nof_caches]);
+        for (unsigned int c = 0; c < nof_l1; c++)
+        {
+            levels[nof_caches++] = NULL;
+        }
+    }
+
+    for (unsigned int k = 0; k < sys->nof_levels; k++)
+    {
+        CacheLevel *lvl = &sys->levels[k];
+        unsigned int nof_lvl_caches = lvl->is_private ? NUM_CORES : 1;
+
+        nominal_kb = 0;
+        for (unsigned int i = 0; i < nof_lvl_caches; i++)
+        {
+            Cache *c = lvl->caches[i];
+            levels[nof_caches] = lvl;
+            caches[nof_caches++] = c;
+            nominal_kb += (unsigned long long)c->nof_sets * c->nof_ways *
+                          lvl->blocks_per_line * CACHE_LINESIZE / 1024;
+        }
+
+        if (lvl->inclusion == NON_INCLUSIVE)
+        {
+            continue;
+        }
+
+        unsigned long long unique_kb =
+            memsys_count_unique_lines(caches, levels, nof_caches) *
+            CACHE_LINESIZE / 1024;
+
+        printf("\n");
+        printf("%s_INCLUSION_POLICY  \t\t : %10d\n", lvl->name,
+               lvl->inclusion);
+        printf("%s_INCL_VICTIMS      \t\t : %10llu\n", lvl->name,
+               lvl->stat_incl_victims);
+        printf("%s_INCL_DIRTY_VICTIMS\t\t : %10llu\n", lvl->name,
+               lvl->stat_incl_dirty_victims);
+        printf("%s_EXCL_MOVES        \t\t : %10llu\n", lvl->name,
+               lvl->stat_excl_moves);
+        printf("%s_EXCL_FILLS        \t\t : %10llu\n", lvl->name,
+               lvl->stat_excl_fills);
+        printf("%s_EFFECTIVE_CAP_KB  \t\t : %10llu\n", lvl->name, unique_kb);
+        printf("%s_NOMINAL_CAP_KB    \t\t : %10llu\n", lvl->name,
+               nominal_kb);
+    }
+}
+
+/**
+ * Count the distinct valid blocks (L1-sized units) held across the given
+ * caches.
+ *
+ * @param caches The caches to count the blocks of.
+ * @param levels The cache level of each cache, or NULL for an L1 or victim
+ *               cache. Gives the line size and sectors of the cache.
+ * @param nof_caches The number of caches.
+ * @return The number of distinct valid blocks.
+ */
+unsigned long long memsys_count_unique_lines(Cache **caches,
+                                             CacheLevel **levels,
+                                             unsigned int nof_caches)
+{
+    unsigned long long nof_lines = 0;
+
+    for (unsigned int c = 0; c < nof_caches; c++)
+    {
+        uint64_t blocks_per_line = levels[c] ? levels[c]->blocks_per_line : 1;
+
+        for (uint32_t set = 0; set < caches[c]->nof_sets; set++)
+        {
+            for (uint8_t way = 0; way < caches[c]->nof_ways; way++)
+            {
+                CacheLine *line = &caches[c]->sets[set].lines[way];
+                if (!line->valid)
+                {
+                    continue;
+                }
+
+                uint64_t key = cache_line_addr(caches[c], line, set);
+                for (uint64_t b = key * blocks_per_line;
+                     b < (key + 1) * blocks_per_line; b++)
+                {
+                    if (!memsys_holds_block(caches[c], levels[c], b))
+                    {
+                        continue;
+                    }
+
+                    // Count each block in the last cache that holds it.
+                    bool held_below = false;
+                    for (unsigned int d = c + 1;
+                         d < nof_caches && !held_below; d++)
+                    {
+                        held_below = memsys_holds_block(caches[d], levels[d],
+                                                        b);
+                    }
+
+                    if (!held_below)
+                    {
+                        nof_lines++;
+                    }
+                }
+            }
+        }
+    }
+
+    return nof_lines;
+}
+
+/**
+ * Check whether the given cache holds the given block, i.e., has its line
+ * with the block's sector valid.
+ *
+ * @param c The cache to check.
+ * @param lvl The cache level of the cache, or NULL for an L1 or victim cache.
+ * @param block The (physical) address of the block (in units of the L1 cache
+ *              line size).
+ * @return Whether the cache holds the block.
+ */
+bool memsys_holds_block(Cache *c, CacheLevel *lvl, uint64_t block)
+{
+    if (!lvl)
+    {
+        return cache_probe(c, block);
+    }
+
+    CacheLine *line = cache_find_line(c, block / lvl->blocks_per_line);
+    uint64_t blocks_per_sector = lvl->blocks_per_line / lvl->nof_sectors;
+
+    return line && ((line->sector_valid >>
+                     (block % lvl->blocks_per_line / blocks_per_sector)) & 1);
+}
+
+/**
+ * Print the coherence statistics of the memory system in mode D, E, or F.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_coherence_stats(MemorySystem *sys)
+{
+    // Control messages: a request and an ack per upgrade and invalidation.
+    // Data messages: a line per cache-to-cache transfer and writeback.
+    unsigned long long ctrl_msgs = 2 * (sys->stat_coh_upgrades +
+                                        sys->stat_coh_invalidations);
+    unsigned long long data_msgs = sys->stat_coh_forwards +
+                                   sys->stat_coh_writebacks;
+
+    printf("\n");
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        printf("CORE_%01d_COH_MISSES   \t\t : %10llu\n", i,
+               sys->stat_coh_misses_coreid[i]);
+    }
+    printf("COH_UPGRADES         \t\t : %10llu\n", sys->stat_coh_upgrades);
+    printf("COH_INVALIDATIONS    \t\t : %10llu\n",
+           sys->stat_coh_invalidations);
+    printf("COH_FORWARDS         \t\t : %10llu\n", sys->stat_coh_forwards);
+    printf("COH_WRITEBACKS       \t\t : %10llu\n", sys->stat_coh_writebacks);
+    printf("COH_CTRL_MSGS        \t\t : %10llu\n", ctrl_msgs);
+    printf("COH_DATA_MSGS        \t\t : %10llu\n", data_msgs);
+}
+
+/**
+ * Print the TLB statistics of the memory system in mode D, E, or F. MPKI is
+ * computed per thousand instructions of the core (all cores for the L2 TLB).
+ *
+ * @param sys The memory system to print the TLB statistics of.
+ */
+void memsys_print_tlb_stats(MemorySystem *sys)
+{
+    double kilo_inst = (double)(sys->stat_ifetch_access) / 1000.0;
+    double walk_delay_avg = 0.0;
+    char label[16];
+
+    if (sys->stat_walk_count)
+    {
+        walk_delay_avg = (double)(sys->stat_walk_delay) /
+                         (double)(sys->stat_walk_count);
+    }
+
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        snprintf(label, sizeof(label), "ITLB_%d", i);
+        cache_print_stats(sys->itlb_coreid[i], label);
+        snprintf(label, sizeof(label), "DTLB_%d", i);
+        cache_print_stats(sys->dtlb_coreid[i], label);
+    }
+    cache_print_stats(sys->l2tlb, "L2TLB");
+
+    printf("\n");
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        // Every instruction of a core looks up its ITLB exactly once.
+        double core_kilo_inst =
+            (double)(sys->itlb_coreid[i]->stat_read_access) / 1000.0;
+        double itlb_mpki = 0.0;
+        double dtlb_mpki = 0.0;
+        if (core_kilo_inst > 0.0)
+        {
+            itlb_mpki = (double)(sys->itlb_coreid[i]->stat_read_miss) /
+                        core_kilo_inst;
+            dtlb_mpki = (double)(sys->dtlb_coreid[i]->stat_read_miss) /
+                        core_kilo_inst;
+        }
+        printf("ITLB_%d_MPKI          \t\t : %10.3f\n", i, itlb_mpki);
+        printf("DTLB_%d_MPKI          \t\t : %10.3f\n", i, dtlb_mpki);
     }
+    printf("L2TLB_MPKI           \t\t : %10.3f\n",
+           kilo_inst > 0.0 ? (double)(sys->l2tlb->stat_read_miss) / kilo_inst
+                           : 0.0);
+    printf("TLB_WALK_COUNT       \t\t : %10llu\n", sys->stat_walk_count);
+    printf("TLB_WALK_CYCLES      \t\t : %10llu\n",
+           (unsigned long long)sys->stat_walk_delay);
+    printf("TLB_WALK_DELAY_AVG   \t\t : %10.3f\n", walk_delay_avg);
 }
@@ -11,11 +11,137 @@
 #include "types.h"
 #include "cache.h"
 #include "dram.h"
+#include "framealloc.h"
+#include "pcprof.h"
+#include "latency.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 //                              DATA STRUCTURES                              //
 ///////////////////////////////////////////////////////////////////////////////
 
+/** The maximum number of cache levels below the L1 caches. */
+#define MAX_CACHE_LEVELS 4
+
+/**
+ * The maximum number of caches in the memory system, not counting victim
+ * caches: two L1 caches per core and every level below them.
+ */
+#define MAX_MEMSYS_CACHES (4 * 2 + MAX_CACHE_LEVELS * 2)
+
+/** The maximum number of banks in a shared cache level. */
+#define MAX_CACHE_BANKS 64
+
+/** The maximum number of lines in a write-combining buffer. */
+#define MAX_WC_ENTRIES 16
+
+/** How the contents of a cache level relate to the levels above it. */
+typedef enum InclusionPolicyEnum
+{
+    // No guarantees: fills also fill this level and evictions are independent.
+    NON_INCLUSIVE = 0,
+    // Every line above is also here; evictions back-invalidate the levels above.
+    INCLUSIVE = 1,
+    // No line is in both: hits move the line up, victims from above fill it.
+    EXCLUSIVE = 2,
+} InclusionPolicy;
+
+/**
+ * A write-combining buffer, which collects the writes an L1 data cache sends
+ * down so that several writes to the same line leave as one.
+ */
+typedef struct WriteCombiningBuffer
+{
+    /** The addresses of the buffered lines, oldest first. */
+    uint64_t line_addrs[MAX_WC_ENTRIES];
+    /** The number of buffered lines. */
+    unsigned int count;
+
+    /** The total number of writes sent to the buffer. */
+    unsigned long long stat_writes;
+    /** The total number of writes merged into an already buffered line. */
+    unsigned long long stat_coalesced;
+    /** The total number of lines flushed to the next level. */
+    unsigned long long stat_flushes;
+} WriteCombiningBuffer;
+
+/** A level of the cache hierarchy below the L1 caches. */
+typedef struct CacheLevel
+{
+    /** The name of the level (e.g., "L2"), used to label its statistics. */
+    char name[8];
+    /** Whether each core has its own cache at this level. */
+    bool is_private;
+    /** The caches of this level, by core ID. Only [0] is used if shared. */
+    Cache *caches[2];
+    /** The hit latency of this level in cycles. */
+    uint64_t hit_latency;
+    /** The inclusion policy of this level with respect to the levels above. */
+    InclusionPolicy inclusion;
+    /**
+     * Whether writes from above that hit only dirty the line (write-back)
+     * rather than also going on to the next level (write-through).
+     */
+    bool write_back;
+    /** Whether writes from above that miss allocate the line. */
+    bool write_allocate;
+    /** The total number of writes received from the level above. */
+    unsigned long long stat_writes_in;
+    /** The total number of received writes that went no further. */
+    unsigned long long stat_writes_absorbed;
+
+    /**
+     * The number of address-interleaved banks of a shared level, each of
+     * which serves one access at a time. 0 if bank conflicts are not modeled.
+     */
+    unsigned int nof_banks;
+    /** The cycle at which each bank finishes its last queued access. */
+    uint64_t bank_busy_until[MAX_CACHE_BANKS];
+    /**
+     * The request that last used each bank. A request does not queue behind
+     * its own use of a bank, e.g., its L1 victim writeback behind its fill.
+     */
+    uint64_t bank_request[MAX_CACHE_BANKS];
+    /** The total number of accesses to each bank. */
+    unsigned long long stat_bank_access[MAX_CACHE_BANKS];
+    /** The total number of cycles accesses queued for each bank. */
+    uint64_t stat_bank_queue_delay[MAX_CACHE_BANKS];
+    /** The total number of cycles spent crossing banks (NUCA). */
+    uint64_t stat_nuca_delay;
+
+    /**
+     * The latencies of reads from this level, including the levels below it
+     * on a miss. NULL if latency histograms are disabled.
+     */
+    LatencyHist *hist_read;
+
+    /**
+     * The total number of lines removed from the levels above because this
+     * (inclusive) level evicted them.
+     */
+    unsigned long long stat_incl_victims;
+    /** The total number of inclusion victims that were dirty. */
+    unsigned long long stat_incl_dirty_victims;
+    /** The total number of hits whose line moved up out of this level. */
+    unsigned long long stat_excl_moves;
+    /** The total number of victims from above installed in this level. */
+    unsigned long long stat_excl_fills;
+
+    /** The number of L1 cache lines each line of this level covers. */
+    uint64_t blocks_per_line;
+    /**
+     * The number of sectors each line is split into. Each sector has its own
+     * valid and dirty bit, so fills and writebacks only move the sectors
+     * touched. 1 if the level is not sectored.
+     */
+    unsigned int nof_sectors;
+    /** The total number of hits on a line that lacked a requested sector. */
+    unsigned long long stat_sector_misses;
+    /** The total number of bytes this level sent up to the level above. */
+    unsigned long long stat_read_bytes;
+    /** The total number of bytes written into this level from above. */
+    unsigned long long stat_write_bytes;
+} CacheLevel;
+
 typedef struct MemorySystem
 {
     /** A cache for data accesses. Used in parts A, B, and C. */
@@ -34,10 +160,97 @@ typedef struct MemorySystem
      */
     Cache *icache_coreid[2];
 
-    /** The shared L2 cache. Used in parts B, C, D, E, and F. */
-    Cache *l2cache;
+    /**
+     * The address space (process) currently running on each core in a
+     * multicore system. memsys_convert_vpn_to_pfn() uses it to keep the
+     * physical pages of different processes apart. Used in parts D, E, and F.
+     */
+    unsigned int asid_coreid[2];
+
+    /**
+     * The physical frame allocator behind memsys_convert_vpn_to_pfn(). NULL
+     * for the fixed arithmetic mapping. Used in parts D, E, and F.
+     */
+    FrameAllocator *frames;
+
+    /**
+     * The per-instruction miss profile, or NULL if profiling is disabled, and
+     * the address of the instruction each core is currently executing, which
+     * memsys_access() charges its misses and delay to.
+     */
+    PcProfile *pcprof;
+    uint64_t inst_addr_coreid[2];
+
+    /**
+     * The latencies of the memory accesses of each type made by each core,
+     * and of the DRAM accesses. NULL if latency histograms are disabled.
+     */
+    LatencyHist *hist_type_coreid[3][2];
+    LatencyHist *hist_dram;
+
+    /**
+     * The per-core L1 instruction and data TLBs and the shared L2 TLB. Each
+     * is a Cache whose "lines" are translations. NULL if TLBs are disabled,
+     * in which case translation is free. Used in parts D, E, and F.
+     */
+    Cache *itlb_coreid[2];
+    Cache *dtlb_coreid[2];
+    Cache *l2tlb;
+
+    /** The total number of page walks caused by L2 TLB misses. */
+    unsigned long long stat_walk_count;
+    /** The total number of cycles spent on page walks. */
+    uint64_t stat_walk_delay;
+
+    /**
+     * With coherence, the total number of stores to shared lines that had to
+     * invalidate the other copies first.
+     */
+    unsigned long long stat_coh_upgrades;
+    /** The total number of L1 copies invalidated by another core's store. */
+    unsigned long long stat_coh_invalidations;
+    /** The total number of misses served by another core's data cache. */
+    unsigned long long stat_coh_forwards;
+    /** The total number of modified lines written back to be shared. */
+    unsigned long long stat_coh_writebacks;
+    /** The number of misses on lines invalidated by the other core. */
+    unsigned long long stat_coh_misses_coreid[2];
+
+    /**
+     * The write-combining buffer of each core's L1 data cache. NULL if
+     * disabled. Index 0 is used in parts B and C.
+     */
+    WriteCombiningBuffer *wcbuf_coreid[2];
+    /** The total number of writes each core's L1 data cache sent down. */
+    unsigned long long stat_l1_writes_out_coreid[2];
+
+    /**
+     * Small fully-associative victim caches between each L1 cache and the L2
+     * cache. NULL if disabled. The plain pointers are used in parts B and C,
+     * the per-core arrays in parts D, E, and F.
+     */
+    Cache *dcache_vc;
+    Cache *icache_vc;
+    Cache *dcache_vc_coreid[2];
+    Cache *icache_vc_coreid[2];
+
+    /**
+     * The cache levels below the L1 caches, from the L2 outwards. By default
+     * this is a single shared L2 cache. Used in parts B, C, D, E, and F.
+     */
+    CacheLevel levels[MAX_CACHE_LEVELS];
+    /** The number of cache levels below the L1 caches. */
+    unsigned int nof_levels;
+    /**
+     * The number of memsys_access() calls so far, which identifies the
+     * request in flight to the bank model.
+     */
+    uint64_t request_id;
     /** The DRAM module. Used in parts B, C, D, E, and F. */
     DRAM *dram;
+    /** The total number of bytes read from and written to DRAM. */
+    unsigned long long stat_dram_read_bytes;
+    unsigned long long stat_dram_write_bytes;
 
     /**
      * The total number of times the memory system was accessed for an
@@ -101,6 +314,17 @@ MemorySystem *memsys_new();
 uint64_t memsys_access(MemorySystem *sys, uint64_t addr, AccessType type,
                        unsigned int core_id);
 
+/**
+ * Take a snapshot of the miss counters that an access by the given core can
+ * advance: its L1 caches, the first cache level below them, and DRAM.
+ *
+ * @param sys The memory system.
+ * @param core_id The CPU core ID.
+ * @param counts The snapshot to fill in.
+ */
+void memsys_pcprof_counts(MemorySystem *sys, unsigned int core_id,
+                          PcProfCounts *counts);
+
 /**
  * In mode A, access the given memory address from a load or store.
  * 
@@ -140,12 +364,47 @@ uint64_t memsys_access_modeBC(MemorySystem *sys, uint64_t line_addr,
                               AccessType type, unsigned int core_id);
 
 /**
- * Access the given address through the shared L2 cache.
+ * Build the cache levels below the L1 caches from HIERARCHY_DESC, or a single
+ * shared L2 cache from the L2 options if no description was given.
+ *
+ * A description is a comma-separated list of levels, from the one closest to
+ * the L1 caches outwards, each given as
+ * name:sizeKB:assoc:latency:scope:inclusion, where scope is p (one cache per
+ * core) or s (shared by all cores) and inclusion is an InclusionPolicy. For
+ * example, L2:256:8:12:p:0,L3:8192:16:40:s:1 models private L2 caches and a
+ * shared inclusive L3 cache. Exit with an error on a malformed description.
+ *
+ * @param sys The memory system to add the cache levels to.
+ */
+void memsys_build_hierarchy(MemorySystem *sys);
+
+/**
+ * Set the line size and number of sectors of the given cache level, after
+ * checking them. The line size must be a power of two multiple of the L1
+ * line size and no smaller than that of the level above, so each line of a
+ * level covers whole lines of the levels above. Sectors must be at least an
+ * L1 line, and an exclusive level, which swaps whole lines with the level
+ * above, keeps L1-sized lines.
+ *
+ * @param sys The memory system being built.
+ * @param level The index of the level. Its inclusion policy must be set.
+ * @param line_size The line size of the level, in bytes.
+ * @param nof_sectors The number of sectors per line (1 if not sectored).
+ * @return Whether the line size and number of sectors are valid.
+ */
+bool memsys_level_set_lines(MemorySystem *sys, unsigned int level,
+                            uint64_t line_size, unsigned long nof_sectors);
+
+/**
+ * Access the given address through the cache levels below the L1 caches.
  * 
- * Return the delay in cycles incurred by the L2 (and possibly DRAM) access.
+ * Return the delay in cycles incurred by the L2 (and possibly lower levels
+ * and DRAM) access.
  * 
  * This is intended to be implemented in part B and used in parts B through F
- * for icache misses, dcache misses, and dcache writebacks.
+ * for icache misses, dcache misses, and dcache writebacks. It is a thin
+ * wrapper around memsys_level_read() and memsys_level_evict() for requesters
+ * that do not keep the line, such as page walks.
  * 
  * @param sys The memory system to use for the access.
  * @param line_addr The (physical) address of the cache line to access (in
@@ -158,6 +417,407 @@ uint64_t memsys_access_modeBC(MemorySystem *sys, uint64_t line_addr,
 uint64_t memsys_l2_access(MemorySystem *sys, uint64_t line_addr,
                           bool is_writeback, unsigned int core_id);
 
+/**
+ * Handle an L1 cache miss: fetch the line (from the victim cache if the L1
+ * has one and it holds the line, otherwise from the levels below), install
+ * it in the L1 cache, and pass the line the L1 evicts on to the first level.
+ *
+ * With a victim cache, the L1 victim (clean or dirty) is saved there and
+ * only the line the victim cache evicts goes on to the levels below. What
+ * happens to an evicted line there depends on their inclusion policies; see
+ * memsys_level_evict().
+ *
+ * @param sys The memory system to use for the access.
+ * @param l1 The L1 cache that missed.
+ * @param vc The victim cache of that L1 cache, or NULL if it has none.
+ * @param line_addr The (physical) address of the cache line that missed (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access that missed is a write.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
+ */
+uint64_t memsys_l1_fill(MemorySystem *sys, Cache *l1, Cache *vc,
+                        uint64_t line_addr, bool is_write,
+                        unsigned int core_id);
+
+/**
+ * Access an L1 data cache for a load or store, applying the data cache write
+ * policies, and handle a miss.
+ *
+ * A store hit marks the line dirty under write-back, or sends the write down
+ * under write-through. A store miss allocates the line (write-allocate) or
+ * sends the write straight down (no-write-allocate). Writes sent down go
+ * through the core's write-combining buffer if there is one. A load miss
+ * first drains any combined write to the same line.
+ *
+ * @param sys The memory system to use for the access.
+ * @param dcache The L1 data cache of the core.
+ * @param vc The victim cache of that data cache, or NULL if it has none.
+ * @param line_addr The (physical) address of the cache line to access (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access is a store.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
+ */
+uint64_t memsys_dcache_access(MemorySystem *sys, Cache *dcache, Cache *vc,
+                              uint64_t line_addr, bool is_write,
+                              unsigned int core_id);
+
+/**
+ * Send a write of the given line from a core's L1 data cache to the first
+ * cache level, combining it with earlier writes to the same line if the core
+ * has a write-combining buffer. A full buffer first flushes its oldest line.
+ *
+ * @param sys The memory system to use for the access.
+ * @param line_addr The (physical) address of the written cache line (in units
+ *                  of the cache line size).
+ * @param core_id The CPU core ID that wrote the line.
+ * @return The delay in cycles incurred by sending the write down.
+ */
+uint64_t memsys_l1_write_out(MemorySystem *sys, uint64_t line_addr,
+                             unsigned int core_id);
+
+/**
+ * Flush the oldest line of a write-combining buffer to the first cache level.
+ *
+ * @param sys The memory system to use for the access.
+ * @param wc The write-combining buffer, which must not be empty.
+ * @param core_id The CPU core ID that owns the buffer.
+ * @return The delay in cycles incurred by sending the write down.
+ */
+uint64_t memsys_wcbuf_flush_oldest(MemorySystem *sys,
+                                   WriteCombiningBuffer *wc,
+                                   unsigned int core_id);
+
+/**
+ * Flush every line of the given core's write-combining buffer, if it has
+ * one, to the first cache level. Used at the end of the simulation, so the
+ * pending writes reach the caches and DRAM before the statistics are
+ * printed.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID whose write-combining buffer to flush.
+ */
+void memsys_flush_wcbuf(MemorySystem *sys, unsigned int core_id);
+
+/**
+ * Get the cache of the given level that serves the given core.
+ *
+ * @param level The cache level.
+ * @param core_id The CPU core ID.
+ * @return The core's private cache, or the shared cache of the level.
+ */
+Cache *memsys_level_cache(CacheLevel *level, unsigned int core_id);
+
+/**
+ * Get the time the given level takes to serve an access to the given line
+ * from the given core, and update the bank statistics.
+ *
+ * This is the level's hit latency, plus for a banked level any time spent
+ * queued behind earlier requests to the same bank and, with NUCA, the time
+ * to cross the banks between the core and the line's bank.
+ *
+ * @param sys The memory system, whose request in flight makes the access.
+ * @param lvl The cache level being accessed.
+ * @param line_addr The (physical) address of the cache line (in units of the
+ *                  cache line size).
+ * @param core_id The CPU core ID that requested the access.
+ * @return The delay in cycles incurred by the access at this level.
+ */
+uint64_t memsys_level_latency(MemorySystem *sys, CacheLevel *lvl,
+                              uint64_t line_addr, unsigned int core_id);
+
+/**
+ * Get the sectors of the given level's line that the given run of L1-sized
+ * blocks touches, as a bit mask. The run is clipped to the line holding its
+ * first block. A level that is not sectored has a single sector.
+ *
+ * @param lvl The cache level.
+ * @param line_addr The (physical) address of the first block (in units of the
+ *                  L1 cache line size).
+ * @param nof_blocks The number of blocks in the run.
+ * @return The mask of sectors touched.
+ */
+uint32_t memsys_level_sectors(CacheLevel *lvl, uint64_t line_addr,
+                              uint64_t nof_blocks);
+
+/**
+ * Get the run of L1-sized blocks that spans the given sectors of one of the
+ * given level's lines, from the first sector in the mask to the last.
+ *
+ * @param lvl The cache level.
+ * @param key The address of the line in the level's cache (in units of the
+ *            level's line size).
+ * @param sectors The mask of sectors. Must not be empty.
+ * @param nof_blocks Set to the number of blocks in the run.
+ * @return The (physical) address of the first block (in units of the L1
+ *         cache line size).
+ */
+uint64_t memsys_level_span(CacheLevel *lvl, uint64_t key, uint32_t sectors,
+                           uint64_t *nof_blocks);
+
+/**
+ * Read a run of blocks into the level above the given level (an L1 cache for
+ * level 0) by walking the hierarchy down until some level, or DRAM, has it.
+ *
+ * Levels that miss install the line on the way back up, except exclusive
+ * levels, which only receive victims. An exclusive level that hits gives its
+ * copy up to the requester, along with its dirty bit. A sectored level only
+ * fetches the sectors the run touches, both when it misses and when it holds
+ * the line but not all of those sectors (a sector miss).
+ *
+ * @param sys The memory system to use for the access.
+ * @param level The index of the level to read from. sys->nof_levels means
+ *              DRAM.
+ * @param line_addr The (physical) address of the first block to read (in
+ *                  units of the L1 cache line size).
+ * @param nof_blocks The number of blocks the requester needs, within one of
+ *                   its lines.
+ * @param core_id The CPU core ID that requested this access.
+ * @param is_dirty Set to true if the line comes up dirty. NULL if the
+ *                 requester does not keep the line, in which case exclusive
+ *                 levels keep their copy.
+ * @return The delay in cycles incurred by this access.
+ */
+uint64_t memsys_level_read(MemorySystem *sys, unsigned int level,
+                           uint64_t line_addr, uint64_t nof_blocks,
+                           unsigned int core_id, bool *is_dirty);
+
+/**
+ * Pass a run of blocks evicted from the level above the given level (an L1
+ * cache or victim cache for level 0) down to the given level.
+ *
+ * An exclusive level installs every victim, clean or dirty, unless it already
+ * holds the line. Other levels only see dirty victims: an inclusive level is
+ * guaranteed to hold the line and just marks it dirty, and a non-inclusive
+ * level passes the writeback on to the next level without allocating it. DRAM
+ * only receives dirty lines. In a sectored level, only the sectors the run
+ * touches are marked dirty.
+ *
+ * @param sys The memory system to use for the access.
+ * @param level The index of the level receiving the line. sys->nof_levels
+ *              means DRAM.
+ * @param line_addr The (physical) address of the first evicted block (in
+ *                  units of the L1 cache line size).
+ * @param nof_blocks The number of evicted blocks, within one line of the
+ *                   level above.
+ * @param is_dirty Whether the evicted line was dirty.
+ * @param core_id The CPU core ID that evicted the line.
+ * @return The delay in cycles incurred by passing the line on.
+ */
+uint64_t memsys_level_evict(MemorySystem *sys, unsigned int level,
+                            uint64_t line_addr, uint64_t nof_blocks,
+                            bool is_dirty, unsigned int core_id);
+
+/**
+ * Pass on the line the given level's cache evicted in its last install, if
+ * any, back-invalidating it from the levels above first if the level is
+ * inclusive. A dirty victim of a sectored level only writes back the run
+ * from its first dirty sector to its last.
+ *
+ * @param sys The memory system being used.
+ * @param level The index of the level that just installed a line.
+ * @param core_id The CPU core ID that caused the install.
+ * @return The delay in cycles incurred by writing back or passing on the
+ *         victim.
+ */
+uint64_t memsys_level_victim(MemorySystem *sys, unsigned int level,
+                             unsigned int core_id);
+
+/**
+ * Collect the L1 caches (and, if with_vcs is set, their victim caches) of the
+ * given core.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID.
+ * @param with_vcs Whether to include the victim caches.
+ * @param caches The array to append the caches to.
+ * @return The number of caches appended.
+ */
+unsigned int memsys_l1_caches(MemorySystem *sys, unsigned int core_id,
+                              bool with_vcs, Cache **caches);
+
+/**
+ * Remove the given line from every cache above the given level that it
+ * covers (for a private level, only the caches of that core), because the
+ * level is inclusive and evicted the line.
+ *
+ * @param sys The memory system being used.
+ * @param level The index of the inclusive level that evicted the line.
+ * @param line_addr The (physical) address of the first block of the evicted
+ *                  line (in units of the L1 cache line size).
+ * @param nof_blocks The number of blocks in the evicted line.
+ * @param core_id The CPU core ID that caused the eviction.
+ * @return Whether any of the removed copies was dirty.
+ */
+bool memsys_back_invalidate(MemorySystem *sys, unsigned int level,
+                            uint64_t line_addr, uint64_t nof_blocks,
+                            unsigned int core_id);
+
+/**
+ * Print the statistics of a victim cache, including the L2 traffic it saved.
+ *
+ * @param vc The victim cache to print the statistics of.
+ * @param l1 The L1 cache the victim cache belongs to.
+ * @param label A label for the victim cache, which is used as a prefix for
+ *              each statistic.
+ */
+void memsys_print_victim_stats(Cache *vc, Cache *l1, const char *label);
+
+/**
+ * Print the statistics of every cache level below the L1 caches. Each cache
+ * is labelled with its level name, followed by the core ID if the level is
+ * private (e.g., L2CACHE, or L2CACHE_0 and L2CACHE_1).
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_level_stats(MemorySystem *sys);
+
+/**
+ * Collect the L1 caches and the caches of every level below them, together
+ * with the labels used in their cache statistics (e.g., DCACHE_0, L2CACHE).
+ *
+ * @param sys The memory system being used.
+ * @param caches The array (of MAX_MEMSYS_CACHES entries) to fill in.
+ * @param labels The array (of MAX_MEMSYS_CACHES entries) to fill in with the
+ *               label of each cache.
+ * @return The number of caches collected.
+ */
+unsigned int memsys_list_caches(MemorySystem *sys, Cache **caches,
+                                char (*labels)[16]);
+
+/**
+ * Print the per-set access and miss distribution of the L1 caches and of
+ * every cache level below them, labelled as in their cache statistics.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_set_stats(MemorySystem *sys);
+
+/**
+ * Write the per-set counters of every cache (see memsys_list_caches()) and
+ * the per-bank counters of DRAM to CSV files for plotting as heatmaps. The
+ * files are named after the given prefix and the label of each cache, e.g.,
+ * prefix_L2CACHE.csv and prefix_DRAM.csv.
+ *
+ * @param sys The memory system to write the counters of.
+ * @param prefix The path prefix of the CSV files.
+ * @return Whether every file was written.
+ */
+bool memsys_write_heatmaps(MemorySystem *sys, const char *prefix);
+
+/**
+ * Print the lifetime statistics (hits per evicted line, dead time and reuse
+ * distances) of the L1 caches and of every cache level below them.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_lifetime_stats(MemorySystem *sys);
+
+/**
+ * Register the statistics of the memory system under the group "memsys":
+ * the accesses and average delay of each access type, every cache (grouped
+ * by its lowercase label, e.g., memsys.l2cache), the traffic and latency of
+ * each cache level (e.g., memsys.l2), DRAM, and the latency histograms if
+ * enabled.
+ *
+ * @param sys The memory system.
+ * @param reg The registry to add the statistics to.
+ */
+void memsys_register_stats(MemorySystem *sys, StatsRegistry *reg);
+
+/**
+ * Record a latency in the given histogram, if there is one.
+ *
+ * @param h The histogram, or NULL if latency histograms are disabled.
+ * @param delay The latency to record, in cycles.
+ * @return The latency, so calls can wrap a return value.
+ */
+uint64_t memsys_record_latency(LatencyHist *h, uint64_t delay);
+
+/**
+ * Access DRAM, recording the latency in the DRAM histogram and the host time
+ * in the host profile if they are enabled.
+ *
+ * @param sys The memory system.
+ * @param line_addr The address of the cache line to access.
+ * @param is_write Whether this access writes to DRAM.
+ * @return The delay in cycles incurred by the DRAM access.
+ */
+uint64_t memsys_dram_access(MemorySystem *sys, uint64_t line_addr,
+                            bool is_write);
+
+/**
+ * Print the latency percentiles of each access type (per core in a multicore
+ * system), of each cache level below the L1 caches, and of DRAM.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_latency_stats(MemorySystem *sys);
+
+/**
+ * Print the per-bank utilization and queuing statistics of every banked
+ * cache level.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_bank_stats(MemorySystem *sys);
+
+/**
+ * Print the write policy statistics: the writes each L1 data cache sent
+ * down, the write-combining buffers, and the writes each cache level
+ * received and absorbed.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_write_stats(MemorySystem *sys);
+
+/**
+ * Print the line size, sector misses, and data traffic of each cache level,
+ * and the traffic to and from DRAM, if any level has lines larger than the
+ * L1 caches or is sectored. The read traffic of a level is the data it sent
+ * up, and the write traffic the data written into it from above.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_traffic_stats(MemorySystem *sys);
+
+/**
+ * Print the inclusion policy statistics of each cache level that is not
+ * non-inclusive. The effective capacity of a level is the number of distinct
+ * lines held in the L1 caches and the levels down to it together at the end
+ * of the simulation.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_inclusion_stats(MemorySystem *sys);
+
+/**
+ * Count the distinct valid blocks (L1-sized units) held across the given
+ * caches.
+ *
+ * @param caches The caches to count the blocks of.
+ * @param levels The cache level of each cache, or NULL for an L1 or victim
+ *               cache. Gives the line size and sectors of the cache.
+ * @param nof_caches The number of caches.
+ * @return The number of distinct valid blocks.
+ */
+unsigned long long memsys_count_unique_lines(Cache **caches,
+                                             CacheLevel **levels,
+                                             unsigned int nof_caches);
+
+/**
+ * Check whether the given cache holds the given block, i.e., has its line
+ * with the block's sector valid.
+ *
+ * @param c The cache to check.
+ * @param lvl The cache level of the cache, or NULL for an L1 or victim cache.
+ * @param block The (physical) address of the block (in units of the L1 cache
+ *              line size).
+ * @return Whether the cache holds the block.
+ */
+bool memsys_holds_block(Cache *c, CacheLevel *lvl, uint64_t block);
+
 /**
  * In mode D, E, or F, access the given virtual address from an instruction
  * fetch or load/store.
@@ -182,6 +842,78 @@ uint64_t memsys_l2_access(MemorySystem *sys, uint64_t line_addr,
 uint64_t memsys_access_modeDEF(MemorySystem *sys, uint64_t v_line_addr,
                                AccessType type, unsigned int core_id);
 
+/**
+ * In mode D, E, or F with coherence enabled, access the given core's data
+ * cache under the MESI protocol.
+ *
+ * The directory sits at the L2 cache and is modelled as a copy of the L1
+ * tags, so it knows exactly which other data caches hold a line. A store to
+ * a shared line pays a round trip to the directory to invalidate the other
+ * copies (an upgrade). A miss on a line another core holds in E or M is
+ * served by that core (a cache-to-cache transfer) instead of the L2 cache;
+ * a load leaves both copies shared, writing back a modified line, and a
+ * store invalidates the other copy. A store miss on a line others share
+ * invalidates them.
+ *
+ * @param sys The memory system to use for the access.
+ * @param dcache The data cache of the core.
+ * @param line_addr The (physical) address of the cache line to access (in
+ *                  units of the cache line size).
+ * @param is_write Whether the access is a store.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred beyond the L1 lookup.
+ */
+uint64_t memsys_coherent_access(MemorySystem *sys, Cache *dcache,
+                                uint64_t line_addr, bool is_write,
+                                unsigned int core_id);
+
+/**
+ * Invalidate the copies of the given line in the data caches of every core
+ * other than the given one, marking them so that a later miss on them counts
+ * as a coherence miss.
+ *
+ * @param sys The memory system being used.
+ * @param line_addr The (physical) address of the cache line (in units of the
+ *                  cache line size).
+ * @param core_id The CPU core ID that is taking ownership of the line.
+ * @return The delay in cycles to invalidate the copies and collect the
+ *         acknowledgements, or 0 if no other core held the line.
+ */
+uint64_t memsys_coh_invalidate_peers(MemorySystem *sys, uint64_t line_addr,
+                                     unsigned int core_id);
+
+/**
+ * Look up the translation of the given virtual address in the TLBs of the
+ * given core, walking the page table on an L2 TLB miss.
+ *
+ * Return the delay in cycles added by address translation: nothing on an L1
+ * TLB hit (it is looked up in parallel with the L1 cache), the L2 TLB hit
+ * latency on an L1 TLB miss, and the page walk on top of it on an L2 TLB
+ * miss.
+ *
+ * @param sys The memory system being used.
+ * @param v_line_addr The virtual address of the cache line being accessed (in
+ *                    units of the cache line size).
+ * @param type The type of memory access.
+ * @param core_id The CPU core ID that requested this access.
+ * @return The delay in cycles incurred by address translation.
+ */
+uint64_t memsys_tlb_access(MemorySystem *sys, uint64_t v_line_addr,
+                           AccessType type, unsigned int core_id);
+
+/**
+ * Walk the radix page table of the process running on the given core for the
+ * given virtual page. Every level reads one page-table entry through the L2
+ * cache (and DRAM on a miss).
+ *
+ * @param sys The memory system being used.
+ * @param vpn The virtual page number (of TLB_PAGE_SIZE pages) to walk for.
+ * @param core_id The CPU core ID that requested this walk.
+ * @return The delay in cycles incurred by the walk.
+ */
+uint64_t memsys_page_walk(MemorySystem *sys, uint64_t vpn,
+                          unsigned int core_id);
+
 /**
  * Convert the given virtual page number (VPN) to its corresponding physical
  * frame number (PFN; also known as physical page number, or PPN).
@@ -199,6 +931,16 @@ uint64_t memsys_access_modeDEF(MemorySystem *sys, uint64_t v_line_addr,
 uint64_t memsys_convert_vpn_to_pfn(MemorySystem *sys, uint64_t vpn,
                                    unsigned int core_id);
 
+/**
+ * Flush the private L1 caches of the given core, writing dirty lines back to
+ * the L2 cache and invalidating every line. Used on context switches in mode
+ * D, E, or F.
+ *
+ * @param sys The memory system being used.
+ * @param core_id The CPU core ID whose L1 caches to flush.
+ */
+void memsys_flush_l1(MemorySystem *sys, unsigned int core_id);
+
 /**
  * Print the statistics of the memory system.
  * 
@@ -208,4 +950,19 @@ uint64_t memsys_convert_vpn_to_pfn(MemorySystem *sys, uint64_t vpn,
  */
 void memsys_print_stats(MemorySystem *sys);
 
+/**
+ * Print the TLB statistics of the memory system in mode D, E, or F. MPKI is
+ * computed per thousand instructions of the core (all cores for the L2 TLB).
+ *
+ * @param sys The memory system to print the TLB statistics of.
+ */
+void memsys_print_tlb_stats(MemorySystem *sys);
+
+/**
+ * Print the coherence statistics of the memory system in mode D, E, or F.
+ *
+ * @param sys The memory system to print the statistics of.
+ */
+void memsys_print_coherence_stats(MemorySystem *sys);
+
 #endif // __MEMSYS_H__
@@ -0,0 +1,236 @@
+// pcprof.cpp
+// Defines the functions used to implement the per-instruction miss profiler.
+
+#include "pcprof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The initial number of entries and of slots in the hash table. */
+#define PCPROF_INITIAL_CAPACITY 1024
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty profile.
+ *
+ * @return A pointer to the profile.
+ */
+PcProfile *pcprof_new()
+{
+    PcProfile *prof = (PcProfile *)calloc(1, sizeof(PcProfile));
+    prof->capacity = PCPROF_INITIAL_CAPACITY;
+    prof->entries = (PcProfEntry *)calloc(prof->capacity,
+                                          sizeof(PcProfEntry));
+    prof->index = hashmap_new(PCPROF_INITIAL_CAPACITY);
+    return prof;
+}
+
+/**
+ * Find the entry of the given instruction address, adding an empty one if
+ * there is none.
+ *
+ * @param prof The profile to search.
+ * @param inst_addr The instruction address.
+ * @return The entry of the instruction address.
+ */
+PcProfEntry *pcprof_lookup(PcProfile *prof, uint64_t inst_addr)
+{
+    uint64_t slot = hashmap_find(prof->index, inst_addr);
+
+    if (prof->index->used[slot])
+    {
+        return &prof->entries[prof->index->values[slot]];
+    }
+
+    if (prof->count == prof->capacity)
+    {
+        prof->capacity *= 2;
+        prof->entries = (PcProfEntry *)realloc(
+            prof->entries, prof->capacity * sizeof(PcProfEntry));
+    }
+
+    PcProfEntry *entry = &prof->entries[prof->count];
+    memset(entry, 0, sizeof(PcProfEntry));
+    entry->inst_addr = inst_addr;
+    hashmap_insert(prof->index, slot, inst_addr, prof->count++);
+    return entry;
+}
+
+/**
+ * Charge one memory access to the given instruction address.
+ *
+ * @param prof The profile to update.
+ * @param inst_addr The address of the instruction that made the access.
+ * @param type The type of memory access.
+ * @param delay The delay in cycles incurred by the access.
+ * @param before The miss counters before the access.
+ * @param after The miss counters after the access.
+ */
+void pcprof_record(PcProfile *prof, uint64_t inst_addr, AccessType type,
+                   uint64_t delay, PcProfCounts *before, PcProfCounts *after)
+{
+    PcProfEntry *entry = pcprof_lookup(prof, inst_addr);
+
+    entry->accesses++;
+    entry->misses.icache_miss += after->icache_miss - before->icache_miss;
+    entry->misses.dcache_miss += after->dcache_miss - before->dcache_miss;
+    entry->misses.l2_miss += after->l2_miss - before->l2_miss;
+    entry->misses.dram_access += after->dram_access - before->dram_access;
+
+    if (type == ACCESS_TYPE_IFETCH)
+    {
+        entry->ifetch_delay += delay;
+    }
+    else if (type == ACCESS_TYPE_LOAD)
+    {
+        entry->load_delay += delay;
+    }
+    else
+    {
+        entry->store_delay += delay;
+    }
+}
+
+/**
+ * Order profile entries by decreasing fetch and load delay, then by
+ * decreasing number of misses, then by address. Used with qsort().
+ */
+int pcprof_compare(const void *a, const void *b)
+{
+    const PcProfEntry *x = (const PcProfEntry *)a;
+    const PcProfEntry *y = (const PcProfEntry *)b;
+    uint64_t x_delay = x->ifetch_delay + x->load_delay;
+    uint64_t y_delay = y->ifetch_delay + y->load_delay;
+    unsigned long long x_misses = x->misses.icache_miss +
+                                  x->misses.dcache_miss;
+    unsigned long long y_misses = y->misses.icache_miss +
+                                  y->misses.dcache_miss;
+
+    if (x_delay != y_delay)
+    {
+        return (x_delay > y_delay) ? -1 : 1;
+    }
+    if (x_misses != y_misses)
+    {
+        return (x_misses > y_misses) ? -1 : 1;
+    }
+    return (x->inst_addr < y->inst_addr) ? -1 : (x->inst_addr > y->inst_addr);
+}
+
+/**
+ * Copy the entries of the profile into a new array, sorted with
+ * pcprof_compare(). The caller must free the array.
+ *
+ * @param prof The profile.
+ * @return The sorted array of prof->count entries.
+ */
+PcProfEntry *pcprof_sorted(PcProfile *prof)
+{
+    PcProfEntry *sorted = (PcProfEntry *)calloc(prof->count + 1,
+                                                sizeof(PcProfEntry));
+
+    memcpy(sorted, prof->entries, prof->count * sizeof(PcProfEntry));
+    qsort(sorted, prof->count, sizeof(PcProfEntry), pcprof_compare);
+    return sorted;
+}
+
+/**
+ * Print the given number of instruction addresses with the most fetch and
+ * load delay, along with their misses.
+ *
+ * @param prof The profile to print.
+ * @param top_n The number of instruction addresses to print.
+ */
+void pcprof_print_stats(PcProfile *prof, unsigned int top_n)
+{
+    PcProfEntry *sorted = pcprof_sorted(prof);
+    uint64_t total_delay = 0;
+
+    for (uint64_t i = 0; i < prof->count; i++)
+    {
+        total_delay += sorted[i].ifetch_delay + sorted[i].load_delay;
+    }
+
+    printf("\n");
+    printf("PCPROF_DISTINCT_PCS  \t\t : %10llu\n",
+           (unsigned long long)prof->count);
+    printf("PCPROF_STALL_DELAY   \t\t : %10llu\n",
+           (unsigned long long)total_delay);
+    printf("PCPROF_RANK  INST_ADDR           ACCESSES  IFETCH_DELAY    "
+           "LOAD_DELAY  DELAY%%  ICACHE_MISS  DCACHE_MISS    L2_MISS  "
+           "DRAM_ACCESS\n");
+
+    for (uint64_t i = 0; i < prof->count && i < top_n; i++)
+    {
+        PcProfEntry *e = &sorted[i];
+        uint64_t delay = e->ifetch_delay + e->load_delay;
+
+        printf("PCPROF_%-4llu  ", (unsigned long long)i + 1);
+        if (e->inst_addr == PCPROF_STORE_BUFFER)
+        {
+            printf("%-16s", "store-buffer");
+        }
+        else
+        {
+            printf("0x%-14llx", (unsigned long long)e->inst_addr);
+        }
+        printf("  %10llu  %12llu  %12llu  %6.2f  %11llu  %11llu  %9llu  "
+               "%11llu\n", e->accesses,
+               (unsigned long long)e->ifetch_delay,
+               (unsigned long long)e->load_delay,
+               total_delay ? 100.0 * delay / total_delay : 0.0,
+               e->misses.icache_miss, e->misses.dcache_miss,
+               e->misses.l2_miss, e->misses.dram_access);
+    }
+
+    free(sorted);
+}
+
+/**
+ * Write every entry of the profile to a CSV file, most delay first.
+ *
+ * @param prof The profile to write.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool pcprof_write_csv(PcProfile *prof, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+
+    PcProfEntry *sorted = pcprof_sorted(prof);
+
+    fprintf(f, "inst_addr,accesses,ifetch_delay,load_delay,store_delay,"
+               "icache_miss,dcache_miss,l2_miss,dram_access\n");
+    for (uint64_t i = 0; i < prof->count; i++)
+    {
+        PcProfEntry *e = &sorted[i];
+        if (e->inst_addr == PCPROF_STORE_BUFFER)
+        {
+            fprintf(f, "store-buffer");
+        }
+        else
+        {
+            fprintf(f, "0x%llx", (unsigned long long)e->inst_addr);
+        }
+        fprintf(f, ",%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", e->accesses,
+                (unsigned long long)e->ifetch_delay,
+                (unsigned long long)e->load_delay,
+                (unsigned long long)e->store_delay, e->misses.icache_miss,
+                e->misses.dcache_miss, e->misses.l2_miss,
+                e->misses.dram_access);
+    }
+
+    free(sorted);
+    return fclose(f) == 0;
+}
@@ -0,0 +1,123 @@
+// pcprof.h
+// Contains declarations of data structures and functions used to implement a
+// per-instruction miss profiler. It attributes the cache and DRAM misses and
+// the memory delay of every access to the address of the instruction that
+// made it, so the few instructions behind most of the stalls can be found.
+
+#ifndef __PCPROF_H__
+#define __PCPROF_H__
+
+#include "types.h"
+#include "hashmap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The instruction address charged for stores that drain from a store buffer,
+ * which no longer know the instruction that made them.
+ */
+#define PCPROF_STORE_BUFFER 0xFFFFFFFFFFFFFFFFULL
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Snapshot of the miss counters that an access can advance. The profiler
+ * charges the difference between the snapshots taken before and after an
+ * access to its instruction.
+ */
+typedef struct PcProfCounts
+{
+    unsigned long long icache_miss;
+    unsigned long long dcache_miss;
+    unsigned long long l2_miss;
+    unsigned long long dram_access;
+} PcProfCounts;
+
+/** The misses and delay attributed to one instruction address. */
+typedef struct PcProfEntry
+{
+    /** The instruction address. */
+    uint64_t inst_addr;
+
+    /** The total number of memory accesses made by the instruction. */
+    unsigned long long accesses;
+
+    /** The misses and DRAM accesses the instruction caused. */
+    PcProfCounts misses;
+
+    /** The total memory delay of the instruction's fetches, loads and stores. */
+    uint64_t ifetch_delay;
+    uint64_t load_delay;
+    uint64_t store_delay;
+} PcProfEntry;
+
+/**
+ * The profile entries, in the order their instructions were first seen, and
+ * a hash table from instruction addresses to their index in the entries.
+ */
+typedef struct PcProfile
+{
+    PcProfEntry *entries;
+    uint64_t count;
+    uint64_t capacity;
+
+    HashMap *index;
+} PcProfile;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty profile.
+ *
+ * @return A pointer to the profile.
+ */
+PcProfile *pcprof_new();
+
+/**
+ * Find the entry of the given instruction address, adding an empty one if
+ * there is none.
+ *
+ * @param prof The profile to search.
+ * @param inst_addr The instruction address.
+ * @return The entry of the instruction address.
+ */
+PcProfEntry *pcprof_lookup(PcProfile *prof, uint64_t inst_addr);
+
+/**
+ * Charge one memory access to the given instruction address.
+ *
+ * @param prof The profile to update.
+ * @param inst_addr The address of the instruction that made the access.
+ * @param type The type of memory access.
+ * @param delay The delay in cycles incurred by the access.
+ * @param before The miss counters before the access.
+ * @param after The miss counters after the access.
+ */
+void pcprof_record(PcProfile *prof, uint64_t inst_addr, AccessType type,
+                   uint64_t delay, PcProfCounts *before, PcProfCounts *after);
+
+/**
+ * Print the given number of instruction addresses with the most fetch and
+ * load delay, along with their misses.
+ *
+ * @param prof The profile to print.
+ * @param top_n The number of instruction addresses to print.
+ */
+void pcprof_print_stats(PcProfile *prof, unsigned int top_n);
+
+/**
+ * Write every entry of the profile to a CSV file, most delay first.
+ *
+ * @param prof The profile to write.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool pcprof_write_csv(PcProfile *prof, const char *path);
+
+#endif // __PCPROF_H__
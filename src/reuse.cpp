@@ -0,0 +1,176 @@
+// reuse.cpp
+// Defines the functions used to measure sampled reuse distances.
+
+#include "reuse.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The initial number of slots in the hash table and of timestamps. */
+#define REUSE_INITIAL_CAPACITY 1024
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a reuse distance tracker.
+ *
+ * @param sample_rate One in this many lines is tracked (1 tracks every line).
+ * @return A pointer to the tracker.
+ */
+ReuseSampler *reuse_new(uint64_t sample_rate)
+{
+    ReuseSampler *r = (ReuseSampler *)calloc(1, sizeof(ReuseSampler));
+
+    r->sample_rate = sample_rate;
+    r->lines = hashmap_new(REUSE_INITIAL_CAPACITY);
+    r->ts_capacity = REUSE_INITIAL_CAPACITY;
+    r->owner = (uint64_t *)calloc(r->ts_capacity, sizeof(uint64_t));
+    r->fenwick = (int32_t *)calloc(r->ts_capacity + 1, sizeof(int32_t));
+    r->distances = latency_hist_new();
+    return r;
+}
+
+/**
+ * Add the given value to the count of a timestamp in the Fenwick tree.
+ *
+ * @param r The tracker.
+ * @param ts The timestamp.
+ * @param value The value to add.
+ */
+void reuse_fenwick_add(ReuseSampler *r, uint64_t ts, int32_t value)
+{
+    for (uint64_t i = ts + 1; i <= r->ts_capacity; i += i & (~i + 1))
+    {
+        r->fenwick[i] += value;
+    }
+}
+
+/**
+ * Count the live timestamps before the given one.
+ *
+ * @param r The tracker.
+ * @param ts The timestamp.
+ * @return The number of live timestamps in [0, ts).
+ */
+uint64_t reuse_fenwick_sum(ReuseSampler *r, uint64_t ts)
+{
+    int64_t sum = 0;
+
+    for (uint64_t i = ts; i > 0; i -= i & (~i + 1))
+    {
+        sum += r->fenwick[i];
+    }
+
+    return (uint64_t)sum;
+}
+
+/**
+ * Point the latest timestamp of every tracked line at the line's slot, after
+ * the hash table grew and moved the lines.
+ *
+ * @param r The tracker.
+ */
+void reuse_update_owners(ReuseSampler *r)
+{
+    for (uint64_t slot = 0; slot < r->lines->capacity; slot++)
+    {
+        if (r->lines->used[slot])
+        {
+            r->owner[r->lines->values[slot]] = slot + 1;
+        }
+    }
+}
+
+/**
+ * Renumber the live timestamps from 0, in order, dropping the dead ones, and
+ * grow the timestamp space if it would still be more than half full.
+ *
+ * @param r The tracker to compact.
+ */
+void reuse_compact(ReuseSampler *r)
+{
+    uint64_t nof_live = 0;
+
+    for (uint64_t ts = 0; ts < r->nof_ts; ts++)
+    {
+        if (r->owner[ts])
+        {
+            r->lines->values[r->owner[ts] - 1] = nof_live;
+            r->owner[nof_live++] = r->owner[ts];
+        }
+    }
+
+    if (nof_live * 2 > r->ts_capacity)
+    {
+        r->ts_capacity *= 2;
+        r->owner = (uint64_t *)realloc(r->owner,
+                                       r->ts_capacity * sizeof(uint64_t));
+        free(r->fenwick);
+        r->fenwick = (int32_t *)calloc(r->ts_capacity + 1, sizeof(int32_t));
+    }
+    else
+    {
+        memset(r->fenwick, 0, (r->ts_capacity + 1) * sizeof(int32_t));
+    }
+    memset(&r->owner[nof_live], 0,
+           (r->ts_capacity - nof_live) * sizeof(uint64_t));
+
+    r->nof_ts = nof_live;
+    for (uint64_t ts = 0; ts < nof_live; ts++)
+    {
+        reuse_fenwick_add(r, ts, 1);
+    }
+}
+
+/**
+ * Record an access to the given line, and its reuse distance if the line is
+ * tracked and was accessed before.
+ *
+ * @param r The tracker.
+ * @param line_addr The address of the accessed line.
+ */
+void reuse_access(ReuseSampler *r, uint64_t line_addr)
+{
+    // Sample with a different hash than the table's, so the tracked lines
+    // do not all land in the same slots.
+    if ((line_addr * 0xC2B2AE3D27D4EB4FULL >> 40) % r->sample_rate)
+    {
+        return;
+    }
+
+    if (r->nof_ts == r->ts_capacity)
+    {
+        reuse_compact(r);
+    }
+
+    uint64_t slot = hashmap_find(r->lines, line_addr);
+    uint64_t ts = r->nof_ts++;
+
+    r->owner[ts] = slot + 1;
+    reuse_fenwick_add(r, ts, 1);
+
+    if (r->lines->used[slot])
+    {
+        uint64_t prev = r->lines->values[slot];
+        uint64_t distance = reuse_fenwick_sum(r, ts) -
+                            reuse_fenwick_sum(r, prev + 1);
+
+        latency_hist_record(r->distances, distance * r->sample_rate);
+        reuse_fenwick_add(r, prev, -1);
+        r->owner[prev] = 0;
+        r->lines->values[slot] = ts;
+    }
+    else
+    {
+        r->stat_cold++;
+        if (hashmap_insert(r->lines, slot, line_addr, ts))
+        {
+            reuse_update_owners(r);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+// reuse.h
+// Contains declarations of data structures and functions used to measure the
+// reuse (LRU stack) distance of the accesses a cache sees: the number of
+// distinct lines accessed between two accesses to the same line. An access
+// with a reuse distance below the number of lines in a fully-associative LRU
+// cache hits in it, so the distribution shows how much capacity a workload
+// needs.
+
+#ifndef __REUSE_H__
+#define __REUSE_H__
+
+#include "types.h"
+#include "latency.h"
+#include "hashmap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A sampled reuse distance tracker. Only the lines whose address hashes to a
+ * multiple of the sampling rate are tracked (spatial sampling, as in SHARDS),
+ * and the distances among them are scaled up by the rate.
+ *
+ * Each access to a tracked line gets the next timestamp. A timestamp is live
+ * while it is the latest access of its line, and a Fenwick tree over the
+ * timestamps counts the live ones, so the reuse distance of an access is the
+ * number of live timestamps since the previous access to its line. Dead
+ * timestamps are compacted away when the timestamp space fills up, so the
+ * memory used grows with the number of tracked lines, not with the number of
+ * accesses.
+ */
+typedef struct ReuseSampler
+{
+    /** One in this many lines is tracked. */
+    uint64_t sample_rate;
+
+    /** The tracked lines, from their address to their latest timestamp. */
+    HashMap *lines;
+
+    /**
+     * For each timestamp, the table slot plus one of the line whose latest
+     * access it is, or 0 if it is dead; and a Fenwick tree of the live ones.
+     */
+    uint64_t *owner;
+    int32_t *fenwick;
+    uint64_t nof_ts;
+    uint64_t ts_capacity;
+
+    /** The (scaled) reuse distances of the tracked accesses, in lines. */
+    LatencyHist *distances;
+
+    /** The number of tracked accesses to lines not accessed before. */
+    unsigned long long stat_cold;
+} ReuseSampler;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a reuse distance tracker.
+ *
+ * @param sample_rate One in this many lines is tracked (1 tracks every line).
+ * @return A pointer to the tracker.
+ */
+ReuseSampler *reuse_new(uint64_t sample_rate);
+
+/**
+ * Record an access to the given line, and its reuse distance if the line is
+ * tracked and was accessed before.
+ *
+ * @param r The tracker.
+ * @param line_addr The address of the accessed line.
+ */
+void reuse_access(ReuseSampler *r, uint64_t line_addr);
+
+#endif // __REUSE_H__
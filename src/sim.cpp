@@ -9,14 +9,27 @@
 #include "types.h"
 #include "memsys.h"
 #include "core.h"
+#include "interval.h"
+#include "hostprof.h"
+#include "bench.h"
+#include "tracegen.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <signal.h>
 
 #define MAX_CORES 2
+#define MAX_PROCS 16
 #define PRINT_DOTS 1
 #define DOT_INTERVAL 100000
 
+/**
+ * The number of instructions after a context switch that are charged to the
+ * cache warmup of the process being switched in.
+ */
+#define SCHED_WARMUP_INSTS 10000
+
 /**
  * The current mode under which the simulation is running, corresponding to
  * which part of the lab is being evaluated.
@@ -47,6 +60,114 @@ uint64_t L2CACHE_SIZE = 1024 * 1024;
 /** The associativity of the L2 cache. */
 uint64_t L2CACHE_ASSOC = 16;
 
+/** The line size of the L2 cache in bytes. 0 means the L1 line size. */
+uint64_t L2CACHE_LINESIZE = 0;
+
+/** The number of sectors in each L2 cache line. 1 means not sectored. */
+unsigned int L2CACHE_SECTORS = 1;
+
+/** The set index function of the L1 caches and of the levels below them. */
+IndexFunction L1_INDEX_FN = INDEX_MODULO;
+IndexFunction L2_INDEX_FN = INDEX_MODULO;
+
+/** Whether to print the per-set access and miss distribution of each cache. */
+bool SET_STATS = false;
+
+/** Whether to keep and print latency histograms (tail latencies). */
+bool LATENCY_HIST = false;
+
+/**
+ * Whether to record the lifetime statistics of each cache: 0 disables them;
+ * otherwise one in this many lines is tracked for reuse distances.
+ */
+uint64_t LIFETIME_STATS = 0;
+
+/** The path prefix of the per-set and per-bank heatmap files (NULL for none). */
+const char *HEATMAP_PREFIX = NULL;
+
+/** The paths of the JSON and CSV statistics files (NULL for none). */
+const char *STATS_JSON = NULL;
+const char *STATS_CSV = NULL;
+
+/**
+ * The path of the live statistics file that is updated while the simulation
+ * runs (NULL for none), and of the JSON snapshot written on SIGUSR1.
+ */
+const char *LIVE_STATS = NULL;
+const char *SNAPSHOT_JSON = "snapshot.json";
+
+/**
+ * Whether to profile the simulator itself. This reports the simulation speed
+ * and host time by stage, and prints a status line instead of the progress
+ * dots.
+ */
+int HOSTPROF = 0;
+
+/**
+ * The path of the microbenchmark baseline file. If set, the simulator runs
+ * its microbenchmarks instead of simulating traces.
+ */
+const char *BENCH_BASELINE = NULL;
+
+/**
+ * The path of a gzip-compressed trace file to write the first (generated)
+ * trace to instead of simulating it (NULL for none).
+ */
+const char *GEN_TRACE = NULL;
+
+/**
+ * The number of instruction addresses in the per-instruction miss profile
+ * report, and the path of its CSV file (NULL for none). The profiler is
+ * enabled if either is set.
+ */
+unsigned int PCPROF_TOP_N = 0;
+const char *PCPROF_CSV = NULL;
+
+/**
+ * The period of the interval statistics, in cycles or in instructions
+ * (summed over all cores), and the path of their CSV file. 0 disables them.
+ */
+uint64_t INTERVAL_CYCLES = 0;
+uint64_t INTERVAL_INSTS = 0;
+const char *INTERVAL_CSV = "intervals.csv";
+
+/** The number of entries in each L1 victim cache. 0 disables them. */
+uint64_t VICTIM_ENTRIES = 0;
+
+/** The inclusion policy of the L2 cache with respect to the L1 caches. */
+InclusionPolicy L2_INCLUSION = NON_INCLUSIVE;
+
+/**
+ * A description of the cache levels below the L1 caches (see
+ * memsys_build_hierarchy()), or NULL for a single shared L2 cache.
+ */
+const char *HIERARCHY_DESC = NULL;
+
+/** The number of banks of each shared cache level. 0 disables banking. */
+unsigned int CACHE_BANKS = 0;
+
+/** The number of cycles a bank is busy with each access. */
+uint64_t BANK_BUSY_CYCLES = 2;
+
+/** The extra latency to cross each bank between a core and the bank (NUCA). */
+uint64_t NUCA_HOP_LATENCY = 0;
+
+/** Whether the L1 data caches write stores through to the next level. */
+bool DCACHE_WRITE_THROUGH = false;
+
+/** Whether the L1 data caches allocate lines on a store miss. */
+bool DCACHE_WRITE_ALLOCATE = true;
+
+/** The number of lines in each write-combining buffer. 0 disables them. */
+uint64_t WC_ENTRIES = 0;
+
+/**
+ * The write-back and write-allocate policies of the default L2 cache (0 or
+ * 1), or -1 to follow its inclusion policy.
+ */
+int L2_WRITE_BACK = -1;
+int L2_WRITE_ALLOC = -1;
+
 /** The replacement policy to use for the L2 cache. */
 ReplacementPolicy L2CACHE_REPL = LRU;
 
@@ -66,6 +187,114 @@ unsigned int NUM_CORES = 0;
 /** Which page policy the DRAM should use. */
 DRAMPolicy DRAM_PAGE_POLICY = OPEN_PAGE;
 
+/** The number of entries in each L1 TLB. 0 disables the TLBs. */
+uint64_t L1TLB_ENTRIES = 0;
+
+/** The associativity of each L1 TLB. */
+uint64_t L1TLB_ASSOC = 4;
+
+/** The number of entries in the shared L2 TLB. */
+uint64_t L2TLB_ENTRIES = 1024;
+
+/** The associativity of the shared L2 TLB. */
+uint64_t L2TLB_ASSOC = 8;
+
+/** The page size in bytes used by the TLBs (4 KB or 2 MB). */
+uint64_t TLB_PAGE_SIZE = 4096;
+
+/** The policy used to place virtual pages in physical frames. */
+FrameAllocPolicy FRAME_ALLOC_POLICY = FRAME_ALLOC_FIXED;
+
+/**
+ * For the page-coloring frame allocator, the number of page colors of the
+ * last shared cache level that core 0 may use. The remaining colors are for
+ * core 1. 0 means half.
+ */
+uint64_t COLOR_CORE0 = 0;
+
+/** Whether the cores share an address space and keep their L1s coherent. */
+bool COHERENCE = false;
+
+/**
+ * The capacity of DRAM in bytes when it acts as a memory-side cache in front
+ * of the far-memory tier. 0 disables the far-memory tier.
+ */
+uint64_t DRAMCACHE_SIZE = 0;
+
+/** The associativity of the DRAM cache. */
+uint64_t DRAMCACHE_ASSOC = 4;
+
+/** The granularity, in bytes, at which data migrates between the tiers. */
+uint64_t DRAMCACHE_BLOCKSIZE = 4096;
+
+/** The access latency of the far-memory device, in cycles. */
+uint64_t FARMEM_LATENCY = 300;
+
+/** The bandwidth of the far-memory device, in bytes per cycle. */
+uint64_t FARMEM_BW = 16;
+
+/** Which timing model the CPU cores should use. */
+CoreModel CORE_MODEL = CORE_MODEL_INORDER;
+
+/** The number of instructions a core can dispatch and retire per cycle. */
+unsigned int CORE_WIDTH = 1;
+
+/** The number of distinct icache lines a core can fetch from per cycle. */
+unsigned int FETCH_LINES = 1;
+
+/** The number of loads a core can issue per cycle. */
+unsigned int LOAD_PORTS = 2;
+
+/** The number of stores a core can issue (or retire) per cycle. */
+unsigned int STORE_PORTS = 1;
+
+/** The number of reorder buffer entries in an out-of-order core. */
+unsigned int ROB_SIZE = 128;
+
+/** The number of load queue entries in an out-of-order core. */
+unsigned int LQ_SIZE = 32;
+
+/** The number of store queue entries in an out-of-order core. */
+unsigned int SQ_SIZE = 32;
+
+/**
+ * The number of entries in each core's store buffer. 0 disables the store
+ * buffer, in which case stores access the memory system synchronously.
+ */
+unsigned int SB_SIZE = 0;
+
+/**
+ * The scheduling quantum in cycles. 0 disables the scheduler, in which case
+ * trace N runs on core N for the whole simulation.
+ */
+uint64_t SCHED_QUANTUM = 0;
+
+/** Whether to flush a core's private L1 caches on every context switch. */
+bool SCHED_FLUSH_L1 = false;
+
+/**
+ * A process of the multiprogrammed scheduler, i.e., a trace that is
+ * time-sliced over the cores. Each process has its own address space.
+ */
+typedef struct Process
+{
+    /** The trace and pipeline state; core_id is the core it last ran on. */
+    Core *core;
+
+    unsigned int pid;
+    bool running;
+
+    /** The instruction count up to which the process is warming up. */
+    unsigned long long warmup_end_inst;
+
+    unsigned long long stat_run_cycles;
+    unsigned long long stat_switches;
+    unsigned long long stat_warmup_cycles;
+    unsigned long long stat_warmup_insts;
+    unsigned long long stat_steady_cycles;
+    unsigned long long stat_steady_insts;
+} Process;
+
 /**
  * The current clock cycle number.
  * 
@@ -75,12 +304,33 @@ uint64_t current_cycle;
 
 MemorySystem *memsys;
 Core *core[MAX_CORES];
-const char *trace_filename[MAX_CORES];
+const char *trace_filename[MAX_PROCS];
+unsigned int NUM_PROCS;
+Process proc[MAX_PROCS];
+Process *running_proc[MAX_CORES];
+unsigned int last_pid[MAX_CORES];
+unsigned int sched_next_pid;
 uint64_t last_printdot_cycle;
+IntervalLog *interval_log;
+StatsRegistry *stats;
+HostProfile *hostprof;
+volatile sig_atomic_t snapshot_requested;
+uint64_t next_interval_inst;
 
 int parse_args(int argc, char **argv);
+void sched_init();
+bool sched_cycle();
+void host_core_cycle(Core *core);
+Process *sched_pick();
+void sched_switch_in(unsigned int core_id, Process *p);
+void sched_print_stats();
 void print_dots();
+unsigned long long interval_stream_insts(unsigned long long *insts);
+void interval_check(bool is_last);
 void print_stats();
+void register_stats();
+void write_stats();
+void request_snapshot(int signum);
 void print_usage(const char *program_name);
 
 int main(int argc, char **argv)
@@ -92,10 +342,61 @@ int main(int argc, char **argv)
     }
 
     srand(42);
+    if (BENCH_BASELINE)
+    {
+        return bench_run(BENCH_BASELINE);
+    }
+
+    if (GEN_TRACE)
+    {
+        TraceGenSpec spec;
+        tracegen_parse(trace_filename[0], &spec);
+        if (!tracegen_write_file(tracegen_new(&spec), GEN_TRACE))
+        {
+            fprintf(stderr, "Error: could not write %s\n", GEN_TRACE);
+            return 1;
+        }
+        return 0;
+    }
+
     memsys = memsys_new();
-    for (unsigned int i = 0; i < NUM_CORES; i++)
+    if (SCHED_QUANTUM)
+    {
+        sched_init();
+    }
+    else
     {
-        core[i] = core_new(memsys, trace_filename[i], i);
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            core[i] = core_new(memsys, trace_filename[i], i);
+        }
+    }
+
+    if (INTERVAL_CYCLES || INTERVAL_INSTS)
+    {
+        interval_log = interval_new(INTERVAL_CSV, memsys,
+                                    SCHED_QUANTUM ? NUM_PROCS : NUM_CORES);
+        if (!interval_log)
+        {
+            fprintf(stderr, "Error: could not open %s\n", INTERVAL_CSV);
+            return 1;
+        }
+        next_interval_inst = INTERVAL_INSTS;
+    }
+
+    // The registry only points at the counters, so it costs nothing while
+    // nobody asks for the statistics.
+    register_stats();
+    if (LIVE_STATS && !stats_live_open(stats, LIVE_STATS))
+    {
+        fprintf(stderr, "Error: could not map %s\n", LIVE_STATS);
+        return 1;
+    }
+    signal(SIGUSR1, request_snapshot);
+
+    if (HOSTPROF)
+    {
+        hostprof = hostprof_new();
     }
 
     print_dots();
@@ -106,21 +407,55 @@ int main(int argc, char **argv)
     {
         all_cores_done = true;
 
-        for (unsigned int i = 0; i < NUM_CORES; i++)
+        if (SCHED_QUANTUM)
+        {
+            all_cores_done = sched_cycle();
+        }
+        else
         {
-            core_cycle(core[i]);
-            all_cores_done = all_cores_done && core[i]->done;
+            for (unsigned int i = 0; i < NUM_CORES; i++)
+            {
+                host_core_cycle(core[i]);
+                all_cores_done = all_cores_done && core[i]->done;
+            }
         }
 
         if (current_cycle - last_printdot_cycle >= DOT_INTERVAL)
         {
             print_dots();
+            if (stats->live)
+            {
+                stats_live_publish(stats, current_cycle, false);
+            }
+        }
+
+        if (snapshot_requested)
+        {
+            snapshot_requested = 0;
+            if (!stats_write_json(stats, SNAPSHOT_JSON))
+            {
+                fprintf(stderr, "Warning: could not write %s\n",
+                        SNAPSHOT_JSON);
+            }
         }
 
         current_cycle++;
+
+        if (interval_log)
+        {
+            interval_check(all_cores_done);
+        }
+    }
+
+    // Writes still waiting in the write-combining buffers go down now, so
+    // the write traffic and DRAM statistics include them.
+    for (unsigned int i = 0; i < NUM_CORES; i++)
+    {
+        memsys_flush_wcbuf(memsys, i);
     }
 
     print_stats();
+    write_stats();
     return 0;
 }
 
@@ -230,126 +565,1344 @@ int parse_args(int argc, char **argv)
                 L2CACHE_SIZE = atoi(argv[i]) * 1024;
             }
 
-            else if (strcasecmp(argv[i], "-L2repl") == 0)
+            else if (strcasecmp(argv[i], "-L1index") == 0 ||
+                     strcasecmp(argv[i], "-L2index") == 0)
             {
+                bool is_l1 = strcasecmp(argv[i], "-L1index") == 0;
                 if (++i >= argc)
                 {
-                    fprintf(stderr, "Error: missing argument to -L2repl\n");
+                    fprintf(stderr, "Error: missing argument to -%s\n",
+                            is_l1 ? "L1index" : "L2index");
                     return 2;
                 }
 
-                int l2repl = atoi(argv[i]);
-                if (l2repl < 0 || l2repl > 3)
+                int index_fn = atoi(argv[i]);
+                if (index_fn < INDEX_MODULO || index_fn > INDEX_SKEW)
                 {
-                    fprintf(stderr, "Error: L2repl must be between 0 and 3\n");
+                    fprintf(stderr, "Error: index function must be between "
+                                    "0 and 3\n");
                     return 2;
                 }
+                *(is_l1 ? &L1_INDEX_FN : &L2_INDEX_FN) =
+                    (IndexFunction)index_fn;
+            }
 
-                L2CACHE_REPL = (ReplacementPolicy)l2repl;
+            else if (strcasecmp(argv[i], "-pcprof") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -pcprof\n");
+                    return 2;
+                }
+                PCPROF_TOP_N = atoi(argv[i]);
             }
 
-            else if (strcasecmp(argv[i], "-SWP_core0ways") == 0)
+            else if (strcasecmp(argv[i], "-pcprof_csv") == 0)
             {
                 if (++i >= argc)
                 {
                     fprintf(stderr, "Error: missing argument to "
-                                    "-SWP_core0ways\n");
+                                    "-pcprof_csv\n");
                     return 2;
                 }
-                SWP_CORE0_WAYS = atoi(argv[i]);
+                PCPROF_CSV = argv[i];
             }
 
-            else if (strcasecmp(argv[i], "-dram_policy") == 0)
+            else if (strcasecmp(argv[i], "-interval_cycles") == 0)
             {
                 if (++i >= argc)
                 {
                     fprintf(stderr, "Error: missing argument to "
-                                    "-dram_policy\n");
+                                    "-interval_cycles\n");
                     return 2;
                 }
+                INTERVAL_CYCLES = atoi(argv[i]);
+            }
 
-                int dram_policy = atoi(argv[i]);
-                if (dram_policy < 0 || dram_policy > 1)
+            else if (strcasecmp(argv[i], "-interval_insts") == 0)
+            {
+                if (++i >= argc)
                 {
-                    fprintf(stderr, "Error: dram_policy must be between 0 and 1\n");
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-interval_insts\n");
                     return 2;
                 }
+                INTERVAL_INSTS = atoi(argv[i]);
+            }
 
-                DRAM_PAGE_POLICY = (DRAMPolicy)dram_policy;
+            else if (strcasecmp(argv[i], "-interval_csv") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-interval_csv\n");
+                    return 2;
+                }
+                INTERVAL_CSV = argv[i];
             }
 
-            else
+            else if (strcasecmp(argv[i], "-set_stats") == 0)
             {
-                fprintf(stderr, "Error: unrecognized option: %s\n", argv[i]);
-                return 2;
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -set_stats\n");
+                    return 2;
+                }
+                SET_STATS = atoi(argv[i]) != 0;
             }
-        }
-        else
-        {
-            // Parse trace file name.
-            if (NUM_CORES >= MAX_CORES)
+
+            else if (strcasecmp(argv[i], "-latency_hist") == 0)
             {
-                fprintf(stderr, "Error: too many trace files specified\n");
-                return 2;
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-latency_hist\n");
+                    return 2;
+                }
+                LATENCY_HIST = atoi(argv[i]) != 0;
             }
 
-            trace_filename[NUM_CORES] = argv[i];
-            NUM_CORES++;
-        }
-    }
+            else if (strcasecmp(argv[i], "-lifetime_stats") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-lifetime_stats\n");
+                    return 2;
+                }
+                LIFETIME_STATS = atoi(argv[i]);
+            }
 
-    if (NUM_CORES == 0)
-    {
-        fprintf(stderr, "Error: no trace file specified\n");
-        return 2;
-    }
+            else if (strcasecmp(argv[i], "-stats_json") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-stats_json\n");
+                    return 2;
+                }
+                STATS_JSON = argv[i];
+            }
 
-    return 0;
-}
+            else if (strcasecmp(argv[i], "-stats_csv") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-stats_csv\n");
+                    return 2;
+                }
+                STATS_CSV = argv[i];
+            }
 
-void print_dots()
-{
-    unsigned int LINE_INTERVAL = 50 * DOT_INTERVAL;
-    last_printdot_cycle = current_cycle;
+            else if (strcasecmp(argv[i], "-live_stats") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-live_stats\n");
+                    return 2;
+                }
+                LIVE_STATS = argv[i];
+            }
 
-    if (!PRINT_DOTS)
-    {
-        return;
-    }
+            else if (strcasecmp(argv[i], "-hostprof") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -hostprof\n");
+                    return 2;
+                }
+                HOSTPROF = atoi(argv[i]);
+            }
 
-    if (current_cycle % LINE_INTERVAL == 0)
-    {
-        if (current_cycle != 0)
-        {
-            printf("\n");
-        }
-        printf("%4llu M\t", (unsigned long long)current_cycle / 1000000);
-        fflush(stdout);
-    }
-    else
-    {
-        printf(".");
-        fflush(stdout);
-    }
-}
+            else if (strcasecmp(argv[i], "-bench") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -bench\n");
+                    return 2;
+                }
+                BENCH_BASELINE = argv[i];
+            }
 
-void print_stats()
-{
-    printf("\n\n");
-    printf("CYCLES              \t\t : %10llu\n",
+            else if (strcasecmp(argv[i], "-gen_trace") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -gen_trace\n");
+                    return 2;
+                }
+                GEN_TRACE = argv[i];
+            }
+
+            else if (strcasecmp(argv[i], "-snapshot_json") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-snapshot_json\n");
+                    return 2;
+                }
+                SNAPSHOT_JSON = argv[i];
+            }
+
+            else if (strcasecmp(argv[i], "-heatmap") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -heatmap\n");
+                    return 2;
+                }
+                HEATMAP_PREFIX = argv[i];
+            }
+
+            else if (strcasecmp(argv[i], "-L2lineB") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -L2lineB\n");
+                    return 2;
+                }
+                L2CACHE_LINESIZE = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-L2sectors") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -L2sectors\n");
+                    return 2;
+                }
+                L2CACHE_SECTORS = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-victim_entries") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-victim_entries\n");
+                    return 2;
+                }
+
+                int victim_entries = atoi(argv[i]);
+                if (victim_entries < 0 ||
+                    victim_entries > MAX_WAYS_PER_CACHE_SET)
+                {
+                    fprintf(stderr, "Error: victim_entries must be between 0 "
+                                    "and %d\n", MAX_WAYS_PER_CACHE_SET);
+                    return 2;
+                }
+
+                VICTIM_ENTRIES = victim_entries;
+            }
+
+            else if (strcasecmp(argv[i], "-L2inclusion") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L2inclusion\n");
+                    return 2;
+                }
+
+                int inclusion = atoi(argv[i]);
+                if (inclusion < NON_INCLUSIVE || inclusion > EXCLUSIVE)
+                {
+                    fprintf(stderr, "Error: L2inclusion must be between %d "
+                                    "and %d\n", NON_INCLUSIVE, EXCLUSIVE);
+                    return 2;
+                }
+
+                L2_INCLUSION = (InclusionPolicy)inclusion;
+            }
+
+            else if (strcasecmp(argv[i], "-hierarchy") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-hierarchy\n");
+                    return 2;
+                }
+                HIERARCHY_DESC = argv[i];
+            }
+
+            else if (strcasecmp(argv[i], "-Dwrite_through") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-Dwrite_through\n");
+                    return 2;
+                }
+                DCACHE_WRITE_THROUGH = atoi(argv[i]) != 0;
+            }
+
+            else if (strcasecmp(argv[i], "-Dwrite_alloc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-Dwrite_alloc\n");
+                    return 2;
+                }
+                DCACHE_WRITE_ALLOCATE = atoi(argv[i]) != 0;
+            }
+
+            else if (strcasecmp(argv[i], "-wc_entries") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-wc_entries\n");
+                    return 2;
+                }
+
+                int wc_entries = atoi(argv[i]);
+                if (wc_entries < 0 || wc_entries > MAX_WC_ENTRIES)
+                {
+                    fprintf(stderr, "Error: wc_entries must be between 0 and "
+                                    "%d\n", MAX_WC_ENTRIES);
+                    return 2;
+                }
+
+                WC_ENTRIES = wc_entries;
+            }
+
+            else if (strcasecmp(argv[i], "-L2write_back") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L2write_back\n");
+                    return 2;
+                }
+                L2_WRITE_BACK = atoi(argv[i]) != 0;
+            }
+
+            else if (strcasecmp(argv[i], "-L2write_alloc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L2write_alloc\n");
+                    return 2;
+                }
+                L2_WRITE_ALLOC = atoi(argv[i]) != 0;
+            }
+
+            else if (strcasecmp(argv[i], "-banks") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -banks\n");
+                    return 2;
+                }
+
+                int banks = atoi(argv[i]);
+                if (banks < 0 || banks > MAX_CACHE_BANKS)
+                {
+                    fprintf(stderr, "Error: banks must be between 0 and %d\n",
+                            MAX_CACHE_BANKS);
+                    return 2;
+                }
+
+                CACHE_BANKS = banks;
+            }
+
+            else if (strcasecmp(argv[i], "-bank_busy") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-bank_busy\n");
+                    return 2;
+                }
+                BANK_BUSY_CYCLES = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-nuca_hop") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -nuca_hop\n");
+                    return 2;
+                }
+                NUCA_HOP_LATENCY = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-L2repl") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -L2repl\n");
+                    return 2;
+                }
+
+                int l2repl = atoi(argv[i]);
+                if (l2repl < 0 || l2repl > 3)
+                {
+                    fprintf(stderr, "Error: L2repl must be between 0 and 3\n");
+                    return 2;
+                }
+
+                L2CACHE_REPL = (ReplacementPolicy)l2repl;
+            }
+
+            else if (strcasecmp(argv[i], "-SWP_core0ways") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-SWP_core0ways\n");
+                    return 2;
+                }
+                SWP_CORE0_WAYS = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-dram_policy") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-dram_policy\n");
+                    return 2;
+                }
+
+                int dram_policy = atoi(argv[i]);
+                if (dram_policy < 0 || dram_policy > 1)
+                {
+                    fprintf(stderr, "Error: dram_policy must be between 0 and 1\n");
+                    return 2;
+                }
+
+                DRAM_PAGE_POLICY = (DRAMPolicy)dram_policy;
+            }
+
+            else if (strcasecmp(argv[i], "-L1TLBentries") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L1TLBentries\n");
+                    return 2;
+                }
+                L1TLB_ENTRIES = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-L1TLBassoc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L1TLBassoc\n");
+                    return 2;
+                }
+                L1TLB_ASSOC = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-L2TLBentries") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L2TLBentries\n");
+                    return 2;
+                }
+                L2TLB_ENTRIES = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-L2TLBassoc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-L2TLBassoc\n");
+                    return 2;
+                }
+                L2TLB_ASSOC = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-pagesizeKB") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-pagesizeKB\n");
+                    return 2;
+                }
+
+                int pagesize = atoi(argv[i]);
+                if (pagesize != 4 && pagesize != 2048)
+                {
+                    fprintf(stderr, "Error: pagesizeKB must be 4 or 2048\n");
+                    return 2;
+                }
+
+                TLB_PAGE_SIZE = (uint64_t)pagesize * 1024;
+            }
+
+            else if (strcasecmp(argv[i], "-frame_alloc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-frame_alloc\n");
+                    return 2;
+                }
+
+                int frame_alloc = atoi(argv[i]);
+                if (frame_alloc < 0 || frame_alloc > 3)
+                {
+                    fprintf(stderr, "Error: frame_alloc must be between 0 and 3\n");
+                    return 2;
+                }
+
+                FRAME_ALLOC_POLICY = (FrameAllocPolicy)frame_alloc;
+            }
+
+            else if (strcasecmp(argv[i], "-color_core0") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-color_core0\n");
+                    return 2;
+                }
+                COLOR_CORE0 = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-DRAMcacheSizeMB") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-DRAMcacheSizeMB\n");
+                    return 2;
+                }
+                DRAMCACHE_SIZE = (uint64_t)atoi(argv[i]) * 1024 * 1024;
+            }
+
+            else if (strcasecmp(argv[i], "-DRAMcacheAssoc") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-DRAMcacheAssoc\n");
+                    return 2;
+                }
+                DRAMCACHE_ASSOC = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-DRAMcacheBlock") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-DRAMcacheBlock\n");
+                    return 2;
+                }
+                DRAMCACHE_BLOCKSIZE = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-farmem_latency") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-farmem_latency\n");
+                    return 2;
+                }
+                FARMEM_LATENCY = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-farmem_bw") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-farmem_bw\n");
+                    return 2;
+                }
+
+                int farmem_bw = atoi(argv[i]);
+                if (farmem_bw < 1)
+                {
+                    fprintf(stderr, "Error: farmem_bw must be at least 1\n");
+                    return 2;
+                }
+
+                FARMEM_BW = farmem_bw;
+            }
+
+            else if (strcasecmp(argv[i], "-core_model") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-core_model\n");
+                    return 2;
+                }
+
+                int core_model = atoi(argv[i]);
+                if (core_model < 0 || core_model > 1)
+                {
+                    fprintf(stderr, "Error: core_model must be between 0 and 1\n");
+                    return 2;
+                }
+
+                CORE_MODEL = (CoreModel)core_model;
+            }
+
+            else if (strcasecmp(argv[i], "-core_width") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-core_width\n");
+                    return 2;
+                }
+
+                int core_width = atoi(argv[i]);
+                if (core_width < 1)
+                {
+                    fprintf(stderr, "Error: core_width must be at least 1\n");
+                    return 2;
+                }
+
+                CORE_WIDTH = core_width;
+            }
+
+            else if (strcasecmp(argv[i], "-fetch_lines") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-fetch_lines\n");
+                    return 2;
+                }
+
+                int fetch_lines = atoi(argv[i]);
+                if (fetch_lines < 1)
+                {
+                    fprintf(stderr, "Error: fetch_lines must be at least 1\n");
+                    return 2;
+                }
+
+                FETCH_LINES = fetch_lines;
+            }
+
+            else if (strcasecmp(argv[i], "-load_ports") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-load_ports\n");
+                    return 2;
+                }
+
+                int load_ports = atoi(argv[i]);
+                if (load_ports < 1)
+                {
+                    fprintf(stderr, "Error: load_ports must be at least 1\n");
+                    return 2;
+                }
+
+                LOAD_PORTS = load_ports;
+            }
+
+            else if (strcasecmp(argv[i], "-store_ports") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-store_ports\n");
+                    return 2;
+                }
+
+                int store_ports = atoi(argv[i]);
+                if (store_ports < 1)
+                {
+                    fprintf(stderr, "Error: store_ports must be at least 1\n");
+                    return 2;
+                }
+
+                STORE_PORTS = store_ports;
+            }
+
+            else if (strcasecmp(argv[i], "-rob_size") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -rob_size\n");
+                    return 2;
+                }
+
+                int rob_size = atoi(argv[i]);
+                if (rob_size < 1)
+                {
+                    fprintf(stderr, "Error: rob_size must be at least 1\n");
+                    return 2;
+                }
+
+                ROB_SIZE = rob_size;
+            }
+
+            else if (strcasecmp(argv[i], "-lq_size") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -lq_size\n");
+                    return 2;
+                }
+
+                int lq_size = atoi(argv[i]);
+                if (lq_size < 1)
+                {
+                    fprintf(stderr, "Error: lq_size must be at least 1\n");
+                    return 2;
+                }
+
+                LQ_SIZE = lq_size;
+            }
+
+            else if (strcasecmp(argv[i], "-sq_size") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -sq_size\n");
+                    return 2;
+                }
+
+                int sq_size = atoi(argv[i]);
+                if (sq_size < 1)
+                {
+                    fprintf(stderr, "Error: sq_size must be at least 1\n");
+                    return 2;
+                }
+
+                SQ_SIZE = sq_size;
+            }
+
+            else if (strcasecmp(argv[i], "-sb_size") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to -sb_size\n");
+                    return 2;
+                }
+
+                int sb_size = atoi(argv[i]);
+                if (sb_size < 0)
+                {
+                    fprintf(stderr, "Error: sb_size must be at least 0\n");
+                    return 2;
+                }
+
+                SB_SIZE = sb_size;
+            }
+
+            else if (strcasecmp(argv[i], "-sched_quantum") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-sched_quantum\n");
+                    return 2;
+                }
+                SCHED_QUANTUM = atoi(argv[i]);
+            }
+
+            else if (strcasecmp(argv[i], "-sched_flush") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-sched_flush\n");
+                    return 2;
+                }
+                SCHED_FLUSH_L1 = atoi(argv[i]) != 0;
+            }
+
+            else if (strcasecmp(argv[i], "-coherence") == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Error: missing argument to "
+                                    "-coherence\n");
+                    return 2;
+                }
+                COHERENCE = atoi(argv[i]) != 0;
+            }
+
+            else
+            {
+                fprintf(stderr, "Error: unrecognized option: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else
+        {
+            // Parse trace file name.
+            if (NUM_PROCS >= MAX_PROCS)
+            {
+                fprintf(stderr, "Error: too many trace files specified\n");
+                return 2;
+            }
+
+            trace_filename[NUM_PROCS] = argv[i];
+            NUM_PROCS++;
+        }
+    }
+
+    if (NUM_PROCS == 0 && !BENCH_BASELINE)
+    {
+        fprintf(stderr, "Error: no trace file specified\n");
+        return 2;
+    }
+
+    // Check the generated traces here, since the cores only fork their
+    // generators once the simulation starts.
+    for (unsigned int p = 0; p < NUM_PROCS; p++)
+    {
+        TraceGenSpec spec;
+        if (strncmp(trace_filename[p], TRACEGEN_PREFIX,
+                    strlen(TRACEGEN_PREFIX)) == 0 &&
+            !tracegen_parse(trace_filename[p], &spec))
+        {
+            return 2;
+        }
+    }
+
+    if (GEN_TRACE && strncmp(trace_filename[0], TRACEGEN_PREFIX,
+                             strlen(TRACEGEN_PREFIX)) != 0)
+    {
+        fprintf(stderr, "Error: -gen_trace needs a generated trace "
+                        "(%s...)\n", TRACEGEN_PREFIX);
+        return 2;
+    }
+
+    if (SCHED_QUANTUM)
+    {
+        // The scheduler time-slices the traces over all cores of the
+        // multicore system.
+        if (SIM_MODE != SIM_MODE_DEF)
+        {
+            fprintf(stderr, "Error: -sched_quantum requires -mode 4\n");
+            return 2;
+        }
+        NUM_CORES = MAX_CORES;
+    }
+    else
+    {
+        if (NUM_PROCS > MAX_CORES)
+        {
+            fprintf(stderr, "Error: too many trace files specified "
+                            "(use -sched_quantum to time-slice them)\n");
+            return 2;
+        }
+        NUM_CORES = NUM_PROCS;
+    }
+
+    if (VICTIM_ENTRIES && SIM_MODE == SIM_MODE_A)
+    {
+        fprintf(stderr, "Error: victim caches need an L2 cache (mode 2 or "
+                        "higher)\n");
+        return 2;
+    }
+
+    if ((L2_INCLUSION != NON_INCLUSIVE || HIERARCHY_DESC || CACHE_BANKS) &&
+        SIM_MODE == SIM_MODE_A)
+    {
+        fprintf(stderr, "Error: L2 inclusion policies, hierarchies and banks "
+                        "need an L2 cache (mode 2 or higher)\n");
+        return 2;
+    }
+
+    if (FRAME_ALLOC_POLICY != FRAME_ALLOC_FIXED && SIM_MODE != SIM_MODE_DEF)
+    {
+        fprintf(stderr, "Error: frame allocators are only used in mode 4\n");
+        return 2;
+    }
+
+    bool write_policies = DCACHE_WRITE_THROUGH || !DCACHE_WRITE_ALLOCATE ||
+                          WC_ENTRIES || L2_WRITE_BACK >= 0 ||
+                          L2_WRITE_ALLOC >= 0;
+    if (write_policies && SIM_MODE == SIM_MODE_A)
+    {
+        fprintf(stderr, "Error: write policies need an L2 cache (mode 2 or "
+                        "higher)\n");
+        return 2;
+    }
+
+    if ((L2CACHE_LINESIZE || L2CACHE_SECTORS != 1) &&
+        SIM_MODE == SIM_MODE_A)
+    {
+        fprintf(stderr, "Error: L2 line sizes and sectors need an L2 cache "
+                        "(mode 2 or higher)\n");
+        return 2;
+    }
+
+    if (DCACHE_WRITE_THROUGH && L2_INCLUSION == EXCLUSIVE)
+    {
+        fprintf(stderr, "Error: a write-through dcache cannot sit above an "
+                        "exclusive L2\n");
+        return 2;
+    }
+
+    // Both L1s can hold a shared line, and a modified line is written back
+    // while its owner keeps it, so an exclusive L2 would not stay exclusive.
+    if (COHERENCE && L2_INCLUSION == EXCLUSIVE)
+    {
+        fprintf(stderr, "Error: coherence cannot be combined with an "
+                        "exclusive L2\n");
+        return 2;
+    }
+
+    if (COHERENCE && (DCACHE_WRITE_THROUGH || !DCACHE_WRITE_ALLOCATE))
+    {
+        fprintf(stderr, "Error: coherence needs write-back, write-allocate "
+                        "dcaches\n");
+        return 2;
+    }
+
+    if (COHERENCE && (SIM_MODE != SIM_MODE_DEF || VICTIM_ENTRIES))
+    {
+        fprintf(stderr, "Error: coherence is only modeled in mode 4, without "
+                        "victim caches\n");
+        return 2;
+    }
+
+    if (L1TLB_ENTRIES && SIM_MODE != SIM_MODE_DEF)
+    {
+        fprintf(stderr, "Error: TLBs are only modeled in mode 4\n");
+        return 2;
+    }
+
+    if (L1TLB_ENTRIES)
+    {
+        // The TLBs are caches of one-entry lines, indexed with the low bits
+        // of the page number, so each needs a power of two number of sets.
+        uint64_t entries[2] = {L1TLB_ENTRIES, L2TLB_ENTRIES};
+        uint64_t assocs[2] = {L1TLB_ASSOC, L2TLB_ASSOC};
+        for (unsigned int t = 0; t < 2; t++)
+        {
+            uint64_t nof_sets = 0;
+            if (assocs[t] >= 1 && assocs[t] <= MAX_WAYS_PER_CACHE_SET &&
+                entries[t] % assocs[t] == 0)
+            {
+                nof_sets = entries[t] / assocs[t];
+            }
+            if (nof_sets == 0 || (nof_sets & (nof_sets - 1)))
+            {
+                fprintf(stderr, "Error: TLB associativity must be 1 to %d, "
+                                "and the entries a power of two multiple of "
+                                "it\n", MAX_WAYS_PER_CACHE_SET);
+                return 2;
+            }
+        }
+    }
+
+    if (DRAMCACHE_SIZE && (DRAMCACHE_BLOCKSIZE < CACHE_LINESIZE ||
+                           DRAMCACHE_BLOCKSIZE % CACHE_LINESIZE != 0))
+    {
+        fprintf(stderr, "Error: DRAMcacheBlock must be a multiple of the "
+                        "line size\n");
+        return 2;
+    }
+
+    if (DRAMCACHE_SIZE && SIM_MODE == SIM_MODE_A)
+    {
+        fprintf(stderr, "Error: a DRAM cache needs DRAM (mode 2 or "
+                        "higher)\n");
+        return 2;
+    }
+
+    if (DRAMCACHE_SIZE)
+    {
+        // The tag array indexes its sets with the low bits of the block
+        // address, so a set count that is not a power of two would leave
+        // part of the capacity unused.
+        uint64_t nof_sets = 0;
+        if (DRAMCACHE_ASSOC >= 1 && DRAMCACHE_ASSOC <= MAX_WAYS_PER_CACHE_SET)
+        {
+            nof_sets = DRAMCACHE_SIZE / DRAMCACHE_BLOCKSIZE / DRAMCACHE_ASSOC;
+        }
+        if (nof_sets == 0 || (nof_sets & (nof_sets - 1)) ||
+            nof_sets * DRAMCACHE_ASSOC * DRAMCACHE_BLOCKSIZE != DRAMCACHE_SIZE)
+        {
+            fprintf(stderr, "Error: DRAMcacheAssoc must be 1 to %d, and the "
+                            "DRAM cache must have a power of two number of "
+                            "sets of DRAMcacheAssoc blocks\n",
+                    MAX_WAYS_PER_CACHE_SET);
+            return 2;
+        }
+    }
+
+    if (INTERVAL_CYCLES && INTERVAL_INSTS)
+    {
+        fprintf(stderr, "Error: -interval_cycles and -interval_insts are "
+                        "mutually exclusive\n");
+        return 2;
+    }
+
+    return 0;
+}
+
+unsigned long long interval_stream_insts(unsigned long long *insts)
+{
+    unsigned long long total = 0;
+
+    for (unsigned int i = 0; i < (SCHED_QUANTUM ? NUM_PROCS : NUM_CORES); i++)
+    {
+        insts[i] = SCHED_QUANTUM ? proc[i].core->inst_count
+                                 : core[i]->inst_count;
+        total += insts[i];
+    }
+
+    return total;
+}
+
+void interval_check(bool is_last)
+{
+    unsigned long long insts[MAX_PROCS];
+    bool is_due = is_last;
+
+    if (INTERVAL_CYCLES)
+    {
+        is_due = is_due || current_cycle % INTERVAL_CYCLES == 0;
+    }
+    else
+    {
+        unsigned long long total = interval_stream_insts(insts);
+        while (total >= next_interval_inst)
+        {
+            is_due = true;
+            next_interval_inst += INTERVAL_INSTS;
+        }
+    }
+
+    if (!is_due)
+    {
+        return;
+    }
+
+    interval_stream_insts(insts);
+    interval_sample(interval_log, memsys, insts);
+    if (is_last)
+    {
+        interval_close(interval_log);
+        interval_log = NULL;
+    }
+}
+
+void print_dots()
+{
+    unsigned int LINE_INTERVAL = 50 * DOT_INTERVAL;
+    last_printdot_cycle = current_cycle;
+
+    if (!PRINT_DOTS)
+    {
+        return;
+    }
+
+    // The status line replaces a whole line of dots.
+    if (hostprof)
+    {
+        if (current_cycle % LINE_INTERVAL == 0 && current_cycle != 0)
+        {
+            unsigned long long insts[MAX_PROCS];
+            hostprof_print_status(hostprof, current_cycle,
+                                  interval_stream_insts(insts));
+        }
+        return;
+    }
+
+    if (current_cycle % LINE_INTERVAL == 0)
+    {
+        if (current_cycle != 0)
+        {
+            printf("\n");
+        }
+        printf("%4llu M\t", (unsigned long long)current_cycle / 1000000);
+        fflush(stdout);
+    }
+    else
+    {
+        printf(".");
+        fflush(stdout);
+    }
+}
+
+// Simulate one cycle of the core, timing it in the host profile if enabled.
+void host_core_cycle(Core *core)
+{
+    uint64_t host_start =
+        hostprof ? hostprof_begin(hostprof, HOST_STAGE_CORE) : 0;
+
+    core_cycle(core);
+
+    if (host_start)
+    {
+        hostprof_end(hostprof, HOST_STAGE_CORE, host_start);
+    }
+}
+
+// Create one process per trace and start the first NUM_CORES of them.
+void sched_init()
+{
+    for (unsigned int p = 0; p < NUM_PROCS; p++)
+    {
+        proc[p].core = core_new(memsys, trace_filename[p], 0);
+        proc[p].pid = p;
+    }
+
+    for (unsigned int c = 0; c < NUM_CORES; c++)
+    {
+        last_pid[c] = c;
+        Process *p = sched_pick();
+        if (p)
+        {
+            sched_switch_in(c, p);
+        }
+    }
+}
+
+// Simulate one cycle of every core under the scheduler: run the process on
+// each core, replace processes that finish, and rotate processes round-robin
+// when the quantum expires. Return whether all processes are done.
+bool sched_cycle()
+{
+    for (unsigned int c = 0; c < NUM_CORES; c++)
+    {
+        Process *p = running_proc[c];
+        if (!p)
+        {
+            continue;
+        }
+
+        unsigned long long inst_before = p->core->inst_count;
+        host_core_cycle(p->core);
+        unsigned long long insts = p->core->inst_count - inst_before;
+
+        p->stat_run_cycles++;
+        if (inst_before < p->warmup_end_inst)
+        {
+            p->stat_warmup_cycles++;
+            p->stat_warmup_insts += insts;
+        }
+        else
+        {
+            p->stat_steady_cycles++;
+            p->stat_steady_insts += insts;
+        }
+
+        if (p->core->done)
+        {
+            p->running = false;
+            running_proc[c] = NULL;
+            Process *next = sched_pick();
+            if (next)
+            {
+                sched_switch_in(c, next);
+            }
+        }
+    }
+
+    if ((current_cycle + 1) % SCHED_QUANTUM == 0)
+    {
+        for (unsigned int c = 0; c < NUM_CORES; c++)
+        {
+            Process *next = sched_pick();
+            if (!next)
+            {
+                break;
+            }
+            if (running_proc[c])
+            {
+                running_proc[c]->running = false;
+            }
+            sched_switch_in(c, next);
+        }
+    }
+
+    for (unsigned int p = 0; p < NUM_PROCS; p++)
+    {
+        if (!proc[p].core->done)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Return the next ready process in round-robin order, or NULL if every
+// process is either running or done.
+Process *sched_pick()
+{
+    for (unsigned int i = 0; i < NUM_PROCS; i++)
+    {
+        unsigned int pid = (sched_next_pid + i) % NUM_PROCS;
+        if (!proc[pid].running && !proc[pid].core->done)
+        {
+            sched_next_pid = (pid + 1) % NUM_PROCS;
+            return &proc[pid];
+        }
+    }
+    return NULL;
+}
+
+// Run process p on the given core from the next cycle on. Its pages are
+// translated in its own address space, and every switch after its first
+// start opens a new warmup window.
+void sched_switch_in(unsigned int core_id, Process *p)
+{
+    if (SCHED_FLUSH_L1 && last_pid[core_id] != p->pid)
+    {
+        memsys_flush_l1(memsys, core_id);
+    }
+
+    if (p->stat_run_cycles)
+    {
+        p->stat_switches++;
+        p->warmup_end_inst = p->core->inst_count + SCHED_WARMUP_INSTS;
+    }
+
+    p->running = true;
+    p->core->core_id = core_id;
+    memsys->asid_coreid[core_id] = COHERENCE ? 0 : p->pid;
+    running_proc[core_id] = p;
+    last_pid[core_id] = p->pid;
+}
+
+void sched_print_stats()
+{
+    for (unsigned int i = 0; i < NUM_PROCS; i++)
+    {
+        Process *p = &proc[i];
+        double ipc = 0.0;
+        double warmup_cpi = 0.0;
+        double steady_cpi = 0.0;
+
+        if (p->stat_run_cycles)
+        {
+            ipc = (double)(p->core->done_inst_count) /
+                  (double)(p->stat_run_cycles);
+        }
+        if (p->stat_warmup_insts)
+        {
+            warmup_cpi = (double)(p->stat_warmup_cycles) /
+                         (double)(p->stat_warmup_insts);
+        }
+        if (p->stat_steady_insts)
+        {
+            steady_cpi = (double)(p->stat_steady_cycles) /
+                         (double)(p->stat_steady_insts);
+        }
+
+        printf("\n");
+        printf("PROC_%01d_INST         \t\t : %10llu\n", p->pid,
+               p->core->done_inst_count);
+        printf("PROC_%01d_RUN_CYCLES   \t\t : %10llu\n", p->pid,
+               p->stat_run_cycles);
+        printf("PROC_%01d_DONE_CYCLE   \t\t : %10llu\n", p->pid,
+               p->core->done_cycle_count);
+        printf("PROC_%01d_IPC          \t\t : %10.3f\n", p->pid, ipc);
+        printf("PROC_%01d_SWITCHES     \t\t : %10llu\n", p->pid,
+               p->stat_switches);
+        printf("PROC_%01d_WARMUP_CPI   \t\t : %10.3f\n", p->pid,
+               warmup_cpi);
+        printf("PROC_%01d_STEADY_CPI   \t\t : %10.3f\n", p->pid,
+               steady_cpi);
+
+        core_close_trace(p->core);
+    }
+}
+
+void register_stats()
+{
+    char group[16];
+
+    stats = stats_new();
+    stats_add_u64(stats, "sim", "cycles", &current_cycle);
+
+    if (SCHED_QUANTUM)
+    {
+        for (unsigned int p = 0; p < NUM_PROCS; p++)
+        {
+            snprintf(group, sizeof(group), "proc%d", p);
+            core_register_stats(proc[p].core, stats, group,
+                                &proc[p].stat_run_cycles);
+        }
+    }
+    else
+    {
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            snprintf(group, sizeof(group), "core%d", i);
+            core_register_stats(core[i], stats, group, NULL);
+        }
+    }
+
+    memsys_register_stats(memsys, stats);
+}
+
+void write_stats()
+{
+    if (stats->live)
+    {
+        stats_live_publish(stats, current_cycle, true);
+    }
+    if (STATS_JSON && !stats_write_json(stats, STATS_JSON))
+    {
+        fprintf(stderr, "Warning: could not write %s\n", STATS_JSON);
+    }
+    if (STATS_CSV && !stats_write_csv(stats, STATS_CSV))
+    {
+        fprintf(stderr, "Warning: could not write %s\n", STATS_CSV);
+    }
+}
+
+void request_snapshot(int signum)
+{
+    // Only set a flag: the main loop writes the snapshot between cycles,
+    // when the counters are consistent.
+    (void)signum;
+    snapshot_requested = 1;
+}
+
+void print_stats()
+{
+    printf("\n\n");
+    printf("CYCLES              \t\t : %10llu\n",
            (unsigned long long)current_cycle);
 
-    for (unsigned int i = 0; i < NUM_CORES; i++)
+    if (SCHED_QUANTUM)
+    {
+        sched_print_stats();
+    }
+    else
     {
-        core_print_stats(core[i]);
+        for (unsigned int i = 0; i < NUM_CORES; i++)
+        {
+            core_print_stats(core[i]);
+        }
     }
 
     memsys_print_stats(memsys);
+
+    if (hostprof)
+    {
+        unsigned long long insts[MAX_PROCS];
+        hostprof_print_stats(hostprof, interval_stream_insts(insts));
+    }
 }
 
 void print_usage(const char *program_name)
 {
-    fprintf(stderr, "Usage: %s [-option <value>] trace_0 <trace_1>\n",
+    fprintf(stderr, "Usage: %s [-option <value>] trace_0 <trace_1 ...>\n",
             program_name);
     fprintf(stderr, "\n");
     fprintf(stderr, "Trace driven memory system simulator\n");
@@ -372,6 +1925,119 @@ void print_usage(const char *program_name)
     fprintf(stderr, "    -L2sizeKB <num>         Set capacity in KB of the "
                     "unified L2 cache\n");
     fprintf(stderr, "                            (default: 512 KB)\n");
+    fprintf(stderr, "    -L1index <num>          Set the set index function "
+                    "of the L1 caches\n");
+    fprintf(stderr, "                            [0: modulo, 1: XOR-folded, "
+                    "2: prime-modulo,\n");
+    fprintf(stderr, "                            3: skewed] (default: 0)\n");
+    fprintf(stderr, "    -L2index <num>          Set the set index function "
+                    "of the L2 and lower\n");
+    fprintf(stderr, "                            levels (same values, "
+                    "default: 0)\n");
+    fprintf(stderr, "    -set_stats <num>        Print the per-set access and "
+                    "miss distribution\n");
+    fprintf(stderr, "                            of each cache [0: no, 1: yes] "
+                    "(default: 0)\n");
+    fprintf(stderr, "    -latency_hist <num>     Print latency percentiles "
+                    "per access type,\n");
+    fprintf(stderr, "                            cache level and DRAM [0: no, "
+                    "1: yes] (default: 0)\n");
+    fprintf(stderr, "    -lifetime_stats <num>   Print hits per evicted line, "
+                    "dead time and reuse\n");
+    fprintf(stderr, "                            distances, tracking 1 in "
+                    "<num> lines (default: 0, off)\n");
+    fprintf(stderr, "    -stats_json <file>      Also write the statistics "
+                    "as JSON\n");
+    fprintf(stderr, "    -stats_csv <file>       Also write the statistics "
+                    "as name,value CSV\n");
+    fprintf(stderr, "    -live_stats <file>      Keep the statistics in a "
+                    "shared mapped file\n");
+    fprintf(stderr, "                            (e.g., /dev/shm/sim), "
+                    "updated every %d cycles\n", DOT_INTERVAL);
+    fprintf(stderr, "    -hostprof <num>         Report simulation speed "
+                    "and host time by stage,\n");
+    fprintf(stderr, "                            with a status line on "
+                    "stderr (default: 0, off)\n");
+    fprintf(stderr, "    -bench <file>           Run the microbenchmarks "
+                    "instead of traces and\n");
+    fprintf(stderr, "                            compare them with the "
+                    "baseline in <file>, or\n");
+    fprintf(stderr, "                            record it there if it "
+                    "does not exist\n");
+    fprintf(stderr, "    -snapshot_json <file>   Set the file the statistics "
+                    "are written to on\n");
+    fprintf(stderr, "                            SIGUSR1 (default: "
+                    "snapshot.json)\n");
+    fprintf(stderr, "    -heatmap <prefix>       Write per-set and per-bank "
+                    "counters to\n");
+    fprintf(stderr, "                            <prefix>_<cache>.csv and "
+                    "<prefix>_DRAM.csv\n");
+    fprintf(stderr, "    -pcprof <num>           Report the instructions "
+                    "with the most memory\n");
+    fprintf(stderr, "                            delay, with their misses "
+                    "(default: 0, off)\n");
+    fprintf(stderr, "    -pcprof_csv <file>      Write the full per-instruction "
+                    "profile as CSV\n");
+    fprintf(stderr, "    -interval_cycles <num>  Write interval statistics "
+                    "every this many cycles\n");
+    fprintf(stderr, "    -interval_insts <num>   Write interval statistics "
+                    "every this many\n");
+    fprintf(stderr, "                            instructions (default: 0, "
+                    "off)\n");
+    fprintf(stderr, "    -interval_csv <file>    Set the interval statistics "
+                    "file\n");
+    fprintf(stderr, "                            (default: intervals.csv)\n");
+    fprintf(stderr, "    -L2lineB <num>          Set line size in bytes of the "
+                    "L2 cache\n");
+    fprintf(stderr, "                            (default: the L1 line "
+                    "size)\n");
+    fprintf(stderr, "    -L2sectors <num>        Split each L2 line into this "
+                    "many sectors\n");
+    fprintf(stderr, "                            (default: 1, not sectored)\n");
+    fprintf(stderr, "    -victim_entries <num>   Add a victim cache of this many "
+                    "lines to each L1\n");
+    fprintf(stderr, "                            (default: 0, disabled)\n");
+    fprintf(stderr, "    -L2inclusion <num>      Set L2 inclusion policy [0: "
+                    "non-inclusive,\n");
+    fprintf(stderr, "                            1: inclusive, 2: exclusive] "
+                    "(default: 0)\n");
+    fprintf(stderr, "    -hierarchy <desc>       Replace the L2 with cache "
+                    "levels, e.g.\n");
+    fprintf(stderr, "                            L2:256:8:12:p:0,"
+                    "L3:8192:16:40:s:1\n");
+    fprintf(stderr, "                            (name:sizeKB:assoc:latency:"
+                    "private|shared:incl\n");
+    fprintf(stderr, "                            [:write_back:write_alloc"
+                    "[:lineB:sectors]])\n");
+    fprintf(stderr, "    -Dwrite_through <num>   Write dcache stores through "
+                    "to the next level\n");
+    fprintf(stderr, "                            [0: write-back, 1: "
+                    "write-through] (default: 0)\n");
+    fprintf(stderr, "    -Dwrite_alloc <num>     Allocate dcache lines on "
+                    "store misses\n");
+    fprintf(stderr, "                            [0: no-write-allocate, 1: "
+                    "write-allocate] (default: 1)\n");
+    fprintf(stderr, "    -wc_entries <num>       Add a write-combining buffer "
+                    "of this many lines\n");
+    fprintf(stderr, "                            below each dcache (default: "
+                    "0, disabled)\n");
+    fprintf(stderr, "    -L2write_back <num>     Absorb writes that hit in the "
+                    "L2 [0: no, 1: yes]\n");
+    fprintf(stderr, "                            (default: 1 if inclusive, "
+                    "otherwise 0)\n");
+    fprintf(stderr, "    -L2write_alloc <num>    Allocate L2 lines on write "
+                    "misses [0: no, 1: yes]\n");
+    fprintf(stderr, "                            (default: 0)\n");
+    fprintf(stderr, "    -banks <num>            Split each shared cache level "
+                    "into banks\n");
+    fprintf(stderr, "                            (default: 0, no bank "
+                    "conflicts)\n");
+    fprintf(stderr, "    -bank_busy <num>        Set cycles a bank is busy per "
+                    "access (default: 2)\n");
+    fprintf(stderr, "    -nuca_hop <num>         Set extra cycles per bank "
+                    "between core and bank\n");
+    fprintf(stderr, "                            (default: 0, uniform "
+                    "latency)\n");
     fprintf(stderr, "    -L2repl <num>           Set replacement policy for "
                     "L2 cache [0: LRU,\n");
     fprintf(stderr, "                            1: random, 2: SWP, 3: DWP] "
@@ -381,4 +2047,97 @@ void print_usage(const char *program_name)
     fprintf(stderr, "    -dram_policy <num>      Set DRAM page policy "
                     "[0: open-page, 1: close-page]\n");
     fprintf(stderr, "                            (default: 0)\n");
+    fprintf(stderr, "    -L1TLBentries <num>     Enable per-core L1 I/D TLBs "
+                    "with this many entries\n");
+    fprintf(stderr, "                            (mode 4 only, default: 0, "
+                    "disabled)\n");
+    fprintf(stderr, "    -L1TLBassoc <num>       Set associativity of the L1 "
+                    "TLBs (default: 4)\n");
+    fprintf(stderr, "    -L2TLBentries <num>     Set entries of the shared L2 "
+                    "TLB (default: 1024)\n");
+    fprintf(stderr, "    -L2TLBassoc <num>       Set associativity of the L2 "
+                    "TLB (default: 8)\n");
+    fprintf(stderr, "    -pagesizeKB <num>       Set page size used by the "
+                    "TLBs [4, 2048]\n");
+    fprintf(stderr, "                            (default: 4)\n");
+    fprintf(stderr, "    -frame_alloc <num>      Set physical frame allocator "
+                    "[0: fixed, 1: random,\n");
+    fprintf(stderr, "                            2: first-touch, 3: page "
+                    "coloring] (mode 4 only,\n");
+    fprintf(stderr, "                            default: 0)\n");
+    fprintf(stderr, "    -color_core0 <num>      Set shared cache page colors for "
+                    "core 0 with page\n");
+    fprintf(stderr, "                            coloring\n");
+    fprintf(stderr, "                            (default: half)\n");
+    fprintf(stderr, "    -DRAMcacheSizeMB <num>  Use DRAM as a cache of this "
+                    "capacity in MB in front\n");
+    fprintf(stderr, "                            of a far-memory tier "
+                    "(default: 0, disabled)\n");
+    fprintf(stderr, "    -DRAMcacheAssoc <num>   Set associativity of the "
+                    "DRAM cache (default: 4)\n");
+    fprintf(stderr, "    -DRAMcacheBlock <num>   Set migration granularity "
+                    "in bytes between DRAM\n");
+    fprintf(stderr, "                            and far memory "
+                    "(default: 4096)\n");
+    fprintf(stderr, "    -farmem_latency <num>   Set far-memory access "
+                    "latency in cycles\n");
+    fprintf(stderr, "                            (default: 300)\n");
+    fprintf(stderr, "    -farmem_bw <num>        Set far-memory bandwidth in "
+                    "bytes per cycle\n");
+    fprintf(stderr, "                            (default: 16)\n");
+    fprintf(stderr, "    -core_model <num>       Set core timing model "
+                    "[0: in-order, 1: out-of-order]\n");
+    fprintf(stderr, "                            (default: 0)\n");
+    fprintf(stderr, "    -core_width <num>       Set fetch/issue/retire width "
+                    "of each core\n");
+    fprintf(stderr, "                            (default: 1)\n");
+    fprintf(stderr, "    -fetch_lines <num>      Set icache lines fetched per "
+                    "cycle (default: 1)\n");
+    fprintf(stderr, "    -load_ports <num>       Set loads issued per cycle "
+                    "(default: 2)\n");
+    fprintf(stderr, "    -store_ports <num>      Set stores issued per cycle "
+                    "(default: 1)\n");
+    fprintf(stderr, "    -rob_size <num>         Set ROB entries of an "
+                    "out-of-order core\n");
+    fprintf(stderr, "                            (default: 128)\n");
+    fprintf(stderr, "    -lq_size <num>          Set load queue entries of an "
+                    "out-of-order core\n");
+    fprintf(stderr, "                            (default: 32)\n");
+    fprintf(stderr, "    -sq_size <num>          Set store queue entries of an "
+                    "out-of-order core\n");
+    fprintf(stderr, "                            (default: 32)\n");
+    fprintf(stderr, "    -sb_size <num>          Set store buffer entries per "
+                    "core (default: 0,\n");
+    fprintf(stderr, "                            disabled)\n");
+    fprintf(stderr, "    -sched_quantum <num>    Time-slice up to %d traces over "
+                    "the cores with this\n", MAX_PROCS);
+    fprintf(stderr, "                            quantum in cycles (mode 4 "
+                    "only, default: 0,\n");
+    fprintf(stderr, "                            disabled)\n");
+    fprintf(stderr, "    -sched_flush <num>      Flush the private L1s on a "
+                    "context switch\n");
+    fprintf(stderr, "                            [0: keep, 1: flush] "
+                    "(default: 0)\n");
+    fprintf(stderr, "    -coherence <num>        Share one address space "
+                    "between the traces and\n");
+    fprintf(stderr, "                            keep the L1 dcaches coherent "
+                    "with MESI [0: off, 1: on]\n");
+    fprintf(stderr, "    -gen_trace <file>       Write the first trace to a "
+                    "gzip-compressed trace\n");
+    fprintf(stderr, "                            file instead of simulating "
+                    "it\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "A trace may also be generated: gen:<pattern>"
+                    "[,<key>=<value>]...\n");
+    fprintf(stderr, "    patterns: seq, stride, random, chase (pointer "
+                    "chasing), zipf\n");
+    fprintf(stderr, "    keys: insts (default: 1M), footprint (data bytes, "
+                    "default: 1M),\n");
+    fprintf(stderr, "          stride (default: 64), alpha (zipf skew, "
+                    "default: 0.99),\n");
+    fprintf(stderr, "          code (instruction loop bytes, default: 4K), "
+                    "loads (%% of insts,\n");
+    fprintf(stderr, "          default: 25), stores (default: 10), seed "
+                    "(default: 1)\n");
+    fprintf(stderr, "    e.g., gen:zipf,footprint=4M,alpha=0.8,loads=30\n");
 }
@@ -0,0 +1,506 @@
+// stats.cpp
+// Defines the functions used to implement the statistics registry.
+
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The initial number of entries in the registry. */
+#define STATS_INITIAL_CAPACITY 256
+
+/** The maximum nesting depth of the groups in a name. */
+#define STATS_MAX_DEPTH 16
+
+/** The values a histogram is written out as, and their percentiles. */
+#define STATS_NOF_HIST_VALUES 7
+static const char *STATS_HIST_VALUES[STATS_NOF_HIST_VALUES] = {
+    "count", "avg", "p50", "p90", "p99", "p999", "max"};
+static const double STATS_HIST_PERCENTILES[STATS_NOF_HIST_VALUES] = {
+    0.0, 0.0, 50.0, 90.0, 99.0, 99.9, 0.0};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty registry.
+ *
+ * @return A pointer to the registry.
+ */
+StatsRegistry *stats_new()
+{
+    StatsRegistry *reg = (StatsRegistry *)calloc(1, sizeof(StatsRegistry));
+    reg->capacity = STATS_INITIAL_CAPACITY;
+    reg->entries = (StatEntry *)calloc(reg->capacity, sizeof(StatEntry));
+    return reg;
+}
+
+/**
+ * Append an entry with the given name to the registry, growing it if needed.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the entry belongs to.
+ * @param name The name of the entry within its group.
+ * @param kind The kind of the entry.
+ * @return The index of the entry.
+ */
+unsigned int stats_add(StatsRegistry *reg, const char *group,
+                       const char *name, StatKind kind)
+{
+    if (reg->count == reg->capacity)
+    {
+        reg->capacity *= 2;
+        reg->entries = (StatEntry *)realloc(
+            reg->entries, reg->capacity * sizeof(StatEntry));
+    }
+
+    StatEntry *e = &reg->entries[reg->count];
+    size_t len = strlen(group) + strlen(name) + 2;
+
+    memset(e, 0, sizeof(StatEntry));
+    e->name = (char *)malloc(len);
+    snprintf(e->name, len, "%s.%s", group, name);
+    e->kind = kind;
+
+    return reg->count++;
+}
+
+/**
+ * Register a counter.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the counter belongs to.
+ * @param name The name of the counter within its group.
+ * @param counter The counter.
+ * @return The index of the counter, for use in ratios.
+ */
+unsigned int stats_add_ull(StatsRegistry *reg, const char *group,
+                           const char *name,
+                           const unsigned long long *counter)
+{
+    unsigned int i = stats_add(reg, group, name, STAT_COUNTER_ULL);
+    reg->entries[i].ptr = counter;
+    return i;
+}
+
+unsigned int stats_add_u64(StatsRegistry *reg, const char *group,
+                           const char *name, const uint64_t *counter)
+{
+    unsigned int i = stats_add(reg, group, name, STAT_COUNTER_U64);
+    reg->entries[i].ptr = counter;
+    return i;
+}
+
+/**
+ * Register a ratio of two registered statistics (0 when the denominator is
+ * 0), such as an average delay or a miss percentage.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the ratio belongs to.
+ * @param name The name of the ratio within its group.
+ * @param num The index of the numerator.
+ * @param den The index of the denominator.
+ * @param scale The factor to multiply the ratio by (e.g., 100 for a
+ *              percentage).
+ * @return The index of the ratio.
+ */
+unsigned int stats_add_ratio(StatsRegistry *reg, const char *group,
+                             const char *name, unsigned int num,
+                             unsigned int den, double scale)
+{
+    unsigned int i = stats_add(reg, group, name, STAT_RATIO);
+    reg->entries[i].num = num;
+    reg->entries[i].den = den;
+    reg->entries[i].scale = scale;
+    return i;
+}
+
+/**
+ * Register a histogram. It is written out as its count, average, p50, p90,
+ * p99, p99.9 and maximum.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the histogram belongs to.
+ * @param name The name of the histogram within its group.
+ * @param h The histogram.
+ * @return The index of the histogram.
+ */
+unsigned int stats_add_hist(StatsRegistry *reg, const char *group,
+                            const char *name, const LatencyHist *h)
+{
+    unsigned int i = stats_add(reg, group, name, STAT_HIST);
+    reg->entries[i].ptr = h;
+    return i;
+}
+
+/**
+ * Get the current value of a counter or ratio.
+ *
+ * @param reg The registry.
+ * @param i The index of the counter or ratio.
+ * @return Its value.
+ */
+double stats_value(StatsRegistry *reg, unsigned int i)
+{
+    StatEntry *e = &reg->entries[i];
+
+    if (e->kind == STAT_COUNTER_ULL)
+    {
+        return (double)*(const unsigned long long *)e->ptr;
+    }
+    if (e->kind == STAT_COUNTER_U64)
+    {
+        return (double)*(const uint64_t *)e->ptr;
+    }
+    if (e->kind == STAT_RATIO)
+    {
+        double den = stats_value(reg, e->den);
+        return den ? e->scale * stats_value(reg, e->num) / den : 0.0;
+    }
+    return 0.0;
+}
+
+/**
+ * Write the value of a counter or ratio. Counters are written as integers,
+ * so they survive the trip through a double exactly in the text.
+ *
+ * @param f The file to write to.
+ * @param reg The registry.
+ * @param i The index of the counter or ratio.
+ */
+void stats_write_value(FILE *f, StatsRegistry *reg, unsigned int i)
+{
+    StatEntry *e = &reg->entries[i];
+
+    if (e->kind == STAT_COUNTER_ULL)
+    {
+        fprintf(f, "%llu", *(const unsigned long long *)e->ptr);
+    }
+    else if (e->kind == STAT_COUNTER_U64)
+    {
+        fprintf(f, "%llu", (unsigned long long)*(const uint64_t *)e->ptr);
+    }
+    else
+    {
+        fprintf(f, "%.6f", stats_value(reg, i));
+    }
+}
+
+/**
+ * Get one of the values a histogram is written out as.
+ *
+ * @param h The histogram.
+ * @param v The index of the value in STATS_HIST_VALUES.
+ * @return The value.
+ */
+double stats_hist_value(const LatencyHist *h, unsigned int v)
+{
+    if (v == 0)
+    {
+        return (double)h->count;
+    }
+    if (v == 1)
+    {
+        return h->count ? (double)h->sum / h->count : 0.0;
+    }
+    if (v == STATS_NOF_HIST_VALUES - 1)
+    {
+        return (double)h->max;
+    }
+    return (double)latency_hist_percentile(h, STATS_HIST_PERCENTILES[v]);
+}
+
+/**
+ * Write one of the values a histogram is written out as.
+ *
+ * @param f The file to write to.
+ * @param h The histogram.
+ * @param v The index of the value in STATS_HIST_VALUES.
+ */
+void stats_write_hist_value(FILE *f, const LatencyHist *h, unsigned int v)
+{
+    if (v == 0)
+    {
+        fprintf(f, "%llu", h->count);
+    }
+    else if (v == 1)
+    {
+        fprintf(f, "%.6f", h->count ? (double)h->sum / h->count : 0.0);
+    }
+    else if (v == STATS_NOF_HIST_VALUES - 1)
+    {
+        fprintf(f, "%llu", (unsigned long long)h->max);
+    }
+    else
+    {
+        fprintf(f, "%llu", (unsigned long long)latency_hist_percentile(
+                               h, STATS_HIST_PERCENTILES[v]));
+    }
+}
+
+/** The registry whose entry indices stats_compare() sorts. */
+StatsRegistry *stats_sort_reg;
+
+/**
+ * Order entries by name, so the entries of each group are contiguous. Used
+ * with qsort() on an array of entry indices.
+ */
+int stats_compare(const void *a, const void *b)
+{
+    return strcmp(stats_sort_reg->entries[*(const unsigned int *)a].name,
+                  stats_sort_reg->entries[*(const unsigned int *)b].name);
+}
+
+/**
+ * Write every statistic to a JSON file, as nested objects following the
+ * groups in the names.
+ *
+ * @param reg The registry.
+ * @param path The path of the JSON file.
+ * @return Whether the file was written.
+ */
+bool stats_write_json(StatsRegistry *reg, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+
+    unsigned int *order = (unsigned int *)calloc(reg->count + 1,
+                                                 sizeof(unsigned int));
+    for (unsigned int i = 0; i < reg->count; i++)
+    {
+        order[i] = i;
+    }
+    stats_sort_reg = reg;
+    qsort(order, reg->count, sizeof(unsigned int), stats_compare);
+
+    // The groups currently open, as pointers into the previous name and
+    // their lengths, so the next name only opens the groups that differ.
+    const char *open[STATS_MAX_DEPTH];
+    size_t open_len[STATS_MAX_DEPTH];
+    unsigned int depth = 0;
+    bool first = true;
+
+    fprintf(f, "{");
+    for (unsigned int k = 0; k < reg->count; k++)
+    {
+        StatEntry *e = &reg->entries[order[k]];
+        const char *groups[STATS_MAX_DEPTH];
+        size_t group_len[STATS_MAX_DEPTH];
+        unsigned int nof_groups = 0;
+        const char *leaf = e->name;
+
+        for (const char *dot = strchr(leaf, '.');
+             dot && nof_groups < STATS_MAX_DEPTH; dot = strchr(leaf, '.'))
+        {
+            groups[nof_groups] = leaf;
+            group_len[nof_groups++] = dot - leaf;
+            leaf = dot + 1;
+        }
+
+        unsigned int common = 0;
+        while (common < depth && common < nof_groups &&
+               open_len[common] == group_len[common] &&
+               !strncmp(open[common], groups[common], group_len[common]))
+        {
+            common++;
+        }
+
+        for (; depth > common; depth--)
+        {
+            fprintf(f, "\n%*s}", 2 * depth, "");
+            first = false;
+        }
+        for (; depth < nof_groups; depth++)
+        {
+            fprintf(f, "%s\n%*s\"%.*s\": {", first ? "" : ",",
+                    2 * (depth + 1), "", (int)group_len[depth],
+                    groups[depth]);
+            open[depth] = groups[depth];
+            open_len[depth] = group_len[depth];
+            first = true;
+        }
+
+        fprintf(f, "%s\n%*s\"%s\": ", first ? "" : ",", 2 * (depth + 1), "",
+                leaf);
+        first = false;
+
+        if (e->kind == STAT_HIST)
+        {
+            fprintf(f, "{");
+            for (unsigned int v = 0; v < STATS_NOF_HIST_VALUES; v++)
+            {
+                fprintf(f, "%s\"%s\": ", v ? ", " : "", STATS_HIST_VALUES[v]);
+                stats_write_hist_value(f, (const LatencyHist *)e->ptr, v);
+            }
+            fprintf(f, "}");
+        }
+        else
+        {
+            stats_write_value(f, reg, order[k]);
+        }
+    }
+
+    for (; depth > 0; depth--)
+    {
+        fprintf(f, "\n%*s}", 2 * depth, "");
+    }
+    fprintf(f, "\n}\n");
+
+    free(order);
+    fclose(f);
+    return true;
+}
+
+/**
+ * Write every statistic to a CSV file with one name,value row per value.
+ * Histograms take one row for each of their values (e.g., name.p99).
+ *
+ * @param reg The registry.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool stats_write_csv(StatsRegistry *reg, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+
+    fprintf(f, "name,value\n");
+    for (unsigned int i = 0; i < reg->count; i++)
+    {
+        StatEntry *e = &reg->entries[i];
+
+        if (e->kind == STAT_HIST)
+        {
+            for (unsigned int v = 0; v < STATS_NOF_HIST_VALUES; v++)
+            {
+                fprintf(f, "%s.%s,", e->name, STATS_HIST_VALUES[v]);
+                stats_write_hist_value(f, (const LatencyHist *)e->ptr, v);
+                fprintf(f, "\n");
+            }
+        }
+        else
+        {
+            fprintf(f, "%s,", e->name);
+            stats_write_value(f, reg, i);
+            fprintf(f, "\n");
+        }
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * Create a file that holds a live copy of every statistic and map it into
+ * memory, so a monitor can map the same file (e.g., one in /dev/shm) and
+ * read the statistics while the simulation runs. The values are only
+ * updated by stats_live_publish().
+ *
+ * @param reg The registry. No statistics may be added after this call.
+ * @param path The path of the file.
+ * @return Whether the file was created and mapped.
+ */
+bool stats_live_open(StatsRegistry *reg, const char *path)
+{
+    uint32_t nof_values = 0;
+
+    for (unsigned int i = 0; i < reg->count; i++)
+    {
+        nof_values += (reg->entries[i].kind == STAT_HIST)
+                      ? STATS_NOF_HIST_VALUES : 1;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    size_t size = sizeof(StatsLiveHeader) +
+                  nof_values * sizeof(StatsLiveValue);
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    reg->live = (StatsLiveHeader *)map;
+    reg->live_size = size;
+
+    StatsLiveValue *values = (StatsLiveValue *)(reg->live + 1);
+    uint32_t n = 0;
+    for (unsigned int i = 0; i < reg->count; i++)
+    {
+        StatEntry *e = &reg->entries[i];
+        if (e->kind != STAT_HIST)
+        {
+            snprintf(values[n++].name, sizeof(values->name), "%s", e->name);
+            continue;
+        }
+        for (unsigned int v = 0; v < STATS_NOF_HIST_VALUES; v++)
+        {
+            snprintf(values[n++].name, sizeof(values->name), "%s.%s",
+                     e->name, STATS_HIST_VALUES[v]);
+        }
+    }
+
+    reg->live->nof_values = nof_values;
+    memcpy(reg->live->magic, STATS_LIVE_MAGIC, sizeof(reg->live->magic));
+    return true;
+}
+
+/**
+ * Copy the current value of every statistic into the live statistics file.
+ *
+ * @param reg The registry, with a live statistics file open.
+ * @param cycle The current clock cycle number.
+ * @param done Whether the simulation has finished.
+ */
+void stats_live_publish(StatsRegistry *reg, uint64_t cycle, bool done)
+{
+    StatsLiveHeader *live = reg->live;
+    StatsLiveValue *values = (StatsLiveValue *)(live + 1);
+    uint32_t n = 0;
+
+    live->seq++;
+    __sync_synchronize();
+
+    for (unsigned int i = 0; i < reg->count; i++)
+    {
+        StatEntry *e = &reg->entries[i];
+        if (e->kind != STAT_HIST)
+        {
+            values[n++].value = stats_value(reg, i);
+            continue;
+        }
+        for (unsigned int v = 0; v < STATS_NOF_HIST_VALUES; v++)
+        {
+            values[n++].value = stats_hist_value((const LatencyHist *)e->ptr,
+                                                 v);
+        }
+    }
+    live->cycle = cycle;
+    live->done = done;
+
+    __sync_synchronize();
+    live->seq++;
+}
@@ -0,0 +1,191 @@
+// stats.h
+// Contains declarations of data structures and functions used to implement a
+// registry of named statistics that can be written out as JSON or CSV, for
+// tools that would otherwise have to scrape the text output.
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "types.h"
+#include "latency.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The magic bytes at the start of a live statistics file. */
+#define STATS_LIVE_MAGIC "SIMSTAT1"
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The kinds of statistics in the registry. */
+typedef enum StatKindEnum
+{
+    STAT_COUNTER_ULL = 0, // An unsigned long long counter.
+    STAT_COUNTER_U64 = 1, // A uint64_t counter.
+    STAT_RATIO = 2,       // The ratio of two other statistics, times a scale.
+    STAT_HIST = 3,        // A LatencyHist.
+} StatKind;
+
+/**
+ * A named statistic. The registry only points at the counters, which stay
+ * where the modules keep and update them, so registering a counter adds no
+ * cost to updating it. Ratios and histogram percentiles are computed when
+ * the registry is written out.
+ */
+typedef struct StatEntry
+{
+    /**
+     * The full name of the statistic: dot-separated groups followed by the
+     * name within the innermost group (e.g., memsys.l2cache.read_miss).
+     */
+    char *name;
+
+    StatKind kind;
+
+    /** The counter or histogram, if this is not a ratio. */
+    const void *ptr;
+
+    /** The indices of the numerator and denominator of a ratio. */
+    unsigned int num;
+    unsigned int den;
+    double scale;
+} StatEntry;
+
+/**
+ * The header of a live statistics file, which is followed by nof_values
+ * StatsLiveValue records. The writer makes seq odd while it updates the
+ * values and even again when it is done, so a reader that sees an odd seq,
+ * or a different seq after reading the values, has to read them again.
+ */
+typedef struct StatsLiveHeader
+{
+    char magic[8];
+    uint32_t nof_values;
+    uint32_t done;
+    volatile uint64_t seq;
+    uint64_t cycle;
+} StatsLiveHeader;
+
+/**
+ * One value in a live statistics file. Histograms take one record for each
+ * of their values, named as in the CSV output (e.g., name.p99).
+ */
+typedef struct StatsLiveValue
+{
+    char name[56];
+    double value;
+} StatsLiveValue;
+
+/** A growable array of statistics, in registration order. */
+typedef struct StatsRegistry
+{
+    StatEntry *entries;
+    unsigned int count;
+    unsigned int capacity;
+
+    /** The mapped live statistics file, or NULL if there is none. */
+    StatsLiveHeader *live;
+    uint64_t live_size;
+} StatsRegistry;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize an empty registry.
+ *
+ * @return A pointer to the registry.
+ */
+StatsRegistry *stats_new();
+
+/**
+ * Register a counter.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the counter belongs to.
+ * @param name The name of the counter within its group.
+ * @param counter The counter.
+ * @return The index of the counter, for use in ratios.
+ */
+unsigned int stats_add_ull(StatsRegistry *reg, const char *group,
+                           const char *name,
+                           const unsigned long long *counter);
+unsigned int stats_add_u64(StatsRegistry *reg, const char *group,
+                           const char *name, const uint64_t *counter);
+
+/**
+ * Register a ratio of two registered statistics (0 when the denominator is
+ * 0), such as an average delay or a miss percentage.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the ratio belongs to.
+ * @param name The name of the ratio within its group.
+ * @param num The index of the numerator.
+ * @param den The index of the denominator.
+ * @param scale The factor to multiply the ratio by (e.g., 100 for a
+ *              percentage).
+ * @return The index of the ratio.
+ */
+unsigned int stats_add_ratio(StatsRegistry *reg, const char *group,
+                             const char *name, unsigned int num,
+                             unsigned int den, double scale);
+
+/**
+ * Register a histogram. It is written out as its count, average, p50, p90,
+ * p99, p99.9 and maximum.
+ *
+ * @param reg The registry.
+ * @param group The dot-separated groups the histogram belongs to.
+ * @param name The name of the histogram within its group.
+ * @param h The histogram.
+ * @return The index of the histogram.
+ */
+unsigned int stats_add_hist(StatsRegistry *reg, const char *group,
+                            const char *name, const LatencyHist *h);
+
+/**
+ * Write every statistic to a JSON file, as nested objects following the
+ * groups in the names.
+ *
+ * @param reg The registry.
+ * @param path The path of the JSON file.
+ * @return Whether the file was written.
+ */
+bool stats_write_json(StatsRegistry *reg, const char *path);
+
+/**
+ * Write every statistic to a CSV file with one name,value row per value.
+ * Histograms take one row for each of their values (e.g., name.p99).
+ *
+ * @param reg The registry.
+ * @param path The path of the CSV file.
+ * @return Whether the file was written.
+ */
+bool stats_write_csv(StatsRegistry *reg, const char *path);
+
+/**
+ * Create a file that holds a live copy of every statistic and map it into
+ * memory, so a monitor can map the same file (e.g., one in /dev/shm) and
+ * read the statistics while the simulation runs. The values are only
+ * updated by stats_live_publish().
+ *
+ * @param reg The registry. No statistics may be added after this call.
+ * @param path The path of the file.
+ * @return Whether the file was created and mapped.
+ */
+bool stats_live_open(StatsRegistry *reg, const char *path);
+
+/**
+ * Copy the current value of every statistic into the live statistics file.
+ *
+ * @param reg The registry, with a live statistics file open.
+ * @param cycle The current clock cycle number.
+ * @param done Whether the simulation has finished.
+ */
+void stats_live_publish(StatsRegistry *reg, uint64_t cycle, bool done);
+
+#endif // __STATS_H__
@@ -0,0 +1,164 @@
+// storebuf.cpp
+// Defines the functions used to implement the per-core store buffer.
+
+#include "storebuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                    EXTERNALLY DEFINED GLOBAL VARIABLES                    //
+///////////////////////////////////////////////////////////////////////////////
+
+/** The number of bytes in a cache line. */
+extern uint64_t CACHE_LINESIZE;
+
+/** The current clock cycle number. */
+extern uint64_t current_cycle;
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a store buffer.
+ *
+ * @param size The number of entries in the store buffer.
+ * @return A pointer to the store buffer.
+ */
+StoreBuffer *storebuf_new(unsigned int size)
+{
+    StoreBuffer *sb = (StoreBuffer *)calloc(1, sizeof(StoreBuffer));
+    sb->addrs = (uint64_t *)calloc(size, sizeof(uint64_t));
+    sb->size = size;
+    return sb;
+}
+
+/**
+ * Find the buffered store covering the same cache line as the given address.
+ *
+ * @param sb The store buffer to search.
+ * @param addr The byte address to look for.
+ * @return Whether such a store is buffered.
+ */
+bool storebuf_lookup(StoreBuffer *sb, uint64_t addr)
+{
+    uint64_t line_addr = addr / CACHE_LINESIZE;
+
+    for (unsigned int i = 0; i < sb->count; i++)
+    {
+        if (sb->addrs[(sb->head + i) % sb->size] / CACHE_LINESIZE == line_addr)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Insert a store into the store buffer, coalescing it with a buffered store
+ * to the same cache line if there is one.
+ *
+ * If the store cannot be coalesced and the buffer is full, nothing is
+ * inserted and a full stall is counted; the caller must retry the store on a
+ * later cycle.
+ *
+ * @param sb The store buffer to insert into.
+ * @param addr The byte address of the store.
+ * @return Whether the store was accepted.
+ */
+bool storebuf_insert(StoreBuffer *sb, uint64_t addr)
+{
+    if (storebuf_lookup(sb, addr))
+    {
+        sb->stat_stores++;
+        sb->stat_coalesced++;
+        return true;
+    }
+
+    if (sb->count == sb->size)
+    {
+        sb->stat_full_stalls++;
+        return false;
+    }
+
+    sb->addrs[(sb->head + sb->count) % sb->size] = addr;
+    sb->count++;
+    sb->stat_stores++;
+    return true;
+}
+
+/**
+ * Check whether a load can be forwarded from the store buffer, i.e., whether
+ * a buffered store covers the same cache line. Also update the statistics
+ * accordingly.
+ *
+ * @param sb The store buffer to search.
+ * @param addr The byte address of the load.
+ * @return Whether the load was forwarded.
+ */
+bool storebuf_forward(StoreBuffer *sb, uint64_t addr)
+{
+    if (storebuf_lookup(sb, addr))
+    {
+        sb->stat_forwards++;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Drain the oldest buffered store to the memory system if the dcache is free
+ * this cycle. This should be called once per cycle.
+ *
+ * @param sb The store buffer to drain.
+ * @param memsys The memory system to write to.
+ * @param core_id The CPU core ID that owns the store buffer.
+ */
+void storebuf_drain(StoreBuffer *sb, MemorySystem *memsys,
+                    unsigned int core_id)
+{
+    if (sb->count == 0 || current_cycle < sb->drain_busy_until)
+    {
+        return;
+    }
+
+    // The drained store no longer knows its instruction, so the profiler
+    // charges it to the store buffer.
+    uint64_t inst_addr = memsys->inst_addr_coreid[core_id];
+    memsys->inst_addr_coreid[core_id] = PCPROF_STORE_BUFFER;
+    uint64_t delay = memsys_access(memsys, sb->addrs[sb->head],
+                                   ACCESS_TYPE_STORE, core_id);
+    memsys->inst_addr_coreid[core_id] = inst_addr;
+    sb->drain_busy_until = current_cycle + delay;
+    sb->head = (sb->head + 1) % sb->size;
+    sb->count--;
+}
+
+/**
+ * Print the statistics of the store buffer.
+ *
+ * @param sb The store buffer to print the statistics of.
+ * @param core_id The CPU core ID that owns the store buffer.
+ */
+void storebuf_print_stats(StoreBuffer *sb, unsigned int core_id)
+{
+    double coalesce_percent = 0.0;
+    if (sb->stat_stores)
+    {
+        coalesce_percent = 100.0 * (double)(sb->stat_coalesced) /
+                           (double)(sb->stat_stores);
+    }
+
+    printf("CORE_%01d_SB_STORES    \t\t : %10llu\n", core_id,
+           sb->stat_stores);
+    printf("CORE_%01d_SB_COALESCED \t\t : %10llu\n", core_id,
+           sb->stat_coalesced);
+    printf("CORE_%01d_SB_COALESCE_PERC\t\t : %10.3f\n", core_id,
+           coalesce_percent);
+    printf("CORE_%01d_SB_FULL_STALLS\t\t : %10llu\n", core_id,
+           sb->stat_full_stalls);
+    printf("CORE_%01d_SB_FORWARDS  \t\t : %10llu\n", core_id,
+           sb->stat_forwards);
+}
@@ -0,0 +1,101 @@
+// storebuf.h
+// Contains declarations of data structures and functions used to implement a
+// per-core store buffer. Stores enter the buffer when they retire and drain
+// to the dcache in the background, off the critical path of the core.
+
+#ifndef __STOREBUF_H__
+#define __STOREBUF_H__
+
+#include "types.h"
+#include "memsys.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** A FIFO store buffer that coalesces stores to the same cache line. */
+typedef struct StoreBuffer
+{
+    /**
+     * The byte addresses of the buffered stores, kept as a circular buffer of
+     * `size` entries. Each entry covers a whole cache line.
+     */
+    uint64_t *addrs;
+
+    unsigned int size;
+    unsigned int head;
+    unsigned int count;
+
+    /** The cycle at which the dcache can accept the next drained store. */
+    uint64_t drain_busy_until;
+
+    /** The total number of stores that entered the buffer. */
+    unsigned long long stat_stores;
+
+    /** The number of stores merged into an entry for the same line. */
+    unsigned long long stat_coalesced;
+
+    /** The number of cycles the core stalled because the buffer was full. */
+    unsigned long long stat_full_stalls;
+
+    /** The number of loads serviced from the buffer. */
+    unsigned long long stat_forwards;
+} StoreBuffer;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and initialize a store buffer.
+ *
+ * @param size The number of entries in the store buffer.
+ * @return A pointer to the store buffer.
+ */
+StoreBuffer *storebuf_new(unsigned int size);
+
+/**
+ * Insert a store into the store buffer, coalescing it with a buffered store
+ * to the same cache line if there is one.
+ *
+ * If the store cannot be coalesced and the buffer is full, nothing is
+ * inserted and a full stall is counted; the caller must retry the store on a
+ * later cycle.
+ *
+ * @param sb The store buffer to insert into.
+ * @param addr The byte address of the store.
+ * @return Whether the store was accepted.
+ */
+bool storebuf_insert(StoreBuffer *sb, uint64_t addr);
+
+/**
+ * Check whether a load can be forwarded from the store buffer, i.e., whether
+ * a buffered store covers the same cache line. Also update the statistics
+ * accordingly.
+ *
+ * @param sb The store buffer to search.
+ * @param addr The byte address of the load.
+ * @return Whether the load was forwarded.
+ */
+bool storebuf_forward(StoreBuffer *sb, uint64_t addr);
+
+/**
+ * Drain the oldest buffered store to the memory system if the dcache is free
+ * this cycle. This should be called once per cycle.
+ *
+ * @param sb The store buffer to drain.
+ * @param memsys The memory system to write to.
+ * @param core_id The CPU core ID that owns the store buffer.
+ */
+void storebuf_drain(StoreBuffer *sb, MemorySystem *memsys,
+                    unsigned int core_id);
+
+/**
+ * Print the statistics of the store buffer.
+ *
+ * @param sb The store buffer to print the statistics of.
+ * @param core_id The CPU core ID that owns the store buffer.
+ */
+void storebuf_print_stats(StoreBuffer *sb, unsigned int core_id);
+
+#endif // __STOREBUF_H__
@@ -0,0 +1,446 @@
+// tracegen.cpp
+// Defines the functions used to generate synthetic traces.
+
+#include "tracegen.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//                           FUNCTION DEFINITIONS                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Parse a size with an optional K, M or G suffix.
+ *
+ * @param text The text to parse.
+ * @param value The size to fill in.
+ * @return Whether the text is a valid size.
+ */
+bool tracegen_parse_size(const char *text, uint64_t *value)
+{
+    char *end;
+
+    if (*text < '0' || *text > '9')
+    {
+        return false;
+    }
+
+    *value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k')
+    {
+        *value <<= 10;
+        end++;
+    }
+    else if (*end == 'M' || *end == 'm')
+    {
+        *value <<= 20;
+        end++;
+    }
+    else if (*end == 'G' || *end == 'g')
+    {
+        *value <<= 30;
+        end++;
+    }
+
+    return *end == '\0';
+}
+
+/**
+ * Parse a generator specification of the form
+ * "gen:<pattern>[,<key>=<value>]...", where the pattern is seq, stride,
+ * random, chase or zipf, and the keys are insts, footprint, stride, alpha,
+ * code, loads, stores and seed. Sizes may carry a K, M or G suffix.
+ *
+ * Print an error message if the specification is invalid.
+ *
+ * @param text The specification.
+ * @param spec The parameters to fill in; keys that are not given keep their
+ *             defaults.
+ * @return Whether the specification is valid.
+ */
+bool tracegen_parse(const char *text, TraceGenSpec *spec)
+{
+    const char *pattern_names[5] = {"seq", "stride", "random", "chase",
+                                    "zipf"};
+    char buf[256];
+    bool valid = true;
+
+    spec->nof_insts = 1000000;
+    spec->footprint = 1 << 20;
+    spec->stride = 64;
+    spec->alpha = 0.99;
+    spec->code_footprint = 4 << 10;
+    spec->load_perc = 25;
+    spec->store_perc = 10;
+    spec->seed = 1;
+
+    if (strncmp(text, TRACEGEN_PREFIX, strlen(TRACEGEN_PREFIX)) != 0 ||
+        strlen(text) >= sizeof(buf))
+    {
+        fprintf(stderr, "Error: invalid trace generator %s\n", text);
+        return false;
+    }
+    strcpy(buf, text + strlen(TRACEGEN_PREFIX));
+
+    char *token = strtok(buf, ",");
+    unsigned int p = 0;
+    while (token && p < 5 && strcasecmp(token, pattern_names[p]) != 0)
+    {
+        p++;
+    }
+    if (!token || p == 5)
+    {
+        fprintf(stderr, "Error: unknown trace pattern in %s (seq, stride, "
+                        "random, chase or zipf)\n", text);
+        return false;
+    }
+    spec->pattern = (TraceGenPattern)p;
+
+    while ((token = strtok(NULL, ",")) != NULL && valid)
+    {
+        char *value = strchr(token, '=');
+        uint64_t size = 0;
+
+        if (!value)
+        {
+            valid = false;
+            break;
+        }
+        *value++ = '\0';
+
+        if (strcasecmp(token, "alpha") == 0)
+        {
+            char *end;
+            spec->alpha = strtod(value, &end);
+            valid = *end == '\0' && spec->alpha > 0;
+            continue;
+        }
+
+        valid = tracegen_parse_size(value, &size);
+        if (strcasecmp(token, "insts") == 0)
+        {
+            spec->nof_insts = size;
+        }
+        else if (strcasecmp(token, "footprint") == 0)
+        {
+            spec->footprint = size;
+        }
+        else if (strcasecmp(token, "stride") == 0)
+        {
+            spec->stride = size;
+        }
+        else if (strcasecmp(token, "code") == 0)
+        {
+            spec->code_footprint = size;
+        }
+        else if (strcasecmp(token, "loads") == 0)
+        {
+            spec->load_perc = size;
+        }
+        else if (strcasecmp(token, "stores") == 0)
+        {
+            spec->store_perc = size;
+        }
+        else if (strcasecmp(token, "seed") == 0)
+        {
+            spec->seed = size;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid)
+    {
+        fprintf(stderr, "Error: invalid key or value in %s\n", text);
+        return false;
+    }
+
+    if (spec->footprint < TRACEGEN_NODE_SIZE ||
+        spec->footprint > TRACEGEN_MAX_FOOTPRINT ||
+        spec->code_footprint < 4 ||
+        spec->code_footprint > TRACEGEN_DATA_BASE - TRACEGEN_CODE_BASE ||
+        spec->stride == 0 || spec->load_perc + spec->store_perc > 100)
+    {
+        fprintf(stderr, "Error: out of range parameter in %s\n", text);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Draw the next number of the xorshift64 generator.
+ *
+ * @param gen The trace generator.
+ * @return A pseudo-random 64-bit number.
+ */
+uint64_t tracegen_rand(TraceGen *gen)
+{
+    gen->rng ^= gen->rng << 13;
+    gen->rng ^= gen->rng >> 7;
+    gen->rng ^= gen->rng << 17;
+    return gen->rng;
+}
+
+/**
+ * Allocate and initialize a trace generator.
+ *
+ * @param spec The parameters of the trace.
+ * @return A pointer to the trace generator.
+ */
+TraceGen *tracegen_new(const TraceGenSpec *spec)
+{
+    TraceGen *gen = (TraceGen *)calloc(1, sizeof(TraceGen));
+
+    gen->spec = *spec;
+    // xorshift64 must not start at 0.
+    gen->rng = spec->seed * 0x9E3779B97F4A7C15ULL + 1;
+    gen->nof_nodes = spec->footprint / TRACEGEN_NODE_SIZE;
+
+    if (spec->pattern == TRACEGEN_CHASE)
+    {
+        // Sattolo's algorithm turns the identity into a single cycle.
+        gen->next_node = (uint32_t *)calloc(gen->nof_nodes, sizeof(uint32_t));
+        for (uint64_t i = 0; i < gen->nof_nodes; i++)
+        {
+            gen->next_node[i] = i;
+        }
+        for (uint64_t i = gen->nof_nodes - 1; i > 0; i--)
+        {
+            uint64_t j = tracegen_rand(gen) % i;
+            uint32_t tmp = gen->next_node[i];
+            gen->next_node[i] = gen->next_node[j];
+            gen->next_node[j] = tmp;
+        }
+    }
+
+    if (spec->pattern == TRACEGEN_ZIPF)
+    {
+        double sum = 0.0;
+        gen->zipf_cdf = (double *)calloc(gen->nof_nodes, sizeof(double));
+        for (uint64_t i = 0; i < gen->nof_nodes; i++)
+        {
+            sum += 1.0 / pow(i + 1, spec->alpha);
+            gen->zipf_cdf[i] = sum;
+        }
+        for (uint64_t i = 0; i < gen->nof_nodes; i++)
+        {
+            gen->zipf_cdf[i] /= sum;
+        }
+    }
+
+    #ifdef DEBUG
+        printf("Creating trace generator (pattern: %d, insts: %lu, footprint: %lu)\n", spec->pattern, spec->nof_insts, spec->footprint);
+    #endif
+
+    return gen;
+}
+
+/**
+ * Get the offset into the data region of the next memory access.
+ *
+ * @param gen The trace generator.
+ * @return The offset in bytes.
+ */
+uint64_t tracegen_data_offset(TraceGen *gen)
+{
+    const TraceGenSpec *spec = &gen->spec;
+    uint64_t offset = 0;
+
+    switch (spec->pattern)
+    {
+    case TRACEGEN_SEQ:
+        offset = (gen->access_count * 4) % spec->footprint;
+        break;
+
+    case TRACEGEN_STRIDE:
+        offset = (gen->access_count * spec->stride) % spec->footprint;
+        break;
+
+    case TRACEGEN_RANDOM:
+        offset = (tracegen_rand(gen) % (spec->footprint / 4)) * 4;
+        break;
+
+    case TRACEGEN_CHASE:
+        offset = gen->node * TRACEGEN_NODE_SIZE;
+        gen->node = gen->next_node[gen->node];
+        break;
+
+    case TRACEGEN_ZIPF:
+    {
+        // Find the first rank whose cumulative probability reaches u.
+        double u = (tracegen_rand(gen) >> 11) * (1.0 / (1ULL << 53));
+        uint64_t lo = 0;
+        uint64_t hi = gen->nof_nodes - 1;
+        while (lo < hi)
+        {
+            uint64_t mid = (lo + hi) / 2;
+            if (gen->zipf_cdf[mid] < u)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        offset = lo * TRACEGEN_NODE_SIZE;
+        break;
+    }
+    }
+
+    gen->access_count++;
+    return offset;
+}
+
+/**
+ * Generate the next trace record.
+ *
+ * @param gen The trace generator.
+ * @param inst_addr The instruction address to fill in.
+ * @param inst_type The instruction type to fill in.
+ * @param ldst_addr The load/store address to fill in (0 for ALU
+ *                  instructions).
+ * @return Whether a record was generated, i.e., the trace is not over.
+ */
+bool tracegen_next(TraceGen *gen, uint32_t *inst_addr, uint8_t *inst_type,
+                   uint32_t *ldst_addr)
+{
+    const TraceGenSpec *spec = &gen->spec;
+
+    if (gen->inst_count >= spec->nof_insts)
+    {
+        return false;
+    }
+
+    *inst_addr = TRACEGEN_CODE_BASE +
+                 (gen->inst_count * 4) % spec->code_footprint;
+    gen->inst_count++;
+
+    unsigned int r = tracegen_rand(gen) % 100;
+    if (r < spec->load_perc)
+    {
+        *inst_type = INST_TYPE_LOAD;
+    }
+    else if (r < spec->load_perc + spec->store_perc)
+    {
+        *inst_type = INST_TYPE_STORE;
+    }
+    else
+    {
+        *inst_type = INST_TYPE_ALU;
+        *ldst_addr = 0;
+        return true;
+    }
+
+    *ldst_addr = TRACEGEN_DATA_BASE + tracegen_data_offset(gen);
+    return true;
+}
+
+/**
+ * Write the whole trace in the binary trace record format.
+ *
+ * @param gen The trace generator.
+ * @param fd The file descriptor to write to.
+ * @return Whether all records were written.
+ */
+bool tracegen_write(TraceGen *gen, int fd)
+{
+    // Each record is the instruction address, the instruction type and the
+    // load/store address, packed without padding.
+    uint8_t buf[4096 * 9];
+    uint32_t inst_addr;
+    uint8_t inst_type;
+    uint32_t ldst_addr;
+    bool more = true;
+
+    while (more)
+    {
+        size_t size = 0;
+        while (size < sizeof(buf) &&
+               (more = tracegen_next(gen, &inst_addr, &inst_type,
+                                     &ldst_addr)))
+        {
+            memcpy(buf + size, &inst_addr, sizeof(inst_addr));
+            memcpy(buf + size + 4, &inst_type, sizeof(inst_type));
+            memcpy(buf + size + 5, &ldst_addr, sizeof(ldst_addr));
+            size += 9;
+        }
+
+        for (size_t done = 0; done < size;)
+        {
+            ssize_t written = write(fd, buf + done, size - done);
+            if (written <= 0)
+            {
+                return false;
+            }
+            done += written;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Write the whole trace to a gzip-compressed trace file, which the
+ * simulator can read like any other trace.
+ *
+ * @param gen The trace generator.
+ * @param path The path of the trace file.
+ * @return Whether the file was written.
+ */
+bool tracegen_write_file(TraceGen *gen, const char *path)
+{
+    int pipefd[2];
+    int status;
+
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+    {
+        return false;
+    }
+
+    if (pipe(pipefd) != 0)
+    {
+        close(out);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(out);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        // Child process: exec gzip from the pipe into the file.
+        dup2(pipefd[0], STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(out);
+        execlp("gzip", "gzip", "-c", NULL);
+        perror("Couldn't exec gzip");
+        _exit(127);
+    }
+
+    close(pipefd[0]);
+    close(out);
+    bool written = tracegen_write(gen, pipefd[1]);
+    close(pipefd[1]);
+    waitpid(pid, &status, 0);
+
+    return written && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,182 @@
+// tracegen.h
+// Contains declarations of data structures and functions used to generate
+// synthetic traces: small, reproducible workloads with parameterized access
+// patterns, whose miss rates can be derived analytically to validate cache
+// policies.
+
+#ifndef __TRACEGEN_H__
+#define __TRACEGEN_H__
+
+#include "types.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 CONSTANTS                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Trace file names starting with this prefix are generator specifications,
+ * e.g., "gen:zipf,footprint=4M,alpha=0.9,loads=30".
+ */
+#define TRACEGEN_PREFIX "gen:"
+
+/** The address at which the generated instruction loop starts. */
+#define TRACEGEN_CODE_BASE 0x00400000
+
+/** The address at which the generated data accesses start. */
+#define TRACEGEN_DATA_BASE 0x10000000
+
+/**
+ * The largest data footprint in bytes. Trace addresses are 32 bits wide, and
+ * the data region starts at TRACEGEN_DATA_BASE.
+ */
+#define TRACEGEN_MAX_FOOTPRINT (1ULL << 30)
+
+/** The size of a pointer chasing node, in bytes. */
+#define TRACEGEN_NODE_SIZE 64
+
+///////////////////////////////////////////////////////////////////////////////
+//                              DATA STRUCTURES                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/** Possible data access patterns of a generated trace. */
+typedef enum TraceGenPatternEnum
+{
+    /** Consecutive 4-byte words, wrapping around at the footprint. */
+    TRACEGEN_SEQ = 0,
+
+    /** Addresses stride bytes apart, wrapping around at the footprint. */
+    TRACEGEN_STRIDE = 1,
+
+    /** Uniformly random 4-byte words within the footprint. */
+    TRACEGEN_RANDOM = 2,
+
+    /**
+     * A walk along a single random cycle through all nodes of the footprint,
+     * so each node is visited once per lap, as in a linked list traversal.
+     */
+    TRACEGEN_CHASE = 3,
+
+    /**
+     * Nodes of the footprint picked with Zipfian probabilities: the node of
+     * rank r (starting at 1) is picked with probability proportional to
+     * 1 / r^alpha, so the low addresses form a hot set.
+     */
+    TRACEGEN_ZIPF = 4,
+} TraceGenPattern;
+
+/** The parameters of a generated trace. */
+typedef struct TraceGenSpec
+{
+    TraceGenPattern pattern;
+
+    /** The number of instructions in the trace. */
+    uint64_t nof_insts;
+
+    /** The size in bytes of the data region the accesses fall into. */
+    uint64_t footprint;
+
+    /** The distance in bytes between accesses of the strided pattern. */
+    uint64_t stride;
+
+    /** The skew of the Zipfian pattern. */
+    double alpha;
+
+    /**
+     * The size in bytes of the instruction loop: instruction addresses run
+     * through it in 4-byte steps and start over at its end.
+     */
+    uint64_t code_footprint;
+
+    /** The percentages of loads and stores; the rest are ALU instructions. */
+    unsigned int load_perc;
+    unsigned int store_perc;
+
+    /** The seed of the random number generator. */
+    uint64_t seed;
+} TraceGenSpec;
+
+/** The state of a trace generator. */
+typedef struct TraceGen
+{
+    TraceGenSpec spec;
+
+    /** The number of instructions and memory accesses generated so far. */
+    uint64_t inst_count;
+    uint64_t access_count;
+
+    /** The state of the xorshift64 random number generator. */
+    uint64_t rng;
+
+    /** The number of nodes in the footprint (chase and zipf patterns). */
+    uint64_t nof_nodes;
+
+    /** The successor of each node on the cycle (chase pattern). */
+    uint32_t *next_node;
+
+    /** The current node (chase pattern). */
+    uint64_t node;
+
+    /** The cumulative probability of each rank (zipf pattern). */
+    double *zipf_cdf;
+} TraceGen;
+
+///////////////////////////////////////////////////////////////////////////////
+//                            FUNCTION PROTOTYPES                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Parse a generator specification of the form
+ * "gen:<pattern>[,<key>=<value>]...", where the pattern is seq, stride,
+ * random, chase or zipf, and the keys are insts, footprint, stride, alpha,
+ * code, loads, stores and seed. Sizes may carry a K, M or G suffix.
+ *
+ * Print an error message if the specification is invalid.
+ *
+ * @param text The specification.
+ * @param spec The parameters to fill in; keys that are not given keep their
+ *             defaults.
+ * @return Whether the specification is valid.
+ */
+bool tracegen_parse(const char *text, TraceGenSpec *spec);
+
+/**
+ * Allocate and initialize a trace generator.
+ *
+ * @param spec The parameters of the trace.
+ * @return A pointer to the trace generator.
+ */
+TraceGen *tracegen_new(const TraceGenSpec *spec);
+
+/**
+ * Generate the next trace record.
+ *
+ * @param gen The trace generator.
+ * @param inst_addr The instruction address to fill in.
+ * @param inst_type The instruction type to fill in.
+ * @param ldst_addr The load/store address to fill in (0 for ALU
+ *                  instructions).
+ * @return Whether a record was generated, i.e., the trace is not over.
+ */
+bool tracegen_next(TraceGen *gen, uint32_t *inst_addr, uint8_t *inst_type,
+                   uint32_t *ldst_addr);
+
+/**
+ * Write the whole trace in the binary trace record format.
+ *
+ * @param gen The trace generator.
+ * @param fd The file descriptor to write to.
+ * @return Whether all records were written.
+ */
+bool tracegen_write(TraceGen *gen, int fd);
+
+/**
+ * Write the whole trace to a gzip-compressed trace file, which the
+ * simulator can read like any other trace.
+ *
+ * @param gen The trace generator.
+ * @param path The path of the trace file.
+ * @return Whether the file was written.
+ */
+bool tracegen_write_file(TraceGen *gen, const char *path);
+
+#endif // __TRACEGEN_H__